@@ -116,6 +116,42 @@ CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item)
     return item->valuedouble;
 }
 
+/* valueint64 is only exact while valuedouble still agrees with it; code that assigns valuedouble directly
+ * (as cJSON has always allowed) doesn't clear cJSON_NumberIsInt64, so the double wins then. */
+static cJSON_bool has_exact_int64(const cJSON * const item)
+{
+    return ((item->type & cJSON_NumberIsInt64) != 0) && ((double)item->valueint64 == item->valuedouble);
+}
+
+CJSON_PUBLIC(cJSON_int64) cJSON_GetInt64Value(const cJSON * const item)
+{
+    if (!cJSON_IsNumber(item))
+    {
+        return 0;
+    }
+
+    if (has_exact_int64(item))
+    {
+        return item->valueint64;
+    }
+
+    /* use saturation in case of overflow */
+    if (isnan(item->valuedouble))
+    {
+        return 0;
+    }
+    if (item->valuedouble >= (double)INT64_MAX)
+    {
+        return INT64_MAX;
+    }
+    if (item->valuedouble <= (double)INT64_MIN)
+    {
+        return INT64_MIN;
+    }
+
+    return (cJSON_int64)item->valuedouble;
+}
+
 /* This is a safeguard to prevent copy-pasters from using incompatible C and header files */
 #if (CJSON_VERSION_MAJOR != 1) || (CJSON_VERSION_MINOR != 7) || (CJSON_VERSION_PATCH != 18)
     #error cJSON.h and cJSON.c have different versions. Make sure that both have the same.
@@ -249,16 +285,93 @@ static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
     return node;
 }
 
+/* A child list shared by cJSON_DuplicateShared. Its first element is moved in behind the reference count, so lists
+ * that are never shared don't pay for the count. Every array/object holding the list has cJSON_ChildIsShared set. */
+typedef struct
+{
+    size_t references;
+    cJSON first;
+} shared_children;
+
+static shared_children *get_shared_children(const cJSON * const parent)
+{
+    return (shared_children*)(void*)((unsigned char*)parent->child - offsetof(shared_children, first));
+}
+
+/* Move the first element of parent's child list to first, fixing up the links to it. */
+static void move_first_child(cJSON * const parent, cJSON * const first)
+{
+    memcpy(first, parent->child, sizeof(cJSON));
+    if (first->next != NULL)
+    {
+        first->next->prev = first;
+    }
+    else
+    {
+        first->prev = first; /* the only element is also the last */
+    }
+    parent->child = first;
+}
+
+/* Drop parent's hold on a child list it shares with copies made by cJSON_DuplicateShared.
+ * Returns true if the list is still used by another copy and must be left alone. If parent was the last one holding
+ * it, *shared_first is set to the first element, which has to be freed with free_item. */
+static cJSON_bool release_child_references(cJSON * const parent, cJSON ** const shared_first)
+{
+    shared_children *shared = NULL;
+    if (!(parent->type & cJSON_ChildIsShared))
+    {
+        return false;
+    }
+
+    shared = get_shared_children(parent);
+    parent->type &= ~cJSON_ChildIsShared;
+    if (shared->references > 1)
+    {
+        shared->references--;
+        return true;
+    }
+    *shared_first = parent->child;
+
+    return false;
+}
+
+/* Free the memory of item, which is the whole shared_children block if item is the first element of a released
+ * shared list. */
+static void free_item(cJSON * const item, const cJSON * const shared_first, const internal_hooks * const hooks)
+{
+    if (item == shared_first)
+    {
+        hooks->deallocate((unsigned char*)item - offsetof(shared_children, first));
+    }
+    else
+    {
+        hooks->deallocate(item);
+    }
+}
+
 /* Delete a cJSON structure. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 {
     cJSON *next = NULL;
+    cJSON *shared_first = NULL;
+    cJSON *released_first = NULL;
     while (item != NULL)
     {
         next = item->next;
-        if (!(item->type & cJSON_IsReference) && (item->child != NULL))
+        /* a released shared list is spliced in next, so its first element is always the item after its parent */
+        released_first = shared_first;
+        shared_first = NULL;
+        if (!(item->type & cJSON_IsReference) && (item->child != NULL) && !release_child_references(item, &shared_first))
         {
-            cJSON_Delete(item->child);
+            /* instead of recursing, splice the children in front of the remaining siblings */
+            cJSON *last_child = item->child;
+            while (last_child->next != NULL)
+            {
+                last_child = last_child->next;
+            }
+            last_child->next = next;
+            next = item->child;
         }
         if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL))
         {
@@ -270,7 +383,7 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
             global_hooks.deallocate(item->string);
             item->string = NULL;
         }
-        global_hooks.deallocate(item);
+        free_item(item, released_first, &global_hooks);
         item = next;
     }
 }
@@ -286,6 +399,17 @@ static unsigned char get_decimal_point(void)
 #endif
 }
 
+/* One node of a compiled key filter. The filter is a tree of member names, its root stands for the document. */
+struct cJSON_KeyFilter
+{
+    const struct cJSON_KeyFilter *parent;
+    const struct cJSON_KeyFilter *first_child;
+    const struct cJSON_KeyFilter *next_sibling;
+    const char *key;
+    size_t key_length;
+    cJSON_bool keep_all; /* a path ends here, keep the whole value */
+};
+
 typedef struct
 {
     const unsigned char *content;
@@ -293,6 +417,10 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    const cJSON_KeyFilter *filter; /* if set, only object members in the filter are kept */
+    /* nodes of documents that are no longer needed, handed out again before allocating new ones */
+    cJSON *recycled;
+    cJSON *recycled_tail;
 } parse_buffer;
 
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
@@ -303,12 +431,214 @@ typedef struct
 /* get a pointer to the buffer at the position */
 #define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
 
+/* store an exact integer in a number item, keeping valuedouble and valueint in sync */
+static void set_int64(cJSON * const item, const cJSON_int64 number)
+{
+    item->valueint64 = number;
+    item->valuedouble = (double)number;
+
+    /* use saturation in case of overflow */
+    if (number >= INT_MAX)
+    {
+        item->valueint = INT_MAX;
+    }
+    else if (number <= INT_MIN)
+    {
+        item->valueint = INT_MIN;
+    }
+    else
+    {
+        item->valueint = (int)number;
+    }
+
+    item->type = (item->type & ~0xFF) | cJSON_Number | cJSON_NumberIsInt64;
+}
+
+/* Parse a plain integer (no fraction or exponent) that fits into 64 bits directly, without a temporary copy and strtod.
+ * Returns false without consuming input if the number has to go through parse_number instead. */
+static cJSON_bool parse_integer(cJSON * const item, parse_buffer * const input_buffer)
+{
+    const unsigned char *input_pointer = NULL;
+    size_t available = 0;
+    size_t i = 0;
+    size_t first_digit = 0;
+    uint64_t magnitude = 0;
+    uint64_t limit = (uint64_t)INT64_MAX;
+
+    if ((input_buffer == NULL) || (input_buffer->content == NULL) || cannot_access_at_index(input_buffer, 0))
+    {
+        return false;
+    }
+
+    input_pointer = buffer_at_offset(input_buffer);
+    available = input_buffer->length - input_buffer->offset;
+
+    if (input_pointer[0] == '-')
+    {
+        /* the magnitude of INT64_MIN is one more than INT64_MAX */
+        limit = (uint64_t)INT64_MAX + 1;
+        first_digit = 1;
+    }
+
+    for (i = first_digit; (i < available) && (input_pointer[i] >= '0') && (input_pointer[i] <= '9'); i++)
+    {
+        unsigned int digit = (unsigned int)(input_pointer[i] - '0');
+        if (magnitude > ((limit - digit) / 10))
+        {
+            return false; /* doesn't fit, let strtod produce the double */
+        }
+        magnitude = (magnitude * 10) + digit;
+    }
+
+    if (i == first_digit)
+    {
+        return false; /* no digits */
+    }
+    if (i < available)
+    {
+        switch (input_pointer[i])
+        {
+            case '.':
+            case 'e':
+            case 'E':
+            case '+':
+            case '-':
+                return false; /* not a plain integer */
+            default:
+                break;
+        }
+    }
+
+    if (first_digit == 0)
+    {
+        set_int64(item, (cJSON_int64)magnitude);
+    }
+    else if (magnitude == 0)
+    {
+        return false; /* keep "-0" a negative zero double */
+    }
+    else
+    {
+        /* negate without overflowing for INT64_MIN */
+        set_int64(item, -(cJSON_int64)(magnitude - 1) - 1);
+    }
+
+    input_buffer->offset += i;
+    return true;
+}
+
+/* Free a string a recycled node still holds when it is not needed again. */
+static void release_stale_string(const parse_buffer * const input_buffer, char **string)
+{
+    if (*string != NULL)
+    {
+        input_buffer->hooks.deallocate(*string);
+        *string = NULL;
+    }
+}
+
+/* Get a node for the parser, reusing a recycled one if there is any. */
+static cJSON *new_parse_item(parse_buffer * const input_buffer)
+{
+    cJSON *item = input_buffer->recycled;
+    if (item == NULL)
+    {
+        return cJSON_New_Item(&(input_buffer->hooks));
+    }
+
+    input_buffer->recycled = item->next;
+    if (input_buffer->recycled == NULL)
+    {
+        input_buffer->recycled_tail = NULL;
+    }
+    item->next = NULL;
+
+    return item;
+}
+
+/* Take apart a tree that is no longer needed and queue its nodes for reuse by the parser.
+ * Nodes are queued in document order, which is the order the parser asks for them, and keep their string buffers,
+ * so a document of the same shape is parsed into the same nodes and strings again. */
+static void recycle_items(parse_buffer * const input_buffer, cJSON *item, cJSON *shared_first)
+{
+    cJSON *next = NULL;
+    cJSON *released_first = NULL;
+    char *valuestring = NULL;
+    size_t valuestring_capacity = 0;
+    char *string = NULL;
+    while (item != NULL)
+    {
+        next = item->next;
+        released_first = shared_first;
+        shared_first = NULL;
+        if (!(item->type & cJSON_IsReference) && (item->child != NULL) && !release_child_references(item, &shared_first))
+        {
+            /* splice the children in front of the remaining siblings */
+            cJSON *last_child = item->child;
+            while (last_child->next != NULL)
+            {
+                last_child = last_child->next;
+            }
+            last_child->next = next;
+            next = item->child;
+        }
+        /* only buffers the node owns can be reused */
+        valuestring = (item->type & cJSON_IsReference) ? NULL : item->valuestring;
+        string = (item->type & cJSON_StringIsConst) ? NULL : item->string;
+        if (item == released_first)
+        {
+            /* the node is part of the shared_children block, it can't go back as a node of its own */
+            release_stale_string(input_buffer, &valuestring);
+            release_stale_string(input_buffer, &string);
+            free_item(item, released_first, &input_buffer->hooks);
+            item = next;
+            continue;
+        }
+        valuestring_capacity = item->valuestring_capacity;
+        memset(item, '\0', sizeof(cJSON));
+        if (valuestring != NULL)
+        {
+            item->valuestring = valuestring;
+            item->valuestring_capacity = valuestring_capacity;
+        }
+        item->string = string;
+
+        if (input_buffer->recycled_tail == NULL)
+        {
+            input_buffer->recycled = item;
+        }
+        else
+        {
+            input_buffer->recycled_tail->next = item;
+        }
+        input_buffer->recycled_tail = item;
+
+        item = next;
+    }
+}
+
+/* Free the nodes that were recycled but not needed again. */
+static void release_recycled_items(parse_buffer * const input_buffer)
+{
+    cJSON *next = NULL;
+    while (input_buffer->recycled != NULL)
+    {
+        next = input_buffer->recycled->next;
+        release_stale_string(input_buffer, &input_buffer->recycled->valuestring);
+        release_stale_string(input_buffer, &input_buffer->recycled->string);
+        input_buffer->hooks.deallocate(input_buffer->recycled);
+        input_buffer->recycled = next;
+    }
+    input_buffer->recycled_tail = NULL;
+}
+
 /* Parse the input text to generate a number, and populate the result into item. */
 static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
 {
     double number = 0;
     unsigned char *after_end = NULL;
     unsigned char *number_c_string;
+    unsigned char short_number[32]; /* numbers this short, i.e. almost all, are parsed without an allocation */
     unsigned char decimal_point = get_decimal_point();
     size_t i = 0;
     size_t number_string_length = 0;
@@ -353,8 +683,15 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
         }
     }
 loop_end:
-    /* malloc for temporary buffer, add 1 for '\0' */
-    number_c_string = (unsigned char *) input_buffer->hooks.allocate(number_string_length + 1);
+    /* malloc for temporary buffer if it doesn't fit on the stack, add 1 for '\0' */
+    if (number_string_length < sizeof(short_number))
+    {
+        number_c_string = short_number;
+    }
+    else
+    {
+        number_c_string = (unsigned char *) input_buffer->hooks.allocate(number_string_length + 1);
+    }
     if (number_c_string == NULL)
     {
         return false; /* allocation failure */
@@ -379,7 +716,10 @@ loop_end:
     if (number_c_string == after_end)
     {
         /* free the temporary buffer */
-        input_buffer->hooks.deallocate(number_c_string);
+        if (number_c_string != short_number)
+        {
+            input_buffer->hooks.deallocate(number_c_string);
+        }
         return false; /* parse_error */
     }
 
@@ -403,13 +743,18 @@ loop_end:
 
     input_buffer->offset += (size_t)(after_end - number_c_string);
     /* free the temporary buffer */
-    input_buffer->hooks.deallocate(number_c_string);
+    if (number_c_string != short_number)
+    {
+        input_buffer->hooks.deallocate(number_c_string);
+    }
     return true;
 }
 
 /* don't ask me, but the original cJSON_SetNumberValue returns an integer or double */
 CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
 {
+    object->type &= ~cJSON_NumberIsInt64;
+
     if (number >= INT_MAX)
     {
         object->valueint = INT_MAX;
@@ -426,12 +771,36 @@ CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
     return object->valuedouble = number;
 }
 
+CJSON_PUBLIC(cJSON_int64) cJSON_SetInt64Value(cJSON *object, const cJSON_int64 number)
+{
+    if (object == NULL)
+    {
+        return number;
+    }
+
+    set_int64(object, number);
+
+    return number;
+}
+
+/* Size of the buffer behind item->valuestring */
+static size_t get_valuestring_capacity(const cJSON * const item)
+{
+    if (item->valuestring_capacity != 0)
+    {
+        return item->valuestring_capacity;
+    }
+
+    return strlen(item->valuestring) + sizeof("");
+}
+
 /* Note: when passing a NULL valuestring, cJSON_SetValuestring treats this as an error and return NULL */
 CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
 {
     char *copy = NULL;
     size_t v1_len;
     size_t v2_len;
+    size_t capacity;
     /* if object's type is not cJSON_String or is cJSON_IsReference, it should not set valuestring */
     if ((object == NULL) || !(object->type & cJSON_String) || (object->type & cJSON_IsReference))
     {
@@ -444,7 +813,8 @@ CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
     }
 
     v1_len = strlen(valuestring);
-    v2_len = strlen(object->valuestring);
+    capacity = get_valuestring_capacity(object);
+    v2_len = capacity - sizeof("");
 
     if (v1_len <= v2_len)
     {
@@ -454,18 +824,31 @@ CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
             return NULL;
         }
         strcpy(object->valuestring, valuestring);
+        object->valuestring_capacity = capacity;
         return object->valuestring;
     }
-    copy = (char*) cJSON_strdup((const unsigned char*)valuestring, &global_hooks);
+
+    /* grow geometrically, so repeated updates settle on a buffer that fits */
+    if (capacity < ((size_t)-1) / 2)
+    {
+        capacity *= 2;
+    }
+    if (capacity < (v1_len + sizeof("")))
+    {
+        capacity = v1_len + sizeof("");
+    }
+    copy = (char*)global_hooks.allocate(capacity);
     if (copy == NULL)
     {
         return NULL;
     }
+    memcpy(copy, valuestring, v1_len + sizeof(""));
     if (object->valuestring != NULL)
     {
         cJSON_free(object->valuestring);
     }
     object->valuestring = copy;
+    object->valuestring_capacity = capacity;
 
     return copy;
 }
@@ -479,6 +862,8 @@ typedef struct
     cJSON_bool noalloc;
     cJSON_bool format; /* is this print a formatted print */
     internal_hooks hooks;
+    cJSON_PrintSink sink; /* if set, full chunks are handed to the sink instead of growing the buffer */
+    void *sink_user_data;
 } printbuffer;
 
 /* realloc printbuffer if necessary to have at least "needed" bytes more */
@@ -510,6 +895,21 @@ static unsigned char* ensure(printbuffer * const p, size_t needed)
         return p->buffer + p->offset;
     }
 
+    if ((p->sink != NULL) && (p->offset > 0))
+    {
+        /* everything before offset is final, so hand it to the sink and start over at the beginning of the buffer */
+        if (!p->sink((const char*)p->buffer, p->offset, p->sink_user_data))
+        {
+            return NULL;
+        }
+        needed -= p->offset;
+        p->offset = 0;
+        if (needed <= p->length)
+        {
+            return p->buffer;
+        }
+    }
+
     if (p->noalloc) {
         return NULL;
     }
@@ -587,6 +987,67 @@ static cJSON_bool compare_double(double a, double b)
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
+/* two digit strings "00" to "99", so integers can be printed two digits per division */
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* Render an integer into output (at least 21 bytes) and return the number of characters written, without a terminator. */
+static size_t print_int64(const cJSON_int64 number, unsigned char * const output)
+{
+    unsigned char digits[20];
+    unsigned char *digit_pointer = digits + sizeof(digits);
+    uint64_t magnitude = (number < 0) ? ((uint64_t)0 - (uint64_t)number) : (uint64_t)number;
+    uint32_t small_magnitude = 0;
+    size_t index = 0;
+    size_t length = 0;
+
+    /* use 64 bit division only as long as it is needed, it is a library call on 32 bit targets */
+    while (magnitude > UINT32_MAX)
+    {
+        index = (size_t)(magnitude % 100) * 2;
+        magnitude /= 100;
+        *--digit_pointer = (unsigned char)digit_pairs[index + 1];
+        *--digit_pointer = (unsigned char)digit_pairs[index];
+    }
+
+    small_magnitude = (uint32_t)magnitude;
+    while (small_magnitude >= 100)
+    {
+        index = (size_t)(small_magnitude % 100) * 2;
+        small_magnitude /= 100;
+        *--digit_pointer = (unsigned char)digit_pairs[index + 1];
+        *--digit_pointer = (unsigned char)digit_pairs[index];
+    }
+    if (small_magnitude >= 10)
+    {
+        index = (size_t)small_magnitude * 2;
+        *--digit_pointer = (unsigned char)digit_pairs[index + 1];
+        *--digit_pointer = (unsigned char)digit_pairs[index];
+    }
+    else
+    {
+        *--digit_pointer = (unsigned char)('0' + small_magnitude);
+    }
+
+    if (number < 0)
+    {
+        output[length++] = '-';
+    }
+    memcpy(output + length, digit_pointer, (size_t)(digits + sizeof(digits) - digit_pointer));
+    length += (size_t)(digits + sizeof(digits) - digit_pointer);
+
+    return length;
+}
+
 /* Render the number nicely from the given item into a string. */
 static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
 {
@@ -603,14 +1064,18 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
         return false;
     }
 
+    if (has_exact_int64(item))
+    {
+        length = (int)print_int64(item->valueint64, number_buffer);
+    }
     /* This checks for NaN and Infinity */
-    if (isnan(d) || isinf(d))
+    else if (isnan(d) || isinf(d))
     {
         length = sprintf((char*)number_buffer, "null");
     }
     else if(d == (double)item->valueint)
     {
-        length = sprintf((char*)number_buffer, "%d", item->valueint);
+        length = (int)print_int64(item->valueint, number_buffer);
     }
     else
     {
@@ -816,12 +1281,16 @@ fail:
 }
 
 /* Parse the input text into an unescaped cinput, and populate item. */
-static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+/* Parse a string literal into *string. If *string already holds a buffer (left on a recycled node) that is large
+ * enough, it is reused instead of allocating a new one. capacity, if given, holds the size of that buffer (0 for
+ * strlen + 1) and receives the size of the result. */
+static cJSON_bool parse_string_buffer(char **string, size_t *capacity, parse_buffer * const input_buffer)
 {
     const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
     const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
     unsigned char *output_pointer = NULL;
     unsigned char *output = NULL;
+    size_t output_capacity = 0;
 
     /* not a string */
     if (buffer_at_offset(input_buffer)[0] != '\"')
@@ -855,7 +1324,22 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
         /* This is at most how much we need for the output */
         allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        if (*string != NULL)
+        {
+            output_capacity = ((capacity != NULL) && (*capacity != 0)) ? *capacity : (strlen(*string) + sizeof(""));
+        }
+        /* allocation_length counts the opening quote, which leaves room for the terminator */
+        if ((*string != NULL) && (output_capacity >= allocation_length))
+        {
+            output = (unsigned char*)*string;
+            *string = NULL;
+        }
+        else
+        {
+            release_stale_string(input_buffer, string);
+            output_capacity = allocation_length + sizeof("");
+            output = (unsigned char*)input_buffer->hooks.allocate(output_capacity);
+        }
         if (output == NULL)
         {
             goto fail; /* allocation failure */
@@ -922,8 +1406,11 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     /* zero terminate the output */
     *output_pointer = '\0';
 
-    item->type = cJSON_String;
-    item->valuestring = (char*)output;
+    *string = (char*)output;
+    if (capacity != NULL)
+    {
+        *capacity = output_capacity;
+    }
 
     input_buffer->offset = (size_t) (input_end - input_buffer->content);
     input_buffer->offset++;
@@ -945,6 +1432,19 @@ fail:
     return false;
 }
 
+/* Parse the input text into an unescaped cstring, and populate item. */
+static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+{
+    if (!parse_string_buffer(&item->valuestring, &item->valuestring_capacity, input_buffer))
+    {
+        return false;
+    }
+
+    item->type = cJSON_String;
+
+    return true;
+}
+
 /* Render the cstring provided to an escaped version that can be printed. */
 static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
 {
@@ -1076,10 +1576,6 @@ static cJSON_bool print_string(const cJSON * const item, printbuffer * const p)
 /* Predeclare these prototypes. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer);
 static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer);
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer);
-static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer);
 
 /* Utility to jump whitespace and cr/lf */
 static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
@@ -1138,11 +1634,61 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
     return cJSON_ParseWithLengthOpts(value, buffer_length, return_parse_end, require_null_terminated);
 }
 
-/* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+/* Parse the document at the current offset of the buffer into a new root. */
+static cJSON *parse_next_document(parse_buffer * const buffer)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
-    cJSON *item = NULL;
+    cJSON *item = new_parse_item(buffer);
+    if (item == NULL) /* memory fail */
+    {
+        return NULL;
+    }
+    release_stale_string(buffer, &item->string);
+
+    if (!parse_value(item, buffer_skip_whitespace(buffer)))
+    {
+        /* parse failure. ep is set. */
+        cJSON_Delete(item);
+        return NULL;
+    }
+
+    return item;
+}
+
+/* Record where parsing of value failed, for cJSON_GetErrorPtr and return_parse_end. */
+static void set_parse_error(const char *value, const parse_buffer * const buffer, const char **return_parse_end)
+{
+    error local_error;
+
+    if (value == NULL)
+    {
+        return;
+    }
+
+    local_error.json = (const unsigned char*)value;
+    local_error.position = 0;
+
+    if (buffer->offset < buffer->length)
+    {
+        local_error.position = buffer->offset;
+    }
+    else if (buffer->length > 0)
+    {
+        local_error.position = buffer->length - 1;
+    }
+
+    if (return_parse_end != NULL)
+    {
+        *return_parse_end = (const char*)local_error.json + local_error.position;
+    }
+
+    global_error = local_error;
+}
+
+/* Parse an object - create a new root, and populate. */
+static cJSON *parse_document(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated, const cJSON_KeyFilter *filter)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0, 0, 0 };
+    cJSON *item = NULL;
 
     /* reset error position */
     global_error.json = NULL;
@@ -1157,16 +1703,11 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
     buffer.length = buffer_length;
     buffer.offset = 0;
     buffer.hooks = global_hooks;
+    buffer.filter = filter;
 
-    item = cJSON_New_Item(&global_hooks);
-    if (item == NULL) /* memory fail */
-    {
-        goto fail;
-    }
-
-    if (!parse_value(item, buffer_skip_whitespace(skip_utf8_bom(&buffer))))
+    item = parse_next_document(skip_utf8_bom(&buffer));
+    if (item == NULL)
     {
-        /* parse failure. ep is set. */
         goto fail;
     }
 
@@ -1192,30 +1733,243 @@ fail:
         cJSON_Delete(item);
     }
 
-    if (value != NULL)
+    set_parse_error(value, &buffer, return_parse_end);
+
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return parse_document(value, buffer_length, return_parse_end, require_null_terminated, NULL);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithFilter(const char *value, size_t buffer_length, const cJSON_KeyFilter *filter)
+{
+    return parse_document(value, buffer_length, NULL, false, filter);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_ParseMultiple(const char *value, size_t buffer_length, cJSON_DocumentCallback callback, void *user_data, const char **return_parse_end)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0, 0, 0 };
+    cJSON *document = NULL;
+    size_t index = 0;
+    cJSON_bool success = false;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (buffer_length == 0) || (callback == NULL))
+    {
+        set_parse_error(value, &buffer, return_parse_end);
+        return false;
+    }
+
+    buffer.content = (const unsigned char*)value;
+    buffer.length = buffer_length;
+    buffer.offset = 0;
+    buffer.hooks = global_hooks;
+    skip_utf8_bom(&buffer);
+
+    for (;;)
     {
-        error local_error;
-        local_error.json = (const unsigned char*)value;
-        local_error.position = 0;
+        /* documents may be separated by newlines or any other whitespace, or follow each other directly */
+        buffer_skip_whitespace(&buffer);
+        if (cannot_access_at_index(&buffer, 0) || (buffer_at_offset(&buffer)[0] <= 32))
+        {
+            /* only whitespace (or the null terminator) is left */
+            buffer.offset = buffer.length;
+            success = true;
+            break;
+        }
 
-        if (buffer.offset < buffer.length)
+        document = parse_next_document(&buffer);
+        if (document == NULL)
         {
-            local_error.position = buffer.offset;
+            set_parse_error(value, &buffer, return_parse_end);
+            success = false;
+            break;
         }
-        else if (buffer.length > 0)
+
+        success = callback(document, index++, user_data);
+        /* the next document is built from the nodes of this one */
+        recycle_items(&buffer, document, NULL);
+        if (!success)
         {
-            local_error.position = buffer.length - 1;
+            /* stopped by the callback, not an error */
+            success = true;
+            break;
         }
+    }
+
+    if (success && (return_parse_end != NULL))
+    {
+        *return_parse_end = (const char*)buffer.content + buffer.offset;
+    }
+
+    release_recycled_items(&buffer);
+
+    return success;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_ParseInto(cJSON *document, const char *value, size_t buffer_length)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0, 0, 0 };
+    cJSON *next = NULL;
+    cJSON *shared_first = NULL;
+    int string_is_const = 0;
+    cJSON_bool success = false;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((document == NULL) || (value == NULL) || (buffer_length == 0))
+    {
+        set_parse_error(value, &buffer, NULL);
+        return false;
+    }
+
+    buffer.content = (const unsigned char*)value;
+    buffer.length = buffer_length;
+    buffer.offset = 0;
+    buffer.hooks = global_hooks;
+
+    /* hand the old contents to the parser, the document node itself keeps its key and its place in a list */
+    if (document->type & cJSON_IsReference)
+    {
+        document->valuestring = NULL;
+        document->valuestring_capacity = 0;
+    }
+    else if ((document->child != NULL) && !release_child_references(document, &shared_first))
+    {
+        recycle_items(&buffer, document->child, shared_first);
+    }
+    next = document->next;
+    string_is_const = document->type & cJSON_StringIsConst;
+    document->child = NULL;
+    document->type = cJSON_Invalid;
+    document->valueint = 0;
+    document->valuedouble = 0;
+    document->valueint64 = 0;
+
+    success = parse_value(document, buffer_skip_whitespace(skip_utf8_bom(&buffer)));
+    document->next = next;
+    if (!success)
+    {
+        cJSON_Delete(document->child);
+        document->child = NULL;
+        release_stale_string(&buffer, &document->valuestring);
+        document->valuestring_capacity = 0;
+        document->type = cJSON_Invalid;
+        set_parse_error(value, &buffer, NULL);
+    }
+    document->type |= string_is_const;
+
+    release_recycled_items(&buffer);
+
+    return success;
+}
+
+CJSON_PUBLIC(cJSON_KeyFilter *) cJSON_CreateKeyFilter(const char * const *paths, int count)
+{
+    struct cJSON_KeyFilter *nodes = NULL;
+    size_t node_count = 1;
+    size_t used_nodes = 1;
+    size_t key_bytes = 0;
+    char *keys = NULL;
+    int i = 0;
+
+    if ((paths == NULL) || (count < 0))
+    {
+        return NULL;
+    }
 
-        if (return_parse_end != NULL)
+    /* every path segment needs at most one node and its name */
+    for (i = 0; i < count; i++)
+    {
+        const char *character = NULL;
+        if (paths[i] == NULL)
         {
-            *return_parse_end = (const char*)local_error.json + local_error.position;
+            return NULL;
         }
+        for (character = paths[i]; *character != '\0'; character++)
+        {
+            if (*character == '/')
+            {
+                node_count++;
+            }
+        }
+        node_count++;
+        key_bytes += (size_t)(character - paths[i]);
+    }
 
-        global_error = local_error;
+    nodes = (struct cJSON_KeyFilter*)global_hooks.allocate((node_count * sizeof(struct cJSON_KeyFilter)) + key_bytes + 1);
+    if (nodes == NULL)
+    {
+        return NULL;
     }
+    memset(nodes, '\0', node_count * sizeof(struct cJSON_KeyFilter));
+    keys = (char*)(nodes + node_count);
 
-    return NULL;
+    for (i = 0; i < count; i++)
+    {
+        struct cJSON_KeyFilter *current = nodes;
+        const char *segment = paths[i];
+
+        while (*segment != '\0')
+        {
+            const char *segment_end = NULL;
+            const struct cJSON_KeyFilter *child = NULL;
+            size_t segment_length = 0;
+
+            if (*segment == '/')
+            {
+                segment++;
+                continue;
+            }
+            for (segment_end = segment; (*segment_end != '\0') && (*segment_end != '/'); segment_end++)
+            {
+            }
+            segment_length = (size_t)(segment_end - segment);
+
+            for (child = current->first_child; child != NULL; child = child->next_sibling)
+            {
+                if ((child->key_length == segment_length) && (memcmp(child->key, segment, segment_length) == 0))
+                {
+                    break;
+                }
+            }
+            if (child == NULL)
+            {
+                struct cJSON_KeyFilter *new_node = &nodes[used_nodes++];
+                memcpy(keys, segment, segment_length);
+                new_node->key = keys;
+                new_node->key_length = segment_length;
+                keys += segment_length;
+                new_node->parent = current;
+                new_node->next_sibling = current->first_child;
+                current->first_child = new_node;
+                child = new_node;
+            }
+
+            current = &nodes[child - nodes];
+            segment = segment_end;
+        }
+
+        /* the path ends here (an empty path selects the whole document) */
+        current->keep_all = true;
+    }
+
+    return nodes;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteKeyFilter(cJSON_KeyFilter *filter)
+{
+    if (filter != NULL)
+    {
+        global_hooks.deallocate(filter);
+    }
 }
 
 /* Default options for cJSON_Parse */
@@ -1311,7 +2065,7 @@ CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
 
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, 0, 0 };
 
     if (prebuffer < 0)
     {
@@ -1342,7 +2096,7 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, 0, 0 };
 
     if ((length < 0) || (buffer == NULL))
     {
@@ -1359,15 +2113,50 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, cons
     return print_value(item, &p);
 }
 
-/* Parser core - when encountering text, process appropriately. */
-static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintToSink(const cJSON *item, size_t chunk_size, const cJSON_bool format, cJSON_PrintSink sink, void *user_data)
 {
-    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, 0, 0 };
+    cJSON_bool success = false;
+
+    if ((item == NULL) || (sink == NULL) || (chunk_size < 2) || (chunk_size > INT_MAX))
     {
-        return false; /* no input */
+        return false;
+    }
+
+    /* one extra byte for the '\0' the print functions always append */
+    p.buffer = (unsigned char*)global_hooks.allocate(chunk_size + 1);
+    if (p.buffer == NULL)
+    {
+        return false;
+    }
+
+    p.length = chunk_size + 1;
+    p.offset = 0;
+    p.noalloc = false;
+    p.format = format;
+    p.hooks = global_hooks;
+    p.sink = sink;
+    p.sink_user_data = user_data;
+
+    if (print_value(item, &p))
+    {
+        update_offset(&p);
+        /* flush the last, partially filled chunk */
+        success = (p.offset == 0) || sink((const char*)p.buffer, p.offset, user_data);
+    }
+
+    /* ensure() frees the buffer itself if growing it failed */
+    if (p.buffer != NULL)
+    {
+        global_hooks.deallocate(p.buffer);
     }
 
-    /* parse the different types of values */
+    return success;
+}
+
+/* Parse null, true, false, a string or a number. */
+static cJSON_bool parse_primitive(cJSON * const item, parse_buffer * const input_buffer)
+{
     /* null */
     if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
     {
@@ -1398,486 +2187,627 @@ static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buf
     /* number */
     if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
     {
-        return parse_number(item, input_buffer);
-    }
-    /* array */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '['))
-    {
-        return parse_array(item, input_buffer);
-    }
-    /* object */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '{'))
-    {
-        return parse_object(item, input_buffer);
+        return parse_integer(item, input_buffer) || parse_number(item, input_buffer);
     }
 
     return false;
 }
 
-/* Render a value to text. */
-static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+/* Parse the name of an object member and the following ':', leaving the buffer at the start of the value. */
+static cJSON_bool parse_member_name(cJSON * const item, parse_buffer * const input_buffer)
 {
-    unsigned char *output = NULL;
-
-    if ((item == NULL) || (output_buffer == NULL))
+    if (!parse_string_buffer(&item->string, NULL, input_buffer))
     {
-        return false;
+        return false; /* failed to parse name */
     }
+    buffer_skip_whitespace(input_buffer);
 
-    switch ((item->type) & 0xFF)
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
     {
-        case cJSON_NULL:
-            output = ensure(output_buffer, 5);
-            if (output == NULL)
-            {
-                return false;
-            }
-            strcpy((char*)output, "null");
-            return true;
-
-        case cJSON_False:
-            output = ensure(output_buffer, 6);
-            if (output == NULL)
-            {
-                return false;
-            }
-            strcpy((char*)output, "false");
-            return true;
-
-        case cJSON_True:
-            output = ensure(output_buffer, 5);
-            if (output == NULL)
-            {
-                return false;
-            }
-            strcpy((char*)output, "true");
-            return true;
-
-        case cJSON_Number:
-            return print_number(item, output_buffer);
-
-        case cJSON_Raw:
-        {
-            size_t raw_length = 0;
-            if (item->valuestring == NULL)
-            {
-                return false;
-            }
-
-            raw_length = strlen(item->valuestring) + sizeof("");
-            output = ensure(output_buffer, raw_length);
-            if (output == NULL)
-            {
-                return false;
-            }
-            memcpy(output, item->valuestring, raw_length);
-            return true;
-        }
-
-        case cJSON_String:
-            return print_string(item, output_buffer);
-
-        case cJSON_Array:
-            return print_array(item, output_buffer);
+        return false; /* invalid object */
+    }
 
-        case cJSON_Object:
-            return print_object(item, output_buffer);
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
 
-        default:
-            return false;
-    }
+    return true;
 }
 
-/* Build an array from input text. */
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer)
+/* Skip a string literal without unescaping it. Leaves the buffer right after the closing quote. */
+static cJSON_bool skip_string(parse_buffer * const input_buffer)
 {
-    cJSON *head = NULL; /* head of the linked list */
-    cJSON *current_item = NULL;
+    size_t i = 1;
 
-    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '\"'))
     {
-        return false; /* to deeply nested */
+        return false;
     }
-    input_buffer->depth++;
 
-    if (buffer_at_offset(input_buffer)[0] != '[')
+    for (; can_access_at_index(input_buffer, i); i++)
     {
-        /* not an array */
-        goto fail;
+        if (buffer_at_offset(input_buffer)[i] == '\\')
+        {
+            i++;
+        }
+        else if (buffer_at_offset(input_buffer)[i] == '\"')
+        {
+            input_buffer->offset += i + 1;
+            return true;
+        }
     }
 
-    input_buffer->offset++;
-    buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ']'))
-    {
-        /* empty array */
-        goto success;
-    }
+    return false; /* string ended unexpectedly */
+}
 
-    /* check if we skipped to the end of the buffer */
-    if (cannot_access_at_index(input_buffer, 0))
-    {
-        input_buffer->offset--;
-        goto fail;
-    }
+/* Skip a whole value at tokenizer speed, without allocating anything.
+ * Only strings and the balance of brackets are checked, the rest of the skipped value is not validated. */
+static cJSON_bool skip_value(parse_buffer * const input_buffer)
+{
+    size_t depth = 0;
 
-    /* step back to character in front of the first element */
-    input_buffer->offset--;
-    /* loop through the comma separated array elements */
     do
     {
-        /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
-        if (new_item == NULL)
+        if (cannot_access_at_index(input_buffer, 0))
         {
-            goto fail; /* allocation failure */
+            return false;
         }
 
-        /* attach next item to list */
-        if (head == NULL)
+        switch (buffer_at_offset(input_buffer)[0])
         {
-            /* start the linked list */
-            current_item = head = new_item;
-        }
-        else
-        {
-            /* add to the end and advance */
-            current_item->next = new_item;
-            new_item->prev = current_item;
-            current_item = new_item;
-        }
+            case '\"':
+                if (!skip_string(input_buffer))
+                {
+                    return false;
+                }
+                break;
 
-        /* parse next value */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
-        {
-            goto fail; /* failed to parse value */
-        }
-        buffer_skip_whitespace(input_buffer);
-    }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+            case '[':
+            case '{':
+                depth++;
+                input_buffer->offset++;
+                break;
 
-    if (cannot_access_at_index(input_buffer, 0) || buffer_at_offset(input_buffer)[0] != ']')
-    {
-        goto fail; /* expected end of array */
-    }
+            case ']':
+            case '}':
+                if (depth == 0)
+                {
+                    return false;
+                }
+                depth--;
+                input_buffer->offset++;
+                break;
 
-success:
-    input_buffer->depth--;
+            case ',':
+            case ':':
+                if (depth == 0)
+                {
+                    return false;
+                }
+                input_buffer->offset++;
+                break;
 
-    if (head != NULL) {
-        head->prev = current_item;
+            default:
+                if (buffer_at_offset(input_buffer)[0] <= 32)
+                {
+                    input_buffer->offset++;
+                    break;
+                }
+                /* a literal or a number, runs until the next structural character or whitespace */
+                while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] > 32))
+                {
+                    const unsigned char character = buffer_at_offset(input_buffer)[0];
+                    if ((character == ',') || (character == ':') || (character == ']') || (character == '}') || (character == '\"') || (character == '[') || (character == '{'))
+                    {
+                        break;
+                    }
+                    input_buffer->offset++;
+                }
+                break;
+        }
     }
+    while (depth > 0);
 
-    item->type = cJSON_Array;
-    item->child = head;
+    return true;
+}
 
-    input_buffer->offset++;
+/* Find the filter entry for the member name at the current offset, NULL if the member is not wanted. */
+static const cJSON_KeyFilter *get_filter_child(const cJSON_KeyFilter * const filter, parse_buffer * const input_buffer)
+{
+    const unsigned char *name = buffer_at_offset(input_buffer) + 1;
+    const cJSON_KeyFilter *child = NULL;
+    size_t name_length = 0;
+    size_t start = input_buffer->offset;
 
-    return true;
+    if (!skip_string(input_buffer))
+    {
+        return NULL;
+    }
+    name_length = input_buffer->offset - start - 2;
+    input_buffer->offset = start;
 
-fail:
-    if (head != NULL)
+    for (child = filter->first_child; child != NULL; child = child->next_sibling)
     {
-        cJSON_Delete(head);
+        if ((child->key_length == name_length) && (memcmp(child->key, name, name_length) == 0))
+        {
+            return child;
+        }
     }
 
-    return false;
+    return NULL;
 }
 
-/* Render an array to text */
-static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer)
+/* Skip an object member that is not wanted, leaving the buffer after its value. */
+static cJSON_bool skip_member(parse_buffer * const input_buffer)
 {
-    unsigned char *output_pointer = NULL;
-    size_t length = 0;
-    cJSON *current_element = item->child;
-
-    if (output_buffer == NULL)
+    if (!skip_string(input_buffer))
     {
         return false;
     }
-
-    /* Compose the output array. */
-    /* opening square bracket */
-    output_pointer = ensure(output_buffer, 1);
-    if (output_pointer == NULL)
+    buffer_skip_whitespace(input_buffer);
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
     {
         return false;
     }
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+
+    return skip_value(input_buffer);
+}
+
+/* Parser core - when encountering text, process appropriately.
+ * Arrays and objects are parsed without recursion, so stack use does not depend on how deeply the input is nested.
+ * While a container is open its next pointer (unused until the container is complete and gets a sibling) points
+ * to the enclosing container, and the head of its child list points to the tail through prev.
+ * With a key filter in the input buffer, object members that are not in the filter are skipped without creating
+ * nodes for them. */
+static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+{
+    cJSON *current_item = item;
+    cJSON *parent = NULL; /* innermost open array/object */
+    cJSON *new_item = NULL;
+    /* filter for the members/elements of the innermost open container, NULL when everything is kept */
+    const cJSON_KeyFilter *filter = NULL;
+    /* filter for the value that is parsed next */
+    const cJSON_KeyFilter *value_filter = NULL;
+    /* where filtering was suspended because a whole subtree is kept, and the filter to go back to */
+    size_t unfiltered_depth = 0;
+    const cJSON_KeyFilter *saved_filter = NULL;
+
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    {
+        return false; /* no input */
+    }
 
-    *output_pointer = '[';
-    output_buffer->offset++;
-    output_buffer->depth++;
+    if ((input_buffer->filter != NULL) && !input_buffer->filter->keep_all)
+    {
+        filter = input_buffer->filter;
+    }
+    value_filter = filter;
 
-    while (current_element != NULL)
+    for (;;)
     {
-        if (!print_value(current_element, output_buffer))
+        if ((current_item->valuestring != NULL) && (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '\"')))
         {
-            return false;
+            /* a recycled node that held a string before */
+            release_stale_string(input_buffer, &current_item->valuestring);
+            current_item->valuestring_capacity = 0;
         }
-        update_offset(output_buffer);
-        if (current_element->next)
+
+        /* parse the value at the current offset into current_item */
+        if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '[') || (buffer_at_offset(input_buffer)[0] == '{')))
         {
-            length = (size_t) (output_buffer->format ? 2 : 1);
-            output_pointer = ensure(output_buffer, length + 1);
-            if (output_pointer == NULL)
+            const cJSON_bool is_object = (buffer_at_offset(input_buffer)[0] == '{');
+
+            if (input_buffer->depth >= CJSON_NESTING_LIMIT)
             {
-                return false;
+                goto fail; /* to deeply nested */
+            }
+            input_buffer->depth++;
+            current_item->type = is_object ? cJSON_Object : cJSON_Array;
+
+            input_buffer->offset++;
+            buffer_skip_whitespace(input_buffer);
+            if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == (is_object ? '}' : ']')))
+            {
+                /* empty array/object */
+                input_buffer->depth--;
+                input_buffer->offset++;
             }
-            *output_pointer++ = ',';
-            if(output_buffer->format)
+            else if (cannot_access_at_index(input_buffer, 0))
             {
-                *output_pointer++ = ' ';
+                /* we skipped to the end of the buffer */
+                input_buffer->offset--;
+                goto fail;
+            }
+            else
+            {
+                /* open the container and continue with its first element */
+                current_item->next = parent;
+                parent = current_item;
+
+                if ((value_filter == NULL) && (filter != NULL))
+                {
+                    saved_filter = filter;
+                    unfiltered_depth = input_buffer->depth;
+                }
+                filter = value_filter;
+
+                goto next_element;
             }
-            *output_pointer = '\0';
-            output_buffer->offset += length;
         }
-        current_element = current_element->next;
-    }
+        else if (!parse_primitive(current_item, input_buffer))
+        {
+            goto fail;
+        }
 
-    output_pointer = ensure(output_buffer, 2);
-    if (output_pointer == NULL)
-    {
-        return false;
-    }
-    *output_pointer++ = ']';
-    *output_pointer = '\0';
-    output_buffer->depth--;
+complete:
+        /* the value is complete, close every container that ends here */
+        for (;;)
+        {
+            if (parent == NULL)
+            {
+                return true;
+            }
 
-    return true;
-}
+            buffer_skip_whitespace(input_buffer);
+            if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','))
+            {
+                if (((parent->type & 0xFF) == cJSON_Object) && cannot_access_at_index(input_buffer, 1))
+                {
+                    goto fail; /* nothing comes after the comma */
+                }
+                input_buffer->offset++;
+                buffer_skip_whitespace(input_buffer);
+                break;
+            }
+            if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != (((parent->type & 0xFF) == cJSON_Object) ? '}' : ']')))
+            {
+                goto fail; /* expected end of array/object */
+            }
 
-/* Build an object from the text. */
-static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer)
-{
-    cJSON *head = NULL; /* linked list head */
-    cJSON *current_item = NULL;
+            if (unfiltered_depth == input_buffer->depth)
+            {
+                filter = saved_filter;
+                unfiltered_depth = 0;
+            }
+            else if ((filter != NULL) && (parent->next != NULL) && ((parent->next->type & 0xFF) == cJSON_Object))
+            {
+                filter = filter->parent;
+            }
 
-    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
-    {
-        return false; /* to deeply nested */
-    }
-    input_buffer->depth++;
+            input_buffer->depth--;
+            input_buffer->offset++;
 
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '{'))
-    {
-        goto fail; /* not an object */
-    }
+            current_item = parent;
+            parent = current_item->next;
+            current_item->next = NULL;
+        }
 
-    input_buffer->offset++;
-    buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '}'))
-    {
-        goto success; /* empty object */
-    }
+next_element:
+        /* the buffer is at the next element of parent */
+        value_filter = filter;
+        if (((parent->type & 0xFF) == cJSON_Object) && (filter != NULL))
+        {
+            for (;;)
+            {
+                if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '\"'))
+                {
+                    break; /* let parse_member_name report the error */
+                }
+                value_filter = get_filter_child(filter, input_buffer);
+                if (value_filter != NULL)
+                {
+                    break;
+                }
 
-    /* check if we skipped to the end of the buffer */
-    if (cannot_access_at_index(input_buffer, 0))
-    {
-        input_buffer->offset--;
-        goto fail;
-    }
+                if (!skip_member(input_buffer))
+                {
+                    goto fail;
+                }
+                buffer_skip_whitespace(input_buffer);
+                if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '}'))
+                {
+                    goto complete; /* no more wanted members */
+                }
+                if (cannot_access_at_index(input_buffer, 1) || (buffer_at_offset(input_buffer)[0] != ','))
+                {
+                    goto fail;
+                }
+                input_buffer->offset++;
+                buffer_skip_whitespace(input_buffer);
+            }
+            if ((value_filter != NULL) && value_filter->keep_all)
+            {
+                value_filter = NULL;
+            }
+        }
 
-    /* step back to character in front of the first element */
-    input_buffer->offset--;
-    /* loop through the comma separated array elements */
-    do
-    {
-        /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        new_item = new_parse_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
         }
-
-        /* attach next item to list */
-        if (head == NULL)
+        if (parent->child == NULL)
         {
-            /* start the linked list */
-            current_item = head = new_item;
+            parent->child = new_item;
         }
         else
         {
-            /* add to the end and advance */
-            current_item->next = new_item;
-            new_item->prev = current_item;
-            current_item = new_item;
+            /* add to the end */
+            parent->child->prev->next = new_item;
+            new_item->prev = parent->child->prev;
         }
+        parent->child->prev = new_item;
+        current_item = new_item;
 
-        if (cannot_access_at_index(input_buffer, 1))
+        if ((parent->type & 0xFF) == cJSON_Object)
         {
-            goto fail; /* nothing comes after the comma */
+            if (!parse_member_name(current_item, input_buffer))
+            {
+                goto fail;
+            }
         }
-
-        /* parse the name of the child */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_string(current_item, input_buffer))
+        else
         {
-            goto fail; /* failed to parse name */
+            release_stale_string(input_buffer, &current_item->string);
         }
-        buffer_skip_whitespace(input_buffer);
+    }
 
-        /* swap valuestring and string, because we parsed the name */
-        current_item->string = current_item->valuestring;
-        current_item->valuestring = NULL;
+fail:
+    /* give the containers that are still open their next pointers back, so the caller can delete the partial tree */
+    while (parent != NULL)
+    {
+        current_item = parent;
+        parent = current_item->next;
+        current_item->next = NULL;
+    }
 
-        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
-        {
-            goto fail; /* invalid object */
-        }
+    return false;
+}
 
-        /* parse the value */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
-        {
-            goto fail; /* failed to parse value */
-        }
-        buffer_skip_whitespace(input_buffer);
-    }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+/* Render null, true, false, a number, a string or raw json to text. */
+static cJSON_bool print_primitive(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output = NULL;
 
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '}'))
+    switch ((item->type) & 0xFF)
     {
-        goto fail; /* expected end of object */
-    }
+        case cJSON_NULL:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "null");
+            return true;
 
-success:
-    input_buffer->depth--;
+        case cJSON_False:
+            output = ensure(output_buffer, 6);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "false");
+            return true;
 
-    if (head != NULL) {
-        head->prev = current_item;
-    }
+        case cJSON_True:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "true");
+            return true;
 
-    item->type = cJSON_Object;
-    item->child = head;
+        case cJSON_Number:
+            return print_number(item, output_buffer);
 
-    input_buffer->offset++;
-    return true;
+        case cJSON_Raw:
+        {
+            size_t raw_length = 0;
+            if (item->valuestring == NULL)
+            {
+                return false;
+            }
 
-fail:
-    if (head != NULL)
+            raw_length = strlen(item->valuestring) + sizeof("");
+            output = ensure(output_buffer, raw_length);
+            if (output == NULL)
+            {
+                return false;
+            }
+            memcpy(output, item->valuestring, raw_length);
+            return true;
+        }
+
+        case cJSON_String:
+            return print_string(item, output_buffer);
+
+        default:
+            return false;
+    }
+}
+
+/* Append a character repeated count times, keeping the output null terminated. */
+static cJSON_bool print_repeated(printbuffer * const output_buffer, const unsigned char character, const size_t count)
+{
+    unsigned char *output_pointer = ensure(output_buffer, count + 1);
+    if (output_pointer == NULL)
     {
-        cJSON_Delete(head);
+        return false;
     }
 
-    return false;
+    memset(output_pointer, character, count);
+    output_pointer[count] = '\0';
+    output_buffer->offset += count;
+
+    return true;
 }
 
-/* Render an object to text. */
-static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer)
+/* Render the name of an object member and the ':' that follows it. */
+static cJSON_bool print_member_name(const cJSON * const item, printbuffer * const output_buffer)
 {
-    unsigned char *output_pointer = NULL;
-    size_t length = 0;
-    cJSON *current_item = item->child;
+    if (output_buffer->format && !print_repeated(output_buffer, '\t', output_buffer->depth))
+    {
+        return false;
+    }
 
-    if (output_buffer == NULL)
+    if (!print_string_ptr((unsigned char*)item->string, output_buffer))
     {
         return false;
     }
+    update_offset(output_buffer);
 
-    /* Compose the output: */
-    length = (size_t) (output_buffer->format ? 2 : 1); /* fmt: {\n */
-    output_pointer = ensure(output_buffer, length + 1);
-    if (output_pointer == NULL)
+    if (!print_repeated(output_buffer, ':', 1))
     {
         return false;
     }
 
-    *output_pointer++ = '{';
-    output_buffer->depth++;
-    if (output_buffer->format)
+    return !output_buffer->format || print_repeated(output_buffer, '\t', 1);
+}
+
+/* Render a value to text.
+ * Arrays and objects are walked without recursion. The open containers are kept on a small stack that only
+ * moves to the heap for documents nested deeper than its inline capacity. */
+static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+{
+    const cJSON *inline_stack[8];
+    const cJSON **stack = inline_stack;
+    size_t stack_capacity = sizeof(inline_stack) / sizeof(inline_stack[0]);
+    size_t stack_depth = 0;
+    const cJSON *current_item = item;
+    cJSON_bool success = false;
+
+    if ((item == NULL) || (output_buffer == NULL))
     {
-        *output_pointer++ = '\n';
+        return false;
     }
-    output_buffer->offset += length;
 
-    while (current_item)
+    for (;;)
     {
-        if (output_buffer->format)
+        const cJSON *container = NULL;
+        cJSON_bool is_object = false;
+
+        if (((current_item->type & 0xFF) == cJSON_Array) || ((current_item->type & 0xFF) == cJSON_Object))
         {
-            size_t i;
-            output_pointer = ensure(output_buffer, output_buffer->depth);
-            if (output_pointer == NULL)
+            is_object = ((current_item->type & 0xFF) == cJSON_Object);
+
+            /* opening bracket, followed by a newline for formatted objects */
+            if (!print_repeated(output_buffer, (unsigned char)(is_object ? '{' : '['), 1))
             {
-                return false;
+                goto fail;
             }
-            for (i = 0; i < output_buffer->depth; i++)
+            if (is_object && output_buffer->format && !print_repeated(output_buffer, '\n', 1))
             {
-                *output_pointer++ = '\t';
+                goto fail;
             }
-            output_buffer->offset += output_buffer->depth;
-        }
+            output_buffer->depth++;
 
-        /* print key */
-        if (!print_string_ptr((unsigned char*)current_item->string, output_buffer))
-        {
-            return false;
-        }
-        update_offset(output_buffer);
+            if (current_item->child != NULL)
+            {
+                /* descend into the first element */
+                if (stack_depth >= CJSON_CIRCULAR_LIMIT)
+                {
+                    goto fail;
+                }
+                if (stack_depth == stack_capacity)
+                {
+                    const cJSON **new_stack = (const cJSON**)output_buffer->hooks.allocate(2 * stack_capacity * sizeof(const cJSON*));
+                    if (new_stack == NULL)
+                    {
+                        goto fail;
+                    }
+                    memcpy((void*)new_stack, (const void*)stack, stack_capacity * sizeof(const cJSON*));
+                    if (stack != inline_stack)
+                    {
+                        output_buffer->hooks.deallocate((void*)stack);
+                    }
+                    stack = new_stack;
+                    stack_capacity *= 2;
+                }
+                stack[stack_depth++] = current_item;
+                current_item = current_item->child;
 
-        length = (size_t) (output_buffer->format ? 2 : 1);
-        output_pointer = ensure(output_buffer, length);
-        if (output_pointer == NULL)
-        {
-            return false;
+                if (is_object && !print_member_name(current_item, output_buffer))
+                {
+                    goto fail;
+                }
+                continue;
+            }
+
+            /* empty container, close it right away */
+            container = current_item;
         }
-        *output_pointer++ = ':';
-        if (output_buffer->format)
+        else
         {
-            *output_pointer++ = '\t';
+            if (!print_primitive(current_item, output_buffer))
+            {
+                goto fail;
+            }
+            update_offset(output_buffer);
         }
-        output_buffer->offset += length;
 
-        /* print value */
-        if (!print_value(current_item, output_buffer))
+        for (;;)
         {
-            return false;
-        }
-        update_offset(output_buffer);
+            if (container != NULL)
+            {
+                /* closing bracket, formatted objects indent it to the level of the opening one */
+                is_object = ((container->type & 0xFF) == cJSON_Object);
+                if (is_object && output_buffer->format && !print_repeated(output_buffer, '\t', output_buffer->depth - 1))
+                {
+                    goto fail;
+                }
+                if (!print_repeated(output_buffer, (unsigned char)(is_object ? '}' : ']'), 1))
+                {
+                    goto fail;
+                }
+                output_buffer->depth--;
+                current_item = container;
+            }
 
-        /* print comma if not last */
-        length = ((size_t)(output_buffer->format ? 1 : 0) + (size_t)(current_item->next ? 1 : 0));
-        output_pointer = ensure(output_buffer, length + 1);
-        if (output_pointer == NULL)
-        {
-            return false;
-        }
-        if (current_item->next)
-        {
-            *output_pointer++ = ',';
-        }
+            if (stack_depth == 0)
+            {
+                success = true;
+                goto done;
+            }
 
-        if (output_buffer->format)
-        {
-            *output_pointer++ = '\n';
-        }
-        *output_pointer = '\0';
-        output_buffer->offset += length;
+            /* current_item is complete, continue with its next sibling or close the container */
+            container = stack[stack_depth - 1];
+            is_object = ((container->type & 0xFF) == cJSON_Object);
+            if (current_item->next != NULL)
+            {
+                if (!print_repeated(output_buffer, ',', 1))
+                {
+                    goto fail;
+                }
+                if (output_buffer->format && !print_repeated(output_buffer, (unsigned char)(is_object ? '\n' : ' '), 1))
+                {
+                    goto fail;
+                }
+                current_item = current_item->next;
+                if (is_object && !print_member_name(current_item, output_buffer))
+                {
+                    goto fail;
+                }
+                break;
+            }
 
-        current_item = current_item->next;
+            if (is_object && output_buffer->format && !print_repeated(output_buffer, '\n', 1))
+            {
+                goto fail;
+            }
+            stack_depth--;
+        }
     }
 
-    output_pointer = ensure(output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
-    if (output_pointer == NULL)
-    {
-        return false;
-    }
-    if (output_buffer->format)
+fail:
+done:
+    if (stack != inline_stack)
     {
-        size_t i;
-        for (i = 0; i < (output_buffer->depth - 1); i++)
-        {
-            *output_pointer++ = '\t';
-        }
+        output_buffer->hooks.deallocate((void*)stack);
     }
-    *output_pointer++ = '}';
-    *output_pointer = '\0';
-    output_buffer->depth--;
 
-    return true;
+    return success;
 }
 
 /* Get Array size/item / object item. */
@@ -2004,11 +2934,155 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
 
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
-    reference->type |= cJSON_IsReference;
+    /* a reference doesn't hold the list it points to, even a shared one */
+    reference->type = (reference->type | cJSON_IsReference) & ~cJSON_ChildIsShared;
     reference->next = reference->prev = NULL;
     return reference;
 }
 
+/* Copy item without copying what is below it: strings are copied, the child list is shared with item. */
+static cJSON *share_item(cJSON * const item, const internal_hooks * const hooks)
+{
+    shared_children *shared = NULL;
+    cJSON *old_first = NULL;
+    cJSON *copy = cJSON_New_Item(hooks);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+
+    copy->type = item->type;
+    copy->valueint = item->valueint;
+    copy->valuedouble = item->valuedouble;
+    copy->valueint64 = item->valueint64;
+    if (item->string != NULL)
+    {
+        copy->string = (item->type & cJSON_StringIsConst) ? item->string : (char*)cJSON_strdup((unsigned char*)item->string, hooks);
+        if (copy->string == NULL)
+        {
+            goto fail;
+        }
+    }
+    if (item->type & cJSON_IsReference)
+    {
+        /* references don't own what they point to, so they can simply be copied */
+        copy->valuestring = item->valuestring;
+        copy->child = item->child;
+        return copy;
+    }
+    if (item->valuestring != NULL)
+    {
+        copy->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, hooks);
+        if (copy->valuestring == NULL)
+        {
+            goto fail;
+        }
+    }
+    if (item->child != NULL)
+    {
+        if (!(item->type & cJSON_ChildIsShared))
+        {
+            shared = (shared_children*)hooks->allocate(sizeof(shared_children));
+            if (shared == NULL)
+            {
+                goto fail;
+            }
+            old_first = item->child;
+            move_first_child(item, &shared->first);
+            hooks->deallocate(old_first);
+            shared->references = 1;
+            item->type |= cJSON_ChildIsShared;
+        }
+        get_shared_children(item)->references++;
+        copy->child = item->child;
+        copy->type |= cJSON_ChildIsShared;
+    }
+
+    return copy;
+
+fail:
+    cJSON_Delete(copy);
+
+    return NULL;
+}
+
+/* Make sure the child list of parent is not shared with any other array/object, copying it if it is.
+ * If item is given, it is updated to point to the element at the same position in the new list. */
+static cJSON_bool unshare_children(cJSON * const parent, cJSON ** const item)
+{
+    shared_children *shared = NULL;
+    cJSON *child = NULL;
+    cJSON *copy = NULL;
+    cJSON *head = NULL;
+    size_t index = 0;
+
+    if (!(parent->type & cJSON_ChildIsShared))
+    {
+        return true;
+    }
+    shared = get_shared_children(parent);
+    if (shared->references == 1)
+    {
+        /* all other copies are gone, the first element only has to move out of the shared block */
+        child = cJSON_New_Item(&global_hooks);
+        if (child == NULL)
+        {
+            return false;
+        }
+        move_first_child(parent, child);
+        if ((item != NULL) && (*item == &shared->first))
+        {
+            *item = child;
+        }
+        global_hooks.deallocate(shared);
+        parent->type &= ~cJSON_ChildIsShared;
+        return true;
+    }
+
+    if ((item != NULL) && (*item != NULL))
+    {
+        for (child = parent->child; (child != NULL) && (child != *item); child = child->next)
+        {
+            index++;
+        }
+        if (child == NULL)
+        {
+            return false; /* item is not in the list */
+        }
+    }
+
+    for (child = parent->child; child != NULL; child = child->next)
+    {
+        copy = share_item(child, &global_hooks);
+        if (copy == NULL)
+        {
+            cJSON_Delete(head);
+            return false;
+        }
+        if (head == NULL)
+        {
+            head = copy;
+        }
+        else
+        {
+            head->prev->next = copy;
+            copy->prev = head->prev;
+        }
+        head->prev = copy;
+    }
+
+    shared->references--;
+    parent->type &= ~cJSON_ChildIsShared;
+    parent->child = head;
+
+    if ((item != NULL) && (*item != NULL))
+    {
+        *item = get_array_item(parent, index);
+    }
+
+    return true;
+}
+
 static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
 {
     cJSON *child = NULL;
@@ -2018,6 +3092,11 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         return false;
     }
 
+    if (!unshare_children(array, NULL))
+    {
+        return false;
+    }
+
     child = array->child;
     /*
      * To find the last item in array quickly, we use prev in array
@@ -2192,6 +3271,18 @@ CJSON_PUBLIC(cJSON*) cJSON_AddNumberToObject(cJSON * const object, const char *
     return NULL;
 }
 
+CJSON_PUBLIC(cJSON*) cJSON_AddInt64ToObject(cJSON * const object, const char * const name, const cJSON_int64 number)
+{
+    cJSON *number_item = cJSON_CreateInt64(number);
+    if (add_item_to_object(object, name, number_item, &global_hooks, false))
+    {
+        return number_item;
+    }
+
+    cJSON_Delete(number_item);
+    return NULL;
+}
+
 CJSON_PUBLIC(cJSON*) cJSON_AddStringToObject(cJSON * const object, const char * const name, const char * const string)
 {
     cJSON *string_item = cJSON_CreateString(string);
@@ -2240,9 +3331,13 @@ CJSON_PUBLIC(cJSON*) cJSON_AddArrayToObject(cJSON * const object, const char * c
     return NULL;
 }
 
-CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const item)
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON *item)
 {
-    if ((parent == NULL) || (item == NULL) || (item != parent->child && item->prev == NULL))
+    if ((parent == NULL) || (item == NULL) || !unshare_children(parent, &item))
+    {
+        return NULL;
+    }
+    if (item != parent->child && item->prev == NULL)
     {
         return NULL;
     }
@@ -2325,6 +3420,11 @@ CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON
         return false;
     }
 
+    if ((array != NULL) && !unshare_children(array, NULL))
+    {
+        return false;
+    }
+
     after_inserted = get_array_item(array, (size_t)which);
     if (after_inserted == NULL)
     {
@@ -2350,13 +3450,18 @@ CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON
     return true;
 }
 
-CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON * const item, cJSON * replacement)
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON *item, cJSON * replacement)
 {
     if ((parent == NULL) || (parent->child == NULL) || (replacement == NULL) || (item == NULL))
     {
         return false;
     }
 
+    if (!unshare_children(parent, &item))
+    {
+        return false;
+    }
+
     if (replacement == item)
     {
         return true;
@@ -2513,6 +3618,17 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
     return item;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_CreateInt64(cJSON_int64 num)
+{
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        set_int64(item, num);
+    }
+
+    return item;
+}
+
 CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
 {
     cJSON *item = cJSON_New_Item(&global_hooks);
@@ -2771,6 +3887,31 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
     return cJSON_Duplicate_rec(item, 0, recurse );
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_DuplicateShared(cJSON *item)
+{
+    if (item == NULL)
+    {
+        return NULL;
+    }
+    if (item->type & cJSON_IsReference)
+    {
+        /* the copy has to own its children, which the reference doesn't */
+        return cJSON_Duplicate(item, true);
+    }
+
+    return share_item(item, &global_hooks);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_Unshare(cJSON *item)
+{
+    if (item == NULL)
+    {
+        return false;
+    }
+
+    return unshare_children(item, NULL);
+}
+
 cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
 {
     cJSON *newitem = NULL;
@@ -2790,9 +3931,10 @@ cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
         goto fail;
     }
     /* Copy over all vars */
-    newitem->type = item->type & (~cJSON_IsReference);
+    newitem->type = item->type & (~(cJSON_IsReference | cJSON_ChildIsShared));
     newitem->valueint = item->valueint;
     newitem->valuedouble = item->valuedouble;
+    newitem->valueint64 = item->valueint64;
     if (item->valuestring)
     {
         newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &global_hooks);
@@ -2828,80 +3970,193 @@ cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
         }
         if (next != NULL)
         {
-            /* If newitem->child already set, then crosswire ->prev and ->next and move on */
-            next->next = newchild;
-            newchild->prev = next;
-            next = newchild;
+            /* If newitem->child already set, then crosswire ->prev and ->next and move on */
+            next->next = newchild;
+            newchild->prev = next;
+            next = newchild;
+        }
+        else
+        {
+            /* Set newitem->child and move to it */
+            newitem->child = newchild;
+            next = newchild;
+        }
+        child = child->next;
+    }
+    if (newitem && newitem->child)
+    {
+        newitem->child->prev = newchild;
+    }
+
+    return newitem;
+
+fail:
+    if (newitem != NULL)
+    {
+        cJSON_Delete(newitem);
+    }
+
+    return NULL;
+}
+
+/* Minify looks at the input a machine word at a time: a word that contains none of the bytes it has to act on is
+ * copied as a whole. These masks have 0x01 and 0x80 in every byte of a word. */
+#define MINIFY_LOW_BITS (((size_t)-1) / 0xFF)
+#define MINIFY_HIGH_BITS (MINIFY_LOW_BITS * 0x80)
+/* non-zero if a byte of word is below n (n <= 128), or is zero */
+#define word_has_less(word, n) (((word) - MINIFY_LOW_BITS * (n)) & ~(word) & MINIFY_HIGH_BITS)
+#define word_has_zero(word) word_has_less(word, 1)
+#define word_has_byte(word, byte) word_has_zero((word) ^ (MINIFY_LOW_BITS * (byte)))
+
+/* true for the bytes minify has to act on outside of strings */
+static cJSON_bool is_minify_special(const char c)
+{
+    switch (c)
+    {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+        case '/':
+        case '\"':
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/* Copy bytes that are kept as they are outside of strings, stopping at whitespace, '/', '\"' or end. */
+static void copy_plain_bytes(char **input, char **output, const char * const end)
+{
+    size_t word = 0;
+    size_t count = 0;
+
+    /* most runs are short tokens, so only switch to whole words once a run turns out to be long */
+    for (; (*input < end) && (count < sizeof(word)); (void)++(*input), (void)++(*output), count++)
+    {
+        if (is_minify_special((*input)[0]))
+        {
+            return;
         }
-        else
+        (*output)[0] = (*input)[0];
+    }
+
+    /* whitespace and '\"' are all below '#', so one comparison covers them */
+    while ((size_t)(end - *input) >= sizeof(word))
+    {
+        memcpy(&word, *input, sizeof(word));
+        if (word_has_less(word, (size_t)'#') || word_has_byte(word, (size_t)'/'))
         {
-            /* Set newitem->child and move to it */
-            newitem->child = newchild;
-            next = newchild;
+            break;
         }
-        child = child->next;
+        /* output never runs ahead of the input, so this only overwrites bytes that were already read */
+        memcpy(*output, &word, sizeof(word));
+        *input += sizeof(word);
+        *output += sizeof(word);
     }
-    if (newitem && newitem->child)
+
+    for (; (*input < end) && !is_minify_special((*input)[0]); (void)++(*input), ++(*output))
     {
-        newitem->child->prev = newchild;
+        (*output)[0] = (*input)[0];
     }
+}
 
-    return newitem;
+/* Copy bytes inside a string literal, stopping at '\"', '\\' or end. */
+static void copy_string_bytes(char **input, char **output, const char * const end)
+{
+    size_t word = 0;
+    size_t count = 0;
 
-fail:
-    if (newitem != NULL)
+    for (; (*input < end) && (count < sizeof(word)); (void)++(*input), (void)++(*output), count++)
     {
-        cJSON_Delete(newitem);
+        if (((*input)[0] == '\"') || ((*input)[0] == '\\'))
+        {
+            return;
+        }
+        (*output)[0] = (*input)[0];
     }
 
-    return NULL;
+    while ((size_t)(end - *input) >= sizeof(word))
+    {
+        memcpy(&word, *input, sizeof(word));
+        if (word_has_byte(word, (size_t)'\"') || word_has_byte(word, (size_t)'\\'))
+        {
+            break;
+        }
+        memcpy(*output, &word, sizeof(word));
+        *input += sizeof(word);
+        *output += sizeof(word);
+    }
+
+    for (; (*input < end) && ((*input)[0] != '\"') && ((*input)[0] != '\\'); (void)++(*input), ++(*output))
+    {
+        (*output)[0] = (*input)[0];
+    }
 }
 
-static void skip_oneline_comment(char **input)
+static void skip_oneline_comment(char **input, const char * const end)
 {
+    const char *newline = NULL;
+
     *input += static_strlen("//");
 
-    for (; (*input)[0] != '\0'; ++(*input))
+    newline = (const char*)memchr(*input, '\n', (size_t)(end - *input));
+    if (newline == NULL)
     {
-        if ((*input)[0] == '\n') {
-            *input += static_strlen("\n");
-            return;
-        }
+        *input += end - *input;
+        return;
     }
+    *input += newline - *input;
+    *input += static_strlen("\n");
 }
 
-static void skip_multiline_comment(char **input)
+static void skip_multiline_comment(char **input, const char * const end)
 {
+    const char *star = NULL;
+
     *input += static_strlen("/*");
 
-    for (; (*input)[0] != '\0'; ++(*input))
+    for (;;)
     {
-        if (((*input)[0] == '*') && ((*input)[1] == '/'))
+        star = (const char*)memchr(*input, '*', (size_t)(end - *input));
+        if (star == NULL)
+        {
+            *input += end - *input;
+            return;
+        }
+        *input += star - *input;
+        if ((*input)[1] == '/')
         {
             *input += static_strlen("*/");
             return;
         }
+        ++(*input);
     }
 }
 
-static void minify_string(char **input, char **output) {
+static void minify_string(char **input, char **output, const char * const end) {
     (*output)[0] = (*input)[0];
     *input += static_strlen("\"");
     *output += static_strlen("\"");
 
-
-    for (; (*input)[0] != '\0'; (void)++(*input), ++(*output)) {
-        (*output)[0] = (*input)[0];
+    while ((*input)[0] != '\0') {
+        copy_string_bytes(input, output, end);
 
         if ((*input)[0] == '\"') {
             (*output)[0] = '\"';
             *input += static_strlen("\"");
             *output += static_strlen("\"");
             return;
-        } else if (((*input)[0] == '\\') && ((*input)[1] == '\"')) {
-            (*output)[1] = (*input)[1];
-            *input += static_strlen("\"");
-            *output += static_strlen("\"");
+        } else if ((*input)[0] == '\\') {
+            (*output)[0] = (*input)[0];
+            if ((*input)[1] == '\"') {
+                (*output)[1] = (*input)[1];
+                *input += static_strlen("\"");
+                *output += static_strlen("\"");
+            }
+            ++(*input);
+            ++(*output);
         }
     }
 }
@@ -2909,12 +4164,15 @@ static void minify_string(char **input, char **output) {
 CJSON_PUBLIC(void) cJSON_Minify(char *json)
 {
     char *into = json;
+    const char *end = NULL;
 
     if (json == NULL)
     {
         return;
     }
 
+    end = json + strlen(json);
+
     while (json[0] != '\0')
     {
         switch (json[0])
@@ -2929,24 +4187,23 @@ CJSON_PUBLIC(void) cJSON_Minify(char *json)
             case '/':
                 if (json[1] == '/')
                 {
-                    skip_oneline_comment(&json);
+                    skip_oneline_comment(&json, end);
                 }
                 else if (json[1] == '*')
                 {
-                    skip_multiline_comment(&json);
+                    skip_multiline_comment(&json, end);
                 } else {
                     json++;
                 }
                 break;
 
             case '\"':
-                minify_string(&json, (char**)&into);
+                minify_string(&json, (char**)&into, end);
                 break;
 
             default:
-                into[0] = json[0];
-                json++;
-                into++;
+                /* copy the whole run up to the next byte that needs a decision */
+                copy_plain_bytes(&json, &into, end);
         }
     }
 
@@ -3093,6 +4350,10 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
             return true;
 
         case cJSON_Number:
+            if (has_exact_int64(a) && has_exact_int64(b))
+            {
+                return a->valueint64 == b->valueint64;
+            }
             if (compare_double(a->valuedouble, b->valuedouble))
             {
                 return true;
@@ -3117,6 +4378,11 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
             cJSON *a_element = a->child;
             cJSON *b_element = b->child;
 
+            if (a_element == b_element)
+            {
+                return true; /* the same list, e.g. shared by cJSON_DuplicateShared */
+            }
+
             for (; (a_element != NULL) && (b_element != NULL);)
             {
                 if (!cJSON_Compare(a_element, b_element, case_sensitive))
@@ -3140,6 +4406,12 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
         {
             cJSON *a_element = NULL;
             cJSON *b_element = NULL;
+
+            if (a->child == b->child)
+            {
+                return true; /* the same list, e.g. shared by cJSON_DuplicateShared */
+            }
+
             cJSON_ArrayForEach(a_element, a)
             {
                 /* TODO This has O(n^2) runtime, which is horrible! */
@@ -3179,6 +4451,319 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
     }
 }
 
+/* FNV-1a over length bytes, with ASCII letters folded to lower case if lowercase is set */
+static uint32_t hash_bytes(uint32_t hash, const unsigned char *bytes, size_t length, const cJSON_bool lowercase)
+{
+    size_t i = 0;
+    for (i = 0; i < length; i++)
+    {
+        hash ^= lowercase ? (uint32_t)tolower(bytes[i]) : (uint32_t)bytes[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/* spread the bits of a combined hash, so sums and products of member hashes don't cancel out */
+static uint32_t mix_hash(uint32_t hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+static uint32_t get_item_hash(const cJSON * const item, const size_t depth);
+
+/* hash of an object member, covering its key (in lower case) and its value */
+static uint32_t get_member_hash(const cJSON * const member, const size_t depth)
+{
+    uint32_t key_hash = 2166136261U;
+    if (member->string != NULL)
+    {
+        key_hash = hash_bytes(key_hash, (const unsigned char*)member->string, strlen(member->string), true);
+    }
+
+    return mix_hash(key_hash ^ (get_item_hash(member, depth) * 0x9e3779b1U));
+}
+
+/* Compute the structural hash of item and everything below it.
+ * Keys are hashed in lower case, so the hash works for case sensitive and insensitive compares. */
+static uint32_t get_item_hash(const cJSON * const item, const size_t depth)
+{
+    uint32_t hash = 2166136261U ^ (uint32_t)(item->type & 0xFF);
+    uint32_t members = 0;
+    uint32_t count = 0;
+    const cJSON *child = NULL;
+    double number = 0;
+
+    switch (item->type & 0xFF)
+    {
+        case cJSON_Number:
+            /* exact compare, so -0 and 0 have to hash alike */
+            number = (item->valuedouble == 0) ? 0 : item->valuedouble;
+            hash = hash_bytes(hash, (const unsigned char*)&number, sizeof(number), false);
+            break;
+
+        case cJSON_String:
+        case cJSON_Raw:
+            if (item->valuestring != NULL)
+            {
+                hash = hash_bytes(hash, (const unsigned char*)item->valuestring, strlen(item->valuestring), false);
+            }
+            break;
+
+        case cJSON_Array:
+            if (depth >= CJSON_CIRCULAR_LIMIT)
+            {
+                return hash; /* the compare will look at the elements */
+            }
+            for (child = item->child; child != NULL; child = child->next)
+            {
+                hash = mix_hash((hash * 31U) ^ get_item_hash(child, depth + 1));
+            }
+            break;
+
+        case cJSON_Object:
+            if (depth >= CJSON_CIRCULAR_LIMIT)
+            {
+                return hash;
+            }
+            /* adding up the member hashes makes the result independent of the order */
+            for (child = item->child; child != NULL; child = child->next)
+            {
+                members += get_member_hash(child, depth + 1);
+                count++;
+            }
+            hash = mix_hash(hash ^ members ^ (count * 0x27d4eb2dU));
+            break;
+
+        default:
+            hash = mix_hash(hash);
+            break;
+    }
+
+    return hash;
+}
+
+static cJSON_bool keys_equal(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive)
+{
+    if ((a->string == NULL) || (b->string == NULL))
+    {
+        return false;
+    }
+    if (case_sensitive)
+    {
+        return strcmp(a->string, b->string) == 0;
+    }
+
+    return case_insensitive_strcmp((const unsigned char*)a->string, (const unsigned char*)b->string) == 0;
+}
+
+typedef struct
+{
+    uint32_t hash;
+    const cJSON *member;
+} hashed_member;
+
+static int compare_member_hashes(const void *a, const void *b)
+{
+    const uint32_t a_hash = ((const hashed_member*)a)->hash;
+    const uint32_t b_hash = ((const hashed_member*)b)->hash;
+
+    return (a_hash > b_hash) - (a_hash < b_hash);
+}
+
+static cJSON_bool compare_hashed(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive);
+
+/* Compare the members of two objects that are in different orders by sorting both by member hash.
+ * Returns -1 if that is not possible (out of memory, or members with equal hashes that don't match up). */
+static int compare_sorted_members(const cJSON *a_element, const cJSON *b_element, const cJSON_bool case_sensitive)
+{
+    hashed_member *members = NULL;
+    size_t count = 0;
+    size_t i = 0;
+    int result = true;
+    const cJSON *element = NULL;
+
+    for (element = a_element; element != NULL; element = element->next)
+    {
+        count++;
+    }
+    for (element = b_element; element != NULL; element = element->next)
+    {
+        if (i++ == count)
+        {
+            return false; /* b has more members */
+        }
+    }
+    if (i != count)
+    {
+        return false;
+    }
+
+    members = (hashed_member*)global_hooks.allocate(2 * count * sizeof(hashed_member));
+    if (members == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; a_element != NULL; i++, a_element = a_element->next, b_element = b_element->next)
+    {
+        members[i].hash = get_member_hash(a_element, 0);
+        members[i].member = a_element;
+        members[count + i].hash = get_member_hash(b_element, 0);
+        members[count + i].member = b_element;
+    }
+    qsort(members, count, sizeof(hashed_member), compare_member_hashes);
+    qsort(members + count, count, sizeof(hashed_member), compare_member_hashes);
+
+    for (i = 0; (i < count) && (result == true); i++)
+    {
+        if (members[i].hash != members[count + i].hash)
+        {
+            result = false;
+        }
+        else if (!keys_equal(members[i].member, members[count + i].member, case_sensitive) || !compare_hashed(members[i].member, members[count + i].member, case_sensitive))
+        {
+            /* a collision or case folded keys, let the caller decide */
+            result = -1;
+        }
+    }
+
+    global_hooks.deallocate(members);
+
+    return result;
+}
+
+/* Confirm that two trees with equal hashes are equal. Objects whose members are in different orders are matched up
+ * by member hash instead of looking up every key. */
+static cJSON_bool compare_hashed(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive)
+{
+    int sorted = 0;
+
+    const cJSON *a_element = NULL;
+    const cJSON *b_element = NULL;
+
+    if ((a->type & 0xFF) != (b->type & 0xFF))
+    {
+        return false;
+    }
+    if (a == b)
+    {
+        return true;
+    }
+
+    switch (a->type & 0xFF)
+    {
+        case cJSON_False:
+        case cJSON_True:
+        case cJSON_NULL:
+            return true;
+
+        case cJSON_Number:
+            if (has_exact_int64(a) && has_exact_int64(b))
+            {
+                return a->valueint64 == b->valueint64;
+            }
+            return a->valuedouble == b->valuedouble;
+
+        case cJSON_String:
+        case cJSON_Raw:
+            if ((a->valuestring == NULL) || (b->valuestring == NULL))
+            {
+                return false;
+            }
+            return strcmp(a->valuestring, b->valuestring) == 0;
+
+        case cJSON_Array:
+            a_element = a->child;
+            b_element = b->child;
+            if (a_element == b_element)
+            {
+                return true;
+            }
+            for (; (a_element != NULL) && (b_element != NULL); a_element = a_element->next, b_element = b_element->next)
+            {
+                if (!compare_hashed(a_element, b_element, case_sensitive))
+                {
+                    return false;
+                }
+            }
+            return a_element == b_element;
+
+        case cJSON_Object:
+            a_element = a->child;
+            b_element = b->child;
+            if (a_element == b_element)
+            {
+                return true;
+            }
+            /* usually both sides have their members in the same order */
+            for (; (a_element != NULL) && (b_element != NULL) && keys_equal(a_element, b_element, case_sensitive); a_element = a_element->next, b_element = b_element->next)
+            {
+                if (!compare_hashed(a_element, b_element, case_sensitive))
+                {
+                    return false;
+                }
+            }
+            if ((a_element == NULL) && (b_element == NULL))
+            {
+                return true;
+            }
+
+            /* otherwise match the rest up by hash */
+            sorted = compare_sorted_members(a_element, b_element, case_sensitive);
+            if (sorted != -1)
+            {
+                return (cJSON_bool)sorted;
+            }
+
+            /* or, if that doesn't settle it, look every member up on the other side */
+            cJSON_ArrayForEach(a_element, a)
+            {
+                b_element = get_object_item(b, a_element->string, case_sensitive);
+                if ((b_element == NULL) || !compare_hashed(a_element, b_element, case_sensitive))
+                {
+                    return false;
+                }
+            }
+            cJSON_ArrayForEach(b_element, b)
+            {
+                if (get_object_item(a, b_element->string, case_sensitive) == NULL)
+                {
+                    return false;
+                }
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+CJSON_PUBLIC(uint32_t) cJSON_Hash(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return 0;
+    }
+
+    return get_item_hash(item, 0);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_CompareHashed(const cJSON * const a, const uint32_t a_hash, const cJSON * const b, const uint32_t b_hash, const cJSON_bool case_sensitive)
+{
+    if ((a == NULL) || (b == NULL) || (a_hash != b_hash))
+    {
+        return false;
+    }
+
+    return compare_hashed(a, b, case_sensitive);
+}
+
 CJSON_PUBLIC(void *) cJSON_malloc(size_t size)
 {
     return global_hooks.allocate(size);
@@ -84,6 +84,7 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 #define CJSON_VERSION_PATCH 18
 
 #include <stddef.h>
+#include <stdint.h>
 
 /* cJSON Types: */
 #define cJSON_Invalid (0)
@@ -98,6 +99,10 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
+#define cJSON_NumberIsInt64 1024 /* valueint64 holds the exact value of this number */
+#define cJSON_ChildIsShared 2048 /* the child list is shared with copies made by cJSON_DuplicateShared */
+
+typedef int64_t cJSON_int64;
 
 /* The cJSON structure: */
 typedef struct cJSON
@@ -120,6 +125,14 @@ typedef struct cJSON
 
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+
+    /* Size of the buffer valuestring points to, when cJSON knows it to be larger than strlen(valuestring) + 1.
+     * 0 means strlen(valuestring) + 1. If you assign valuestring yourself, set this to 0. */
+    size_t valuestring_capacity;
+
+    /* The item's exact integer value, if type has cJSON_NumberIsInt64 set. valuedouble and valueint are kept in sync (rounded/saturated);
+     * once valuedouble is assigned something else directly, valuedouble is the value. */
+    cJSON_int64 valueint64;
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -131,6 +144,10 @@ typedef struct cJSON_Hooks
 
 typedef int cJSON_bool;
 
+/* Receives successive pieces of printed JSON from cJSON_PrintToSink. The chunk is not null terminated and is
+ * only valid during the call. Return 0 to abort printing. */
+typedef cJSON_bool (*cJSON_PrintSink)(const char *chunk, size_t length, void *user_data);
+
 /* Limits how deeply nested arrays/objects can be before cJSON rejects to parse them.
  * This is to prevent stack overflows. */
 #ifndef CJSON_NESTING_LIMIT
@@ -158,6 +175,33 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Parse value into an existing document, reusing its nodes and string buffers. When the new text has the same shape
+ * as the old contents (the usual case for messages of a fixed format), nothing is allocated; where it diverges, nodes
+ * and strings are allocated or freed as needed. The document node itself stays in place, keeping its key and its
+ * siblings. Pointers into the old contents become invalid.
+ * Returns 1 on success. On failure the document is left empty with type cJSON_Invalid and cJSON_GetErrorPtr() points
+ * to the error. */
+CJSON_PUBLIC(cJSON_bool) cJSON_ParseInto(cJSON *document, const char *value, size_t buffer_length);
+
+/* Parse a buffer holding several documents, separated by newlines (NDJSON) or simply concatenated, and hand each
+ * one to callback in turn. The tree passed to the callback is only valid during the call: its nodes and string
+ * buffers are reused for the next document, so a batch costs about one parse setup. Detach anything you want to
+ * keep. Returning 0 from the callback stops parsing.
+ * Returns 1 when the whole buffer (or everything up to where the callback stopped) was parsed, and 0 on a parse
+ * error, in which case return_parse_end and cJSON_GetErrorPtr() point to the error. */
+typedef cJSON_bool (*cJSON_DocumentCallback)(cJSON *document, size_t index, void *user_data);
+CJSON_PUBLIC(cJSON_bool) cJSON_ParseMultiple(const char *value, size_t buffer_length, cJSON_DocumentCallback callback, void *user_data, const char **return_parse_end);
+
+/* Projection parsing: only object members named in a key filter end up in the tree, everything else is skipped
+ * without allocating nodes or strings (skipped values are only checked for balanced brackets and strings).
+ * Paths are member names separated by '/', e.g. "/cmd" or "/args/brightness". A path keeps the whole value it ends
+ * at; arrays are transparent, the filter applies to every element. Names are compared with their spelling in the
+ * input, escape sequences are not decoded. */
+typedef struct cJSON_KeyFilter cJSON_KeyFilter;
+CJSON_PUBLIC(cJSON_KeyFilter *) cJSON_CreateKeyFilter(const char * const *paths, int count);
+CJSON_PUBLIC(void) cJSON_DeleteKeyFilter(cJSON_KeyFilter *filter);
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithFilter(const char *value, size_t buffer_length, const cJSON_KeyFilter *filter);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
@@ -167,6 +211,11 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+/* Render a cJSON entity to text in pieces of at most chunk_size bytes, handing each one to sink as soon as it is full.
+ * Only one chunk_size buffer is allocated, so memory use does not depend on the size of the document. A single
+ * string or number longer than chunk_size still has to be rendered in one piece and grows the buffer to fit it.
+ * Returns 1 on success and 0 on failure or when the sink aborted. */
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintToSink(const cJSON *item, size_t chunk_size, const cJSON_bool format, cJSON_PrintSink sink, void *user_data);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 
@@ -184,6 +233,8 @@ CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
 /* Check item type and return its value */
 CJSON_PUBLIC(char *) cJSON_GetStringValue(const cJSON * const item);
 CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item);
+/* Returns the exact value of integers parsed or created as int64, otherwise valuedouble saturated to the int64 range (0 for non-numbers). */
+CJSON_PUBLIC(cJSON_int64) cJSON_GetInt64Value(const cJSON * const item);
 
 /* These functions check the type of an item */
 CJSON_PUBLIC(cJSON_bool) cJSON_IsInvalid(const cJSON * const item);
@@ -203,6 +254,8 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateTrue(void);
 CJSON_PUBLIC(cJSON *) cJSON_CreateFalse(void);
 CJSON_PUBLIC(cJSON *) cJSON_CreateBool(cJSON_bool boolean);
 CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num);
+/* Create a number that keeps all 64 bits of an integer and is printed without going through double. */
+CJSON_PUBLIC(cJSON *) cJSON_CreateInt64(cJSON_int64 num);
 CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string);
 /* raw json */
 CJSON_PUBLIC(cJSON *) cJSON_CreateRaw(const char *raw);
@@ -236,7 +289,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToArray(cJSON *array, cJSON *item
 CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToObject(cJSON *object, const char *string, cJSON *item);
 
 /* Remove/Detach items from Arrays/Objects. */
-CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const item);
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON *item);
 CJSON_PUBLIC(cJSON *) cJSON_DetachItemFromArray(cJSON *array, int which);
 CJSON_PUBLIC(void) cJSON_DeleteItemFromArray(cJSON *array, int which);
 CJSON_PUBLIC(cJSON *) cJSON_DetachItemFromObject(cJSON *object, const char *string);
@@ -246,7 +299,7 @@ CJSON_PUBLIC(void) cJSON_DeleteItemFromObjectCaseSensitive(cJSON *object, const
 
 /* Update array items. */
 CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem); /* Shifts pre-existing items to the right. */
-CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON * const item, cJSON * replacement);
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON *item, cJSON * replacement);
 CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInArray(cJSON *array, int which, cJSON *newitem);
 CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObject(cJSON *object,const char *string,cJSON *newitem);
 CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObjectCaseSensitive(cJSON *object,const char *string,cJSON *newitem);
@@ -256,9 +309,29 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse);
 /* Duplicate will create a new, identical cJSON item to the one you pass, in new memory that will
  * need to be released. With recurse!=0, it will duplicate any children connected to the item.
  * The item->next and ->prev pointers are always zero on return from Duplicate. */
+/* Duplicate item in O(1): the copy shares the child list with item until one of them is changed (copy on write).
+ * The first time item's list is shared, its first element is moved into a block with the reference count, so
+ * pointers to that element and references to item made before the call become invalid.
+ * Before changing anything below the copy or the original, call cJSON_Unshare on every array/object on the path to
+ * it, starting at the root; only that path is copied, one level at a time. Functions that take the array/object
+ * being changed (Add, Insert, Detach, Delete, Replace) unshare its child list themselves, but the array/object
+ * itself must already have been reached through unshared parents. Items that were obtained from a shared list before
+ * it was unshared still belong to the other copies.
+ * Sharing is not thread safe: all copies have to be used from the same thread or under the same lock. */
+CJSON_PUBLIC(cJSON *) cJSON_DuplicateShared(cJSON *item);
+/* Give item its own copy of its child list, if it shares it. The children of that list are shared in turn. */
+CJSON_PUBLIC(cJSON_bool) cJSON_Unshare(cJSON *item);
 /* Recursively compare two cJSON items for equality. If either a or b is NULL or invalid, they will be considered unequal.
  * case_sensitive determines if object keys are treated case sensitive (1) or case insensitive (0) */
 CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive);
+/* Structural hash of item and everything below it, for cJSON_CompareHashed. Object hashes don't depend on member order,
+ * and keys are hashed in lower case, so one hash serves case sensitive and insensitive compares. */
+CJSON_PUBLIC(uint32_t) cJSON_Hash(const cJSON * const item);
+/* Like cJSON_Compare, given the hashes of a and b from cJSON_Hash: different hashes settle it in O(1). Keep the hash of
+ * a tree you compare against often next to it, and compute it again whenever you change that tree; nothing in the tree
+ * remembers it. Equal hashes are confirmed by comparing the trees, with object members in different orders matched up
+ * by hash. Unlike cJSON_Compare, numbers have to be exactly equal. */
+CJSON_PUBLIC(cJSON_bool) cJSON_CompareHashed(const cJSON * const a, const uint32_t a_hash, const cJSON * const b, const uint32_t b_hash, const cJSON_bool case_sensitive);
 
 /* Minify a strings, remove blank characters(such as ' ', '\t', '\r', '\n') from strings.
  * The input pointer json cannot point to a read-only address area, such as a string constant, 
@@ -272,17 +345,22 @@ CJSON_PUBLIC(cJSON*) cJSON_AddTrueToObject(cJSON * const object, const char * co
 CJSON_PUBLIC(cJSON*) cJSON_AddFalseToObject(cJSON * const object, const char * const name);
 CJSON_PUBLIC(cJSON*) cJSON_AddBoolToObject(cJSON * const object, const char * const name, const cJSON_bool boolean);
 CJSON_PUBLIC(cJSON*) cJSON_AddNumberToObject(cJSON * const object, const char * const name, const double number);
+CJSON_PUBLIC(cJSON*) cJSON_AddInt64ToObject(cJSON * const object, const char * const name, const cJSON_int64 number);
 CJSON_PUBLIC(cJSON*) cJSON_AddStringToObject(cJSON * const object, const char * const name, const char * const string);
 CJSON_PUBLIC(cJSON*) cJSON_AddRawToObject(cJSON * const object, const char * const name, const char * const raw);
 CJSON_PUBLIC(cJSON*) cJSON_AddObjectToObject(cJSON * const object, const char * const name);
 CJSON_PUBLIC(cJSON*) cJSON_AddArrayToObject(cJSON * const object, const char * const name);
 
 /* When assigning an integer value, it needs to be propagated to valuedouble too. */
-#define cJSON_SetIntValue(object, number) ((object) ? (object)->valueint = (object)->valuedouble = (number) : (number))
+#define cJSON_SetIntValue(object, number) ((object) ? ((object)->type &= ~cJSON_NumberIsInt64, (object)->valueint = (object)->valuedouble = (number)) : (number))
 /* helper for the cJSON_SetNumberValue macro */
 CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number);
 #define cJSON_SetNumberValue(object, number) ((object != NULL) ? cJSON_SetNumberHelper(object, (double)number) : (number))
-/* Change the valuestring of a cJSON_String object, only takes effect when type of object is cJSON_String */
+/* Set the exact 64 bit integer value of a number, updating valuedouble and valueint as well. */
+CJSON_PUBLIC(cJSON_int64) cJSON_SetInt64Value(cJSON *object, const cJSON_int64 number);
+/* Change the valuestring of a cJSON_String object, only takes effect when type of object is cJSON_String.
+ * The string is updated in place while it fits the buffer; when it has to grow, the buffer at least doubles, so a
+ * long-lived document that is updated over and over stops allocating. */
 CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring);
 
 /* If the object is not a boolean type this does nothing and returns cJSON_Invalid else it returns the new type*/
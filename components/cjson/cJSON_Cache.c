@@ -0,0 +1,280 @@
+#include <string.h>
+
+#include "cJSON_Cache.h"
+
+typedef struct
+{
+    unsigned long hash;
+    size_t length;
+    char *payload; /* private copy to verify hits against */
+    cJSON *document;
+    size_t bytes;
+    unsigned long last_used; /* value of the cache's use counter at the last hit, 0 for an empty slot */
+} cache_entry;
+
+struct cJSONCache
+{
+    cache_entry *entries;
+    size_t max_entries;
+    size_t max_bytes;
+    unsigned long use_counter;
+    /* a document too big to be cached, kept until the next call so the caller can still read it */
+    cJSON *uncached;
+    cJSONCache_Stats stats;
+};
+
+/* FNV-1a, cheap enough to run over every incoming payload */
+static unsigned long hash_payload(const unsigned char *payload, size_t length)
+{
+    unsigned long hash = 2166136261UL;
+    size_t i = 0;
+
+    for (i = 0; i < length; i++)
+    {
+        hash ^= payload[i];
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    return hash;
+}
+
+/* memory held by a tree: nodes plus the string buffers they own.
+ * Walked without recursion, the parents of the current node are kept on a small stack that only moves to the heap
+ * for documents nested deeper than its inline capacity. Returns (size_t)-1 if that allocation fails, which keeps
+ * the document out of the cache. */
+static size_t document_size(const cJSON *item)
+{
+    const cJSON *inline_stack[8];
+    const cJSON **stack = inline_stack;
+    size_t stack_capacity = sizeof(inline_stack) / sizeof(inline_stack[0]);
+    size_t stack_depth = 0;
+    size_t size = 0;
+
+    while (item != NULL)
+    {
+        size += sizeof(cJSON);
+        if ((item->valuestring != NULL) && !(item->type & cJSON_IsReference))
+        {
+            /* the parser and cJSON_SetValuestring may leave the buffer larger than the string */
+            size += (item->valuestring_capacity != 0) ? item->valuestring_capacity : strlen(item->valuestring) + sizeof("");
+        }
+        if ((item->string != NULL) && !(item->type & cJSON_StringIsConst))
+        {
+            size += strlen(item->string) + sizeof("");
+        }
+
+        if ((item->child != NULL) && !(item->type & cJSON_IsReference))
+        {
+            if (stack_depth == stack_capacity)
+            {
+                const cJSON **new_stack = (const cJSON**)cJSON_malloc(2 * stack_capacity * sizeof(const cJSON*));
+                if (new_stack == NULL)
+                {
+                    size = (size_t)-1;
+                    break;
+                }
+                memcpy((void*)new_stack, (const void*)stack, stack_capacity * sizeof(const cJSON*));
+                if (stack != inline_stack)
+                {
+                    cJSON_free((void*)stack);
+                }
+                stack = new_stack;
+                stack_capacity *= 2;
+            }
+            stack[stack_depth++] = item;
+            item = item->child;
+            continue;
+        }
+
+        /* climb back up until a parent has a next sibling */
+        while ((item->next == NULL) && (stack_depth > 0))
+        {
+            item = stack[--stack_depth];
+        }
+        item = item->next;
+    }
+
+    if (stack != inline_stack)
+    {
+        cJSON_free((void*)stack);
+    }
+
+    return size;
+}
+
+static void release_entry(cJSONCache * const cache, cache_entry * const entry)
+{
+    cJSON_Delete(entry->document);
+    cJSON_free(entry->payload);
+    cache->stats.bytes -= entry->bytes;
+    cache->stats.entries--;
+    memset(entry, '\0', sizeof(cache_entry));
+}
+
+CJSON_PUBLIC(cJSONCache *) cJSONCache_Create(size_t max_entries, size_t max_bytes)
+{
+    cJSONCache *cache = NULL;
+
+    if ((max_entries == 0) || (max_bytes == 0))
+    {
+        return NULL;
+    }
+
+    cache = (cJSONCache*)cJSON_malloc(sizeof(cJSONCache));
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+    memset(cache, '\0', sizeof(cJSONCache));
+
+    cache->entries = (cache_entry*)cJSON_malloc(max_entries * sizeof(cache_entry));
+    if (cache->entries == NULL)
+    {
+        cJSON_free(cache);
+        return NULL;
+    }
+    memset(cache->entries, '\0', max_entries * sizeof(cache_entry));
+
+    cache->max_entries = max_entries;
+    cache->max_bytes = max_bytes;
+
+    return cache;
+}
+
+CJSON_PUBLIC(void) cJSONCache_Delete(cJSONCache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    cJSONCache_Clear(cache);
+    cJSON_free(cache->entries);
+    cJSON_free(cache);
+}
+
+CJSON_PUBLIC(void) cJSONCache_Clear(cJSONCache *cache)
+{
+    size_t i = 0;
+
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < cache->max_entries; i++)
+    {
+        if (cache->entries[i].last_used != 0)
+        {
+            release_entry(cache, &cache->entries[i]);
+        }
+    }
+
+    cJSON_Delete(cache->uncached);
+    cache->uncached = NULL;
+}
+
+CJSON_PUBLIC(const cJSON *) cJSONCache_Parse(cJSONCache *cache, const char *payload, size_t length)
+{
+    unsigned long hash = 0;
+    cache_entry *slot = NULL;
+    cJSON *document = NULL;
+    size_t bytes = 0;
+    size_t i = 0;
+
+    if ((cache == NULL) || (payload == NULL) || (length == 0))
+    {
+        return NULL;
+    }
+
+    /* whatever was handed out last time without being cached is no longer needed */
+    cJSON_Delete(cache->uncached);
+    cache->uncached = NULL;
+
+    cache->stats.lookups++;
+    cache->use_counter++;
+
+    hash = hash_payload((const unsigned char*)payload, length);
+    for (i = 0; i < cache->max_entries; i++)
+    {
+        cache_entry *entry = &cache->entries[i];
+        if ((entry->last_used != 0) && (entry->hash == hash) && (entry->length == length) && (memcmp(entry->payload, payload, length) == 0))
+        {
+            entry->last_used = cache->use_counter;
+            cache->stats.hits++;
+            return entry->document;
+        }
+    }
+
+    cache->stats.misses++;
+
+    document = cJSON_ParseWithLength(payload, length);
+    if (document == NULL)
+    {
+        return NULL;
+    }
+
+    bytes = document_size(document);
+    if ((bytes > cache->max_bytes) || ((bytes + length) > cache->max_bytes))
+    {
+        cache->uncached = document;
+        return document;
+    }
+    bytes += length;
+
+    /* evict least recently used documents until there is a free slot and enough memory budget */
+    for (;;)
+    {
+        cache_entry *oldest = NULL;
+        slot = NULL;
+        for (i = 0; i < cache->max_entries; i++)
+        {
+            cache_entry *entry = &cache->entries[i];
+            if (entry->last_used == 0)
+            {
+                slot = entry;
+            }
+            else if ((oldest == NULL) || (entry->last_used < oldest->last_used))
+            {
+                oldest = entry;
+            }
+        }
+
+        if ((slot != NULL) && ((cache->stats.bytes + bytes) <= cache->max_bytes))
+        {
+            break;
+        }
+
+        release_entry(cache, oldest);
+        cache->stats.evictions++;
+    }
+
+    slot->payload = (char*)cJSON_malloc(length);
+    if (slot->payload == NULL)
+    {
+        /* still return the document, just don't cache it */
+        cache->uncached = document;
+        return document;
+    }
+    memcpy(slot->payload, payload, length);
+
+    slot->hash = hash;
+    slot->length = length;
+    slot->document = document;
+    slot->bytes = bytes;
+    slot->last_used = cache->use_counter;
+    cache->stats.bytes += bytes;
+    cache->stats.entries++;
+
+    return document;
+}
+
+CJSON_PUBLIC(void) cJSONCache_GetStats(const cJSONCache *cache, cJSONCache_Stats *stats)
+{
+    if ((cache == NULL) || (stats == NULL))
+    {
+        return;
+    }
+
+    *stats = cache->stats;
+}
@@ -0,0 +1,44 @@
+#ifndef cJSON_Cache__h
+#define cJSON_Cache__h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "cJSON.h"
+
+/* A small LRU cache of parsed documents for payloads that arrive again and again with identical bytes
+ * (retained or periodically rebroadcast messages). Documents are looked up by a hash of the payload plus its
+ * length and verified byte for byte, so a hit never returns the wrong tree. */
+typedef struct cJSONCache cJSONCache;
+
+typedef struct cJSONCache_Stats
+{
+    size_t lookups;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries; /* documents currently cached */
+    size_t bytes; /* payload copies plus tree nodes and strings currently held */
+} cJSONCache_Stats;
+
+/* Create a cache holding at most max_entries documents and max_bytes of memory (payload copies plus trees). */
+CJSON_PUBLIC(cJSONCache *) cJSONCache_Create(size_t max_entries, size_t max_bytes);
+CJSON_PUBLIC(void) cJSONCache_Delete(cJSONCache *cache);
+
+/* Return the parsed document for payload, parsing it only if the same bytes are not cached yet. Returns NULL if the
+ * payload is not valid JSON.
+ * The tree is owned by the cache and must be treated as read-only: don't modify or cJSON_Delete it. It stays valid
+ * until the next call to cJSONCache_Parse, cJSONCache_Clear or cJSONCache_Delete on the same cache, which may evict it;
+ * cJSON_Duplicate it if you need to keep it longer. */
+CJSON_PUBLIC(const cJSON *) cJSONCache_Parse(cJSONCache *cache, const char *payload, size_t length);
+/* Drop all cached documents. Counters are kept. */
+CJSON_PUBLIC(void) cJSONCache_Clear(cJSONCache *cache);
+CJSON_PUBLIC(void) cJSONCache_GetStats(const cJSONCache *cache, cJSONCache_Stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/* cJSON_Minify throughput on formatted documents of 1 KB to 64 KB, one made of short tokens and one with long
+ * string values. Each run copies the formatted text and minifies it in place; the result has to match
+ * cJSON_PrintUnformatted of the same tree. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cJSON.h"
+
+/* formatted (tabs and newlines) status records: short tokens, and with long_strings a 160 byte signature each */
+static cJSON *status_document(size_t target_size, int long_strings)
+{
+    cJSON *root = cJSON_CreateArray();
+    char *printed = NULL;
+    int i = 0;
+
+    for (;;)
+    {
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(entry, "ts", 1700000000 + i);
+        cJSON_AddStringToObject(entry, "kiosk", "Kiosk 5");
+        cJSON_AddStringToObject(entry, "message", "button \"A\" pressed\tafter idle");
+        cJSON_AddBoolToObject(entry, "led", i % 2);
+        if (long_strings)
+        {
+            cJSON_AddStringToObject(entry, "signature", "3q2+7wAAAAABAgMEBQYHCAkKCwwNDg8QERITFBUWFxgZGhscHR4fICEiIyQlJicoKSorLC0uLzAxMjM0NTY3ODk6Ozw9Pj9AQUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVpbXF1eX2BhYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5ent8fX5/");
+        }
+        cJSON_AddItemToArray(root, entry);
+        i++;
+
+        if ((i % 8) == 0)
+        {
+            size_t length = 0;
+            printed = cJSON_Print(root);
+            length = strlen(printed);
+            cJSON_free(printed);
+            if (length >= target_size)
+            {
+                return root;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const size_t sizes[] = { 1024, 4 * 1024, 16 * 1024, 64 * 1024 };
+    int runs = (argc > 1) ? atoi(argv[1]) : 2000;
+    size_t i = 0;
+
+    printf("%8s %10s %10s %12s %10s\n", "strings", "formatted", "minified", "us per run", "MB/s");
+    for (i = 0; i < 2 * sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        int long_strings = (i >= sizeof(sizes) / sizeof(sizes[0]));
+        cJSON *document = status_document(sizes[i % (sizeof(sizes) / sizeof(sizes[0]))], long_strings);
+        char *formatted = cJSON_Print(document);
+        char *expected = cJSON_PrintUnformatted(document);
+        size_t length = strlen(formatted);
+        char *work = (char*)malloc(length + 1);
+        struct timespec start;
+        struct timespec end;
+        double microseconds = 0;
+        int run = 0;
+
+        memcpy(work, formatted, length + 1);
+        cJSON_Minify(work);
+        if (strcmp(work, expected) != 0)
+        {
+            fprintf(stderr, "%zu bytes: minified text differs from the unformatted print\n", length);
+            return 1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (run = 0; run < runs; run++)
+        {
+            memcpy(work, formatted, length + 1);
+            cJSON_Minify(work);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        microseconds = ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3) / runs;
+        printf("%8s %10zu %10zu %12.2f %10.1f\n", long_strings ? "long" : "short", length, strlen(expected), microseconds, length / microseconds);
+
+        free(work);
+        cJSON_free(expected);
+        cJSON_free(formatted);
+        cJSON_Delete(document);
+    }
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/* Projection parse with a key filter against a full parse of a command document carrying metadata the
+ * handler never reads: nodes kept, allocations made and time per parse. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cJSON.h"
+
+#define RUNS 20000
+
+static size_t allocations = 0;
+static size_t allocated_bytes = 0;
+
+static void *counting_malloc(size_t size)
+{
+    allocations++;
+    allocated_bytes += size;
+    return malloc(size);
+}
+
+static size_t count_nodes(const cJSON *item)
+{
+    size_t count = 0;
+
+    for (; item != NULL; item = item->next)
+    {
+        count += 1 + count_nodes(item->child);
+    }
+    return count;
+}
+
+static char *command_document(void)
+{
+    char *json = (char*)malloc(8192);
+    size_t used = 0;
+    int i = 0;
+
+    used += (size_t)sprintf(json + used, "{\"cmd\":\"set_brightness\",\"id\":\"4f1c2a9e-7b7d-4c1e-9a55-0d2f3e1b6c88\","
+                                         "\"meta\":{\"source\":\"dashboard\",\"user\":\"operator-17\",\"tags\":[");
+    for (i = 0; i < 16; i++)
+    {
+        used += (size_t)sprintf(json + used, "%s\"tag-%02d\"", (i > 0) ? "," : "", i);
+    }
+    used += (size_t)sprintf(json + used, "],\"history\":[");
+    for (i = 0; i < 12; i++)
+    {
+        used += (size_t)sprintf(json + used, "%s{\"ts\":%d,\"cmd\":\"noop\",\"ok\":true}", (i > 0) ? "," : "", 1700000000 + i);
+    }
+    used += (size_t)sprintf(json + used, "]},\"signature\":\"");
+    for (i = 0; i < 128; i++)
+    {
+        json[used++] = "0123456789abcdef"[i % 16];
+    }
+    sprintf(json + used, "\",\"args\":{\"brightness\":128,\"fade_ms\":250,\"zones\":[1,2,3,4]}}");
+    return json;
+}
+
+typedef struct
+{
+    size_t nodes;
+    size_t allocations;
+    size_t bytes;
+    double microseconds;
+} result;
+
+static result measure(const char *json, size_t length, const cJSON_KeyFilter *filter)
+{
+    struct timespec start;
+    struct timespec end;
+    result measured;
+    cJSON *document = NULL;
+    int i = 0;
+
+    allocations = 0;
+    allocated_bytes = 0;
+    document = (filter != NULL) ? cJSON_ParseWithFilter(json, length, filter) : cJSON_ParseWithLength(json, length);
+    measured.nodes = count_nodes(document);
+    measured.allocations = allocations;
+    measured.bytes = allocated_bytes;
+    cJSON_Delete(document);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < RUNS; i++)
+    {
+        document = (filter != NULL) ? cJSON_ParseWithFilter(json, length, filter) : cJSON_ParseWithLength(json, length);
+        cJSON_Delete(document);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    measured.microseconds = ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3) / RUNS;
+    return measured;
+}
+
+int main(void)
+{
+    static const char * const paths[] = { "/cmd", "/args/brightness" };
+    cJSON_Hooks hooks = { counting_malloc, free };
+    cJSON_KeyFilter *filter = NULL;
+    char *json = command_document();
+    size_t length = strlen(json);
+    cJSON *projected = NULL;
+    result full;
+    result filtered;
+
+    cJSON_InitHooks(&hooks);
+    filter = cJSON_CreateKeyFilter(paths, 2);
+
+    /* the projection has to keep exactly what the handler reads */
+    projected = cJSON_ParseWithFilter(json, length, filter);
+    if ((projected == NULL) ||
+        !cJSON_IsString(cJSON_GetObjectItemCaseSensitive(projected, "cmd")) ||
+        (cJSON_GetObjectItemCaseSensitive(cJSON_GetObjectItemCaseSensitive(projected, "args"), "brightness") == NULL) ||
+        (cJSON_GetObjectItemCaseSensitive(projected, "meta") != NULL))
+    {
+        fprintf(stderr, "projection kept the wrong members\n");
+        return 1;
+    }
+    cJSON_Delete(projected);
+
+    full = measure(json, length, NULL);
+    filtered = measure(json, length, filter);
+
+    printf("%zu byte document, %d runs\n", length, RUNS);
+    printf("%10s %8s %12s %8s %12s\n", "", "nodes", "allocations", "bytes", "us per parse");
+    printf("%10s %8zu %12zu %8zu %12.2f\n", "full", full.nodes, full.allocations, full.bytes, full.microseconds);
+    printf("%10s %8zu %12zu %8zu %12.2f\n", "filtered", filtered.nodes, filtered.allocations, filtered.bytes, filtered.microseconds);
+
+    cJSON_DeleteKeyFilter(filter);
+    free(json);
+    return (filtered.nodes < full.nodes) ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+/* 10k cJSON_SetValuestring updates of a status document with values of varying length, counting the
+ * allocations they make. Strings that fit the buffer left by an earlier, longer value are updated in place. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cJSON.h"
+
+#define UPDATES 10000
+
+static size_t allocations = 0;
+
+static void *counting_malloc(size_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+int main(void)
+{
+    static const char * const values[] = { "idle", "playing track 12 of 40", "paused", "buffering", "playing track 3 of 40", "error: no media" };
+    cJSON_Hooks hooks = { counting_malloc, free };
+    struct timespec start;
+    struct timespec end;
+    cJSON *status = NULL;
+    cJSON *state = NULL;
+    char *printed = NULL;
+    size_t update_allocations = 0;
+    size_t i = 0;
+
+    cJSON_InitHooks(&hooks);
+    status = cJSON_Parse("{\"kiosk\":\"lobby\",\"state\":\"starting\"}");
+    state = cJSON_GetObjectItemCaseSensitive(status, "state");
+
+    allocations = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < UPDATES; i++)
+    {
+        const char *value = values[i % (sizeof(values) / sizeof(values[0]))];
+        if ((cJSON_SetValuestring(state, value) == NULL) || (strcmp(state->valuestring, value) != 0))
+        {
+            fprintf(stderr, "update %zu failed\n", i);
+            return 1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    update_allocations = allocations;
+
+    printf("%d updates: %zu allocations, %.1f ns per update\n", UPDATES, update_allocations,
+           ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / UPDATES);
+
+    /* the document still prints the last value */
+    printed = cJSON_PrintUnformatted(status);
+    if ((printed == NULL) || (strstr(printed, values[(UPDATES - 1) % (sizeof(values) / sizeof(values[0]))]) == NULL))
+    {
+        fprintf(stderr, "printed document is wrong: %s\n", (printed != NULL) ? printed : "(null)");
+        return 1;
+    }
+    cJSON_free(printed);
+    cJSON_Delete(status);
+
+    /* only growing past the largest value seen so far may allocate */
+    return (update_allocations <= 2) ? 0 : 1;
+}
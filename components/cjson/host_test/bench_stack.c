@@ -0,0 +1,151 @@
+/* Stack high-water mark of parsing, printing and deleting documents nested 10 to 999 levels deep.
+ * Each run gets its own painted stack, like a FreeRTOS task, and the untouched bytes are counted afterwards. */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cJSON.h"
+
+#define STACK_SIZE (256 * 1024)
+#define STACK_PAINT 0xA5
+/* parse, print and delete must not grow with the nesting depth */
+#define ALLOWED_GROWTH 512
+
+typedef struct
+{
+    const char *json;
+    size_t length;
+    int ok;
+} job;
+
+/* alternating objects and arrays: {"a":[{"a":[ ... 1 ... ]}]} */
+static char *nested_document(int depth, size_t *length)
+{
+    char *json = (char*)malloc((size_t)depth * 6 + 8);
+    size_t used = 0;
+    int i = 0;
+
+    for (i = 0; i < depth; i++)
+    {
+        if ((i % 2) == 0)
+        {
+            memcpy(json + used, "{\"a\":", 5);
+            used += 5;
+        }
+        else
+        {
+            json[used++] = '[';
+        }
+    }
+    json[used++] = '1';
+    for (i = depth - 1; i >= 0; i--)
+    {
+        json[used++] = ((i % 2) == 0) ? '}' : ']';
+    }
+    json[used] = '\0';
+    *length = used;
+    return json;
+}
+
+static void *run_job(void *arg)
+{
+    job *work = (job*)arg;
+    cJSON *document = cJSON_ParseWithLength(work->json, work->length);
+    char *printed = NULL;
+
+    if (document != NULL)
+    {
+        printed = cJSON_PrintUnformatted(document);
+        work->ok = (printed != NULL) && (strcmp(printed, work->json) == 0);
+        cJSON_free(printed);
+        cJSON_Delete(document);
+    }
+    return NULL;
+}
+
+/* bytes of the stack the job touched */
+static size_t stack_used(job *work)
+{
+    unsigned char *stack = (unsigned char*)aligned_alloc(4096, STACK_SIZE);
+    pthread_attr_t attributes;
+    pthread_t thread;
+    size_t untouched = 0;
+
+    memset(stack, STACK_PAINT, STACK_SIZE);
+    pthread_attr_init(&attributes);
+    pthread_attr_setstack(&attributes, stack, STACK_SIZE);
+    pthread_create(&thread, &attributes, run_job, work);
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attributes);
+
+    /* the stack grows down, so untouched bytes are at the low end */
+    while ((untouched < STACK_SIZE) && (stack[untouched] == STACK_PAINT))
+    {
+        untouched++;
+    }
+    free(stack);
+    return STACK_SIZE - untouched;
+}
+
+static double microseconds_per_run(job *work, int runs)
+{
+    struct timespec start;
+    struct timespec end;
+    int i = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < runs; i++)
+    {
+        run_job(work);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3) / runs;
+}
+
+int main(void)
+{
+    static const int depths[] = { 10, 100, 500, CJSON_NESTING_LIMIT - 1 };
+    size_t baseline = 0;
+    size_t i = 0;
+    int failed = 0;
+
+    /* a first run resolves the library symbols, which takes stack of its own */
+    {
+        job warm_up;
+        warm_up.json = nested_document(depths[0], &warm_up.length);
+        stack_used(&warm_up);
+        free((void*)warm_up.json);
+    }
+
+    printf("%8s %12s %14s\n", "depth", "stack bytes", "us per run");
+    for (i = 0; i < sizeof(depths) / sizeof(depths[0]); i++)
+    {
+        job work;
+        size_t used = 0;
+
+        work.json = nested_document(depths[i], &work.length);
+        work.ok = 0;
+        used = stack_used(&work);
+        if (!work.ok)
+        {
+            fprintf(stderr, "depth %d: round trip failed\n", depths[i]);
+            failed = 1;
+        }
+        if (i == 0)
+        {
+            baseline = used;
+        }
+        else if (used > baseline + ALLOWED_GROWTH)
+        {
+            fprintf(stderr, "depth %d: stack grew from %zu to %zu bytes\n", depths[i], baseline, used);
+            failed = 1;
+        }
+        printf("%8d %12zu %14.1f\n", depths[i], used, microseconds_per_run(&work, 200));
+        free((void*)work.json);
+    }
+
+    return failed;
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON_Cache.h"
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+static const char policy[] = "{\"telemetry\":{\"qos\":0},\"led_status\":{\"qos\":1,\"retain\":false}}";
+
+static void test_hit_returns_same_tree(void)
+{
+    cJSONCache *cache = cJSONCache_Create(2, 2048);
+    cJSONCache_Stats stats;
+    const cJSON *first = NULL;
+    const cJSON *second = NULL;
+
+    CHECK(cache != NULL);
+    first = cJSONCache_Parse(cache, policy, sizeof(policy) - 1);
+    second = cJSONCache_Parse(cache, policy, sizeof(policy) - 1);
+    CHECK(first != NULL);
+    CHECK(first == second);
+
+    cJSONCache_GetStats(cache, &stats);
+    CHECK((stats.lookups == 2) && (stats.hits == 1) && (stats.misses == 1) && (stats.entries == 1));
+    /* the payload copy, at least one node per value and the key strings */
+    CHECK(stats.bytes > (sizeof(policy) - 1) + 6 * sizeof(cJSON));
+
+    CHECK(cJSONCache_Parse(cache, "{\"a\":", 5) == NULL);
+    cJSONCache_Delete(cache);
+}
+
+static void test_lru_eviction(void)
+{
+    cJSONCache *cache = cJSONCache_Create(2, 4096);
+    cJSONCache_Stats stats;
+
+    CHECK(cJSONCache_Parse(cache, "[1]", 3) != NULL);
+    CHECK(cJSONCache_Parse(cache, "[2]", 3) != NULL);
+    CHECK(cJSONCache_Parse(cache, "[1]", 3) != NULL); /* [2] is now the oldest */
+    CHECK(cJSONCache_Parse(cache, "[3]", 3) != NULL);
+    CHECK(cJSONCache_Parse(cache, "[1]", 3) != NULL);
+
+    cJSONCache_GetStats(cache, &stats);
+    CHECK((stats.hits == 2) && (stats.evictions == 1) && (stats.entries == 2));
+    cJSONCache_Delete(cache);
+}
+
+/* document_size walks the tree without recursion; a deeply nested document must be measured, not crash */
+static void test_deep_document(void)
+{
+    enum { depth = 900 };
+    cJSONCache *cache = cJSONCache_Create(1, 1024 * 1024);
+    cJSONCache_Stats stats;
+    char *payload = (char*)malloc(2 * depth + 8);
+    size_t length = 0;
+    size_t i = 0;
+
+    for (i = 0; i < depth; i++)
+    {
+        payload[length++] = '[';
+    }
+    payload[length++] = '1';
+    for (i = 0; i < depth; i++)
+    {
+        payload[length++] = ']';
+    }
+
+    CHECK(cJSONCache_Parse(cache, payload, length) != NULL);
+    cJSONCache_GetStats(cache, &stats);
+    CHECK(stats.entries == 1);
+    CHECK(stats.bytes == length + (depth + 1) * sizeof(cJSON));
+
+    free(payload);
+    cJSONCache_Delete(cache);
+}
+
+/* documents over the budget are returned but not kept */
+static void test_oversized_document(void)
+{
+    cJSONCache *cache = cJSONCache_Create(2, 64);
+    cJSONCache_Stats stats;
+
+    CHECK(cJSONCache_Parse(cache, policy, sizeof(policy) - 1) != NULL);
+    cJSONCache_GetStats(cache, &stats);
+    CHECK((stats.entries == 0) && (stats.bytes == 0));
+    cJSONCache_Delete(cache);
+}
+
+int main(void)
+{
+    test_hit_returns_same_tree();
+    test_lru_eviction();
+    test_deep_document();
+    test_oversized_document();
+    printf("cache: all checks passed\n");
+    return 0;
+}
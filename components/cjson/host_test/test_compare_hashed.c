@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+static cJSON_bool compare_hashed(const cJSON *a, const cJSON *b, const cJSON_bool case_sensitive)
+{
+    return cJSON_CompareHashed(a, cJSON_Hash(a), b, cJSON_Hash(b), case_sensitive);
+}
+
+static const char policy[] =
+    "{\"telemetry\":{\"qos\":0,\"topic\":\"kiosk/1/t\"},\"led_status\":{\"qos\":1,\"retain\":false,\"levels\":[1,2,3]}}";
+
+/* Changing something deep down has to change the hash of the root: nothing above it may answer from a cache */
+static void test_deep_change(void)
+{
+    cJSON *a = cJSON_Parse(policy);
+    cJSON *b = cJSON_Parse(policy);
+    cJSON *topic = cJSON_GetObjectItem(cJSON_GetObjectItem(b, "telemetry"), "topic");
+    cJSON *level = cJSON_GetArrayItem(cJSON_GetObjectItem(cJSON_GetObjectItem(b, "led_status"), "levels"), 2);
+    const uint32_t a_hash = cJSON_Hash(a);
+
+    CHECK(cJSON_Hash(b) == a_hash);
+    CHECK(cJSON_CompareHashed(a, a_hash, b, cJSON_Hash(b), 1));
+
+    CHECK(cJSON_SetValuestring(topic, "kiosk/2/t") != NULL);
+    CHECK(!cJSON_Compare(a, b, 1));
+    CHECK(cJSON_Hash(b) != a_hash);
+    CHECK(!cJSON_CompareHashed(a, a_hash, b, cJSON_Hash(b), 1));
+    CHECK(cJSON_SetValuestring(topic, "kiosk/1/t") != NULL);
+    CHECK(cJSON_CompareHashed(a, a_hash, b, cJSON_Hash(b), 1));
+
+    cJSON_SetNumberValue(level, 4);
+    CHECK(!cJSON_Compare(a, b, 1));
+    CHECK(!cJSON_CompareHashed(a, a_hash, b, cJSON_Hash(b), 1));
+    cJSON_SetNumberValue(level, 3);
+    CHECK(cJSON_CompareHashed(a, a_hash, b, cJSON_Hash(b), 1));
+
+    cJSON_SetBoolValue(cJSON_GetObjectItem(cJSON_GetObjectItem(b, "led_status"), "retain"), 1);
+    CHECK(!cJSON_CompareHashed(a, a_hash, b, cJSON_Hash(b), 1));
+
+    /* a hash that doesn't belong to the tree is the caller's mistake, but it can't make unequal trees equal */
+    CHECK(!cJSON_CompareHashed(a, a_hash, b, a_hash, 1));
+
+    cJSON_Delete(b);
+    cJSON_Delete(a);
+}
+
+/* Equal hashes only mean the trees may be equal; the compare has to confirm it */
+static void test_equal_hash_unequal_tree(void)
+{
+    cJSON *a = NULL;
+    cJSON *b = NULL;
+
+    /* the same double, different exact integers */
+    a = cJSON_Parse("[9007199254740993]");
+    b = cJSON_Parse("[9007199254740992]");
+    CHECK(cJSON_Hash(a) == cJSON_Hash(b));
+    CHECK(!compare_hashed(a, b, 1));
+    cJSON_Delete(b);
+    cJSON_Delete(a);
+
+    /* keys are hashed in lower case */
+    a = cJSON_Parse("{\"Key\":1}");
+    b = cJSON_Parse("{\"key\":1}");
+    CHECK(cJSON_Hash(a) == cJSON_Hash(b));
+    CHECK(!compare_hashed(a, b, 1));
+    CHECK(compare_hashed(a, b, 0));
+    cJSON_Delete(b);
+    cJSON_Delete(a);
+
+    /* out of order, so the members are matched up by hash, and those match up with keys differing in case */
+    a = cJSON_Parse("{\"A\":1,\"b\":[2,{\"c\":3}]}");
+    b = cJSON_Parse("{\"b\":[2,{\"c\":3}],\"a\":1}");
+    CHECK(cJSON_Hash(a) == cJSON_Hash(b));
+    CHECK(!compare_hashed(a, b, 1));
+    CHECK(compare_hashed(a, b, 0));
+    CHECK(cJSON_Compare(a, b, 0));
+    cJSON_Delete(b);
+    cJSON_Delete(a);
+
+    a = cJSON_Parse("{\"x\":1,\"y\":2,\"z\":{\"k\":[true,null]}}");
+    b = cJSON_Parse("{\"z\":{\"k\":[true,null]},\"x\":1,\"y\":2}");
+    CHECK(compare_hashed(a, b, 1));
+    CHECK(cJSON_Hash(NULL) == 0);
+    CHECK(!cJSON_CompareHashed(NULL, 0, b, cJSON_Hash(b), 1));
+    cJSON_Delete(b);
+    cJSON_Delete(a);
+}
+
+/* Random trees of integers, strings, literals, arrays and objects, with random changes: the hashed compare has to
+ * agree with cJSON_Compare every time */
+static unsigned int random_state = 12345;
+
+static unsigned int next_random(unsigned int range)
+{
+    random_state = random_state * 1103515245U + 12345U;
+    return (random_state >> 16) % range;
+}
+
+static cJSON *random_tree(int depth)
+{
+    static const char *const keys[] = { "a", "b", "c", "d" };
+    cJSON *item = NULL;
+    unsigned int count = 0;
+    unsigned int first_key = 0;
+    unsigned int i = 0;
+    char text[8];
+
+    switch (depth > 3 ? next_random(3) : next_random(5))
+    {
+        case 0:
+            return cJSON_CreateNumber(next_random(3));
+        case 1:
+            sprintf(text, "s%u", next_random(3));
+            return cJSON_CreateString(text);
+        case 2:
+            return next_random(2) ? cJSON_CreateTrue() : cJSON_CreateNull();
+        case 3:
+            item = cJSON_CreateArray();
+            count = next_random(4);
+            for (i = 0; i < count; i++)
+            {
+                cJSON_AddItemToArray(item, random_tree(depth + 1));
+            }
+            return item;
+        default:
+            item = cJSON_CreateObject();
+            count = next_random(4);
+            first_key = next_random(2);
+            for (i = 0; i < count; i++)
+            {
+                /* distinct keys (cJSON_Compare looks members up by key), starting at a random one so equal objects
+                 * come in different orders */
+                cJSON_AddItemToObject(item, keys[(first_key + i) % 4], random_tree(depth + 1));
+            }
+            return item;
+    }
+}
+
+/* Change one random item somewhere in the tree, or nothing */
+static void random_change(cJSON *item)
+{
+    cJSON *child = NULL;
+    while (item->child != NULL)
+    {
+        child = cJSON_GetArrayItem(item, (int)next_random((unsigned int)cJSON_GetArraySize(item)));
+        if (next_random(3) == 0)
+        {
+            break;
+        }
+        item = child;
+    }
+
+    switch (item->type & 0xFF)
+    {
+        case cJSON_Number:
+            cJSON_SetNumberValue(item, next_random(3));
+            break;
+        case cJSON_String:
+            cJSON_SetValuestring(item, next_random(2) ? "s0" : "changed");
+            break;
+        case cJSON_Array:
+        case cJSON_Object:
+            if ((item->child != NULL) && next_random(2))
+            {
+                cJSON_DeleteItemFromArray(item, 0);
+            }
+            else if (cJSON_IsArray(item))
+            {
+                cJSON_AddItemToArray(item, cJSON_CreateNumber(next_random(3)));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void test_agrees_with_compare(void)
+{
+    enum { rounds = 20000 };
+    size_t equal = 0;
+    size_t round = 0;
+    cJSON *a = NULL;
+    cJSON *b = NULL;
+
+    for (round = 0; round < rounds; round++)
+    {
+        a = random_tree(0);
+        b = next_random(2) ? cJSON_Duplicate(a, 1) : random_tree(0);
+        if (next_random(2))
+        {
+            random_change(b);
+        }
+        if (cJSON_Compare(a, b, 1))
+        {
+            equal++;
+        }
+        CHECK(compare_hashed(a, b, 1) == cJSON_Compare(a, b, 1));
+        CHECK(compare_hashed(a, b, 0) == cJSON_Compare(a, b, 0));
+        cJSON_Delete(b);
+        cJSON_Delete(a);
+    }
+
+    /* both outcomes have to be well covered */
+    CHECK((equal > rounds / 5) && (equal < rounds * 4 / 5));
+}
+
+int main(void)
+{
+    test_deep_change();
+    test_equal_hash_unequal_tree();
+    test_agrees_with_compare();
+
+    printf("compare_hashed: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+static size_t allocations = 0;
+static size_t frees = 0;
+
+static void *counting_malloc(size_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+static void counting_free(void *pointer)
+{
+    if (pointer != NULL)
+    {
+        frees++;
+    }
+    free(pointer);
+}
+
+static const char base_text[] =
+    "{\"name\":\"kiosk\",\"leds\":[1,2,3],\"cfg\":{\"a\":\"x\",\"b\":{\"c\":[true,null]}},\"tags\":[\"t1\"]}";
+
+/* Each mutation changes the tree it is given through the public API, unsharing the path to what it changes first */
+typedef void (*mutation)(cJSON *root);
+
+static cJSON *unshared_member(cJSON *object, const char *name)
+{
+    cJSON *member = NULL;
+    CHECK(cJSON_Unshare(object));
+    member = cJSON_GetObjectItemCaseSensitive(object, name);
+    CHECK(member != NULL);
+    return member;
+}
+
+static void add_to_array(cJSON *root)
+{
+    CHECK(cJSON_AddItemToArray(unshared_member(root, "leds"), cJSON_CreateNumber(4)));
+}
+
+static void insert_first(cJSON *root)
+{
+    CHECK(cJSON_InsertItemInArray(unshared_member(root, "leds"), 0, cJSON_CreateNumber(0)));
+}
+
+static void delete_first(cJSON *root)
+{
+    cJSON_DeleteItemFromArray(unshared_member(root, "leds"), 0);
+}
+
+static void delete_member(cJSON *root)
+{
+    cJSON_DeleteItemFromObjectCaseSensitive(root, "name");
+}
+
+static void detach_nested(cJSON *root)
+{
+    cJSON *detached = cJSON_DetachItemFromObjectCaseSensitive(unshared_member(root, "cfg"), "a");
+    CHECK(detached != NULL);
+    cJSON_Delete(detached);
+}
+
+static void replace_nested(cJSON *root)
+{
+    cJSON *b = unshared_member(unshared_member(root, "cfg"), "b");
+    CHECK(cJSON_ReplaceItemInObjectCaseSensitive(b, "c", cJSON_CreateString("replaced")));
+}
+
+static void replace_first_element(cJSON *root)
+{
+    CHECK(cJSON_ReplaceItemInArray(unshared_member(root, "tags"), 0, cJSON_CreateString("t2")));
+}
+
+static void set_valuestring(cJSON *root)
+{
+    CHECK(cJSON_SetValuestring(unshared_member(root, "name"), "a much longer name than before") != NULL);
+}
+
+static void set_nested_valuestring(cJSON *root)
+{
+    CHECK(cJSON_SetValuestring(unshared_member(unshared_member(root, "cfg"), "a"), "y") != NULL);
+}
+
+static void parse_into(cJSON *root)
+{
+    static const char text[] = "{\"name\":\"parsed\",\"leds\":[]}";
+    CHECK(cJSON_ParseInto(root, text, sizeof(text) - 1));
+}
+
+static const struct
+{
+    const char *name;
+    mutation apply;
+} mutations[] = {
+    { "add", add_to_array },
+    { "insert first", insert_first },
+    { "delete first", delete_first },
+    { "delete member", delete_member },
+    { "detach nested", detach_nested },
+    { "replace nested", replace_nested },
+    { "replace first", replace_first_element },
+    { "set valuestring", set_valuestring },
+    { "set nested valuestring", set_nested_valuestring },
+    { "parse into", parse_into },
+};
+
+#define COPIES 3
+
+static const int delete_orders[][COPIES] = {
+    { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 },
+};
+
+/* copies[0] is the original, copies[1] shares with it and copies[2] with copies[1] */
+static void make_copies(cJSON *copies[COPIES])
+{
+    size_t i = 0;
+    copies[0] = cJSON_Parse(base_text);
+    CHECK(copies[0] != NULL);
+    for (i = 1; i < COPIES; i++)
+    {
+        copies[i] = cJSON_DuplicateShared(copies[i - 1]);
+        CHECK(copies[i] != NULL);
+    }
+}
+
+static void check_prints_as(const cJSON *item, const char *expected, const char *what)
+{
+    char *printed = cJSON_PrintUnformatted(item);
+    CHECK(printed != NULL);
+    if (strcmp(printed, expected) != 0)
+    {
+        fprintf(stderr, "%s: %s, expected %s\n", what, printed, expected);
+        exit(1);
+    }
+    cJSON_free(printed);
+}
+
+/* Mutate one copy and check it changed like an unshared tree would, while the others still print as before */
+static void test_mutations(void)
+{
+    size_t m = 0;
+    size_t changed = 0;
+    size_t order = 0;
+    size_t i = 0;
+    cJSON *copies[COPIES];
+    cJSON *expected_tree = NULL;
+    char *expected = NULL;
+
+    for (m = 0; m < sizeof(mutations) / sizeof(mutations[0]); m++)
+    {
+        expected_tree = cJSON_Parse(base_text);
+        mutations[m].apply(expected_tree);
+        expected = cJSON_PrintUnformatted(expected_tree);
+        cJSON_Delete(expected_tree);
+        CHECK(strcmp(expected, base_text) != 0);
+
+        for (changed = 0; changed < COPIES; changed++)
+        {
+            for (order = 0; order < sizeof(delete_orders) / sizeof(delete_orders[0]); order++)
+            {
+                make_copies(copies);
+                mutations[m].apply(copies[changed]);
+                for (i = 0; i < COPIES; i++)
+                {
+                    check_prints_as(copies[i], (i == changed) ? expected : base_text, mutations[m].name);
+                }
+
+                /* every remaining copy has to stay intact while the others go */
+                for (i = 0; i < COPIES; i++)
+                {
+                    size_t remaining = 0;
+                    cJSON_Delete(copies[delete_orders[order][i]]);
+                    copies[delete_orders[order][i]] = NULL;
+                    for (remaining = 0; remaining < COPIES; remaining++)
+                    {
+                        if (copies[remaining] != NULL)
+                        {
+                            check_prints_as(copies[remaining], (remaining == changed) ? expected : base_text, mutations[m].name);
+                        }
+                    }
+                }
+            }
+        }
+        cJSON_free(expected);
+    }
+}
+
+/* The last copy standing gets the list back to itself, and mutating it then changes only it */
+static void test_mutate_last_copy(void)
+{
+    size_t m = 0;
+    size_t last = 0;
+    size_t i = 0;
+    cJSON *copies[COPIES];
+    cJSON *expected_tree = NULL;
+    char *expected = NULL;
+
+    for (m = 0; m < sizeof(mutations) / sizeof(mutations[0]); m++)
+    {
+        expected_tree = cJSON_Parse(base_text);
+        mutations[m].apply(expected_tree);
+        expected = cJSON_PrintUnformatted(expected_tree);
+
+        for (last = 0; last < COPIES; last++)
+        {
+            make_copies(copies);
+            for (i = 0; i < COPIES; i++)
+            {
+                if (i != last)
+                {
+                    cJSON_Delete(copies[i]);
+                }
+            }
+            mutations[m].apply(copies[last]);
+            check_prints_as(copies[last], expected, mutations[m].name);
+            CHECK(cJSON_Compare(copies[last], expected_tree, 1));
+            cJSON_Delete(copies[last]);
+        }
+
+        cJSON_free(expected);
+        cJSON_Delete(expected_tree);
+    }
+}
+
+/* Sharing a single element list and copies of copies of nested lists, then a deep copy of a shared tree */
+static void test_nesting(void)
+{
+    cJSON *one = cJSON_Parse("[[[1]]]");
+    cJSON *inner_copy = NULL;
+    cJSON *copy = cJSON_DuplicateShared(one);
+    cJSON *deep = NULL;
+
+    CHECK(cJSON_Unshare(copy));
+    inner_copy = cJSON_DuplicateShared(cJSON_GetArrayItem(copy, 0));
+    CHECK(cJSON_Compare(inner_copy, cJSON_GetArrayItem(one, 0), 1));
+    CHECK(cJSON_GetArrayItem(one, 0)->prev == cJSON_GetArrayItem(one, 0));
+    CHECK(cJSON_GetArraySize(copy) == 1);
+
+    deep = cJSON_Duplicate(copy, 1);
+    CHECK((deep->type & cJSON_ChildIsShared) == 0);
+    CHECK(cJSON_Compare(deep, one, 1));
+
+    cJSON_Delete(one);
+    check_prints_as(copy, "[[[1]]]", "nested");
+    cJSON_Delete(copy);
+    check_prints_as(inner_copy, "[[1]]", "nested");
+    cJSON_Delete(inner_copy);
+    check_prints_as(deep, "[[[1]]]", "nested");
+    cJSON_Delete(deep);
+}
+
+int main(void)
+{
+    cJSON_Hooks hooks = { counting_malloc, counting_free };
+    cJSON_InitHooks(&hooks);
+
+    test_mutations();
+    test_mutate_last_copy();
+    test_nesting();
+    CHECK(allocations == frees);
+
+    printf("cow: all checks passed\n");
+    return 0;
+}
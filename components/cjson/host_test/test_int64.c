@@ -0,0 +1,162 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+/* Parse text, print it unformatted and compare against expected, then parse that output again and check it
+ * compares equal to the first tree. */
+static void check_round_trip(const char *text, const char *expected)
+{
+    cJSON *item = cJSON_Parse(text);
+    cJSON *again = NULL;
+    char *printed = NULL;
+
+    CHECK(item != NULL);
+    printed = cJSON_PrintUnformatted(item);
+    CHECK(printed != NULL);
+    if (strcmp(printed, expected) != 0)
+    {
+        fprintf(stderr, "%s printed as %s, expected %s\n", text, printed, expected);
+        exit(1);
+    }
+    again = cJSON_Parse(printed);
+    CHECK(again != NULL);
+    CHECK(cJSON_Compare(item, again, 1));
+
+    cJSON_free(printed);
+    cJSON_Delete(again);
+    cJSON_Delete(item);
+}
+
+static void test_limits(void)
+{
+    cJSON *item = NULL;
+
+    check_round_trip("9223372036854775807", "9223372036854775807");
+    check_round_trip("-9223372036854775808", "-9223372036854775808");
+
+    item = cJSON_Parse("9223372036854775807");
+    CHECK(cJSON_GetInt64Value(item) == INT64_MAX);
+    CHECK(item->valueint == INT32_MAX);
+    cJSON_Delete(item);
+
+    item = cJSON_Parse("-9223372036854775808");
+    CHECK(cJSON_GetInt64Value(item) == INT64_MIN);
+    CHECK(item->valueint == INT32_MIN);
+    cJSON_Delete(item);
+
+    item = cJSON_CreateInt64(INT64_MIN + 1);
+    CHECK(cJSON_GetInt64Value(item) == INT64_MIN + 1);
+    cJSON_Delete(item);
+}
+
+/* 2^63 doesn't fit: it is parsed as a double and saturates when read as an integer */
+static void test_overflow_to_double(void)
+{
+    cJSON *item = cJSON_Parse("9223372036854775808");
+    cJSON *max = cJSON_Parse("9223372036854775807");
+
+    CHECK(item != NULL);
+    CHECK((item->type & cJSON_NumberIsInt64) == 0);
+    CHECK(item->valuedouble == 9223372036854775808.0);
+    CHECK(cJSON_GetInt64Value(item) == INT64_MAX);
+    /* INT64_MAX converts to the same double; with only one side exact they compare as doubles */
+    CHECK(max->valuedouble == item->valuedouble);
+    CHECK(cJSON_Compare(item, max, 1));
+
+    cJSON_Delete(max);
+    cJSON_Delete(item);
+    check_round_trip("-9223372036854775809", "-9.2233720368547758e+18");
+}
+
+static void test_negative_zero(void)
+{
+    cJSON *item = cJSON_Parse("-0");
+    cJSON *zero = cJSON_Parse("0");
+
+    CHECK(item != NULL);
+    CHECK((item->type & cJSON_NumberIsInt64) == 0);
+    CHECK(item->valuedouble == 0.0);
+    CHECK(cJSON_Compare(item, zero, 1));
+    check_round_trip("-0", "0");
+
+    cJSON_Delete(zero);
+    cJSON_Delete(item);
+}
+
+/* just outside the int range: valueint saturates, the exact value is kept */
+static void test_int_boundaries(void)
+{
+    cJSON *item = NULL;
+
+    check_round_trip("2147483648", "2147483648");
+    check_round_trip("-2147483649", "-2147483649");
+    check_round_trip("[2147483647,-2147483648]", "[2147483647,-2147483648]");
+
+    item = cJSON_Parse("2147483648");
+    CHECK(item->valueint == INT32_MAX);
+    CHECK(cJSON_GetInt64Value(item) == 2147483648LL);
+    cJSON_Delete(item);
+
+    item = cJSON_Parse("-2147483649");
+    CHECK(item->valueint == INT32_MIN);
+    CHECK(cJSON_GetInt64Value(item) == -2147483649LL);
+    cJSON_Delete(item);
+}
+
+/* code that assigns valuedouble directly, as cJSON has always allowed, must see that value printed and compared */
+static void test_valuedouble_assigned_directly(void)
+{
+    cJSON *item = cJSON_Parse("5");
+    cJSON *other = cJSON_Parse("5");
+    cJSON *expected = cJSON_CreateNumber(6.5);
+    char *printed = NULL;
+
+    item->valuedouble = 6.5;
+    printed = cJSON_PrintUnformatted(item);
+    CHECK(strcmp(printed, "6.5") == 0);
+    CHECK(!cJSON_Compare(item, other, 1));
+    CHECK(cJSON_Compare(item, expected, 1));
+    CHECK(cJSON_GetInt64Value(item) == 6);
+    cJSON_free(printed);
+
+    /* the same for an integer value, and for one past the double's precision */
+    item->valuedouble = 7;
+    printed = cJSON_PrintUnformatted(item);
+    CHECK(strcmp(printed, "7") == 0);
+    cJSON_free(printed);
+
+    cJSON_Delete(other);
+    other = cJSON_Parse("9007199254740993");
+    CHECK(cJSON_GetInt64Value(other) == 9007199254740993LL);
+    other->valuedouble = 1.0;
+    CHECK(cJSON_GetInt64Value(other) == 1);
+
+    cJSON_Delete(expected);
+    cJSON_Delete(other);
+    cJSON_Delete(item);
+}
+
+int main(void)
+{
+    test_limits();
+    test_overflow_to_double();
+    test_negative_zero();
+    test_int_boundaries();
+    test_valuedouble_assigned_directly();
+
+    printf("int64: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+static size_t allocations = 0;
+static size_t frees = 0;
+
+static void *counting_malloc(size_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+static void counting_free(void *pointer)
+{
+    if (pointer != NULL)
+    {
+        frees++;
+    }
+    free(pointer);
+}
+
+/* ParseInto must leave the document exactly as cJSON_Parse would have built it */
+static void check_same_as_parse(const cJSON *document, const char *text)
+{
+    cJSON *expected = cJSON_Parse(text);
+    char *printed = NULL;
+    char *expected_printed = NULL;
+
+    CHECK(expected != NULL);
+    CHECK(cJSON_Compare(document, expected, 1));
+    printed = cJSON_PrintUnformatted(document);
+    expected_printed = cJSON_PrintUnformatted(expected);
+    CHECK(strcmp(printed, expected_printed) == 0);
+
+    cJSON_free(expected_printed);
+    cJSON_free(printed);
+    cJSON_Delete(expected);
+}
+
+static const char *const same_shape[] = {
+    "{\"cmd\":\"set\",\"led\":3,\"rgb\":[255,0,0],\"fade\":true,\"note\":\"living room\"}",
+    "{\"cmd\":\"set\",\"led\":7,\"rgb\":[0,128,64],\"fade\":false,\"note\":\"hall\"}",
+    "{\"cmd\":\"off\",\"led\":0,\"rgb\":[1,2,3],\"fade\":true,\"note\":\"x\"}",
+    "{\"cmd\":\"set\",\"led\":-1,\"rgb\":[9.5,1e3,0],\"fade\":null,\"note\":\"kitchen\"}",
+};
+
+static void test_same_shape_allocates_nothing(void)
+{
+    cJSON *document = cJSON_CreateNull();
+    size_t before = 0;
+    size_t i = 0;
+
+    CHECK(cJSON_ParseInto(document, same_shape[0], strlen(same_shape[0])));
+    check_same_as_parse(document, same_shape[0]);
+
+    for (i = 1; i < sizeof(same_shape) / sizeof(same_shape[0]); i++)
+    {
+        before = allocations;
+        CHECK(cJSON_ParseInto(document, same_shape[i], strlen(same_shape[i])));
+        CHECK(allocations == before);
+        check_same_as_parse(document, same_shape[i]);
+    }
+
+    cJSON_Delete(document);
+}
+
+static void test_divergent_shape(void)
+{
+    static const char *const texts[] = {
+        "{\"a\":1,\"b\":[1,2,3]}",
+        "{\"a\":{\"deeper\":{\"still\":[\"longer string than before\",{}]}},\"b\":[],\"c\":\"new\"}",
+        "[1,\"two\",[3],{\"four\":4}]",
+        "\"just a string now\"",
+        "42",
+        "[0.000000000000000000000000000000000000125,-1.5e-300]", /* longer than the parser's stack buffer */
+        "{\"b\":[1,2,3],\"a\":1}",
+        "{}",
+    };
+    cJSON *document = cJSON_CreateNull();
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+    {
+        CHECK(cJSON_ParseInto(document, texts[i], strlen(texts[i])));
+        check_same_as_parse(document, texts[i]);
+    }
+
+    cJSON_Delete(document);
+}
+
+static void test_failure_leaves_invalid(void)
+{
+    static const char valid[] = "{\"state\":\"on\",\"level\":[1,2]}";
+    static const char broken[] = "{\"state\":\"on\",\"level\":[1,}";
+    cJSON *document = cJSON_CreateNull();
+
+    CHECK(cJSON_ParseInto(document, valid, sizeof(valid) - 1));
+    CHECK(!cJSON_ParseInto(document, broken, sizeof(broken) - 1));
+    CHECK(document->type == cJSON_Invalid);
+    CHECK(document->child == NULL);
+    CHECK(document->valuestring == NULL);
+    CHECK(cJSON_GetErrorPtr() == strstr(broken, "}"));
+
+    /* and usable again afterwards */
+    CHECK(cJSON_ParseInto(document, valid, sizeof(valid) - 1));
+    check_same_as_parse(document, valid);
+
+    CHECK(!cJSON_ParseInto(document, "", 0));
+    CHECK(!cJSON_ParseInto(NULL, valid, sizeof(valid) - 1));
+    cJSON_Delete(document);
+}
+
+/* A document inside a bigger tree keeps its key and its siblings */
+static void test_document_in_a_tree(void)
+{
+    static const char first[] = "{\"r\":1,\"g\":2}";
+    static const char second[] = "[\"replaced\"]";
+    cJSON *root = cJSON_CreateObject();
+    cJSON *document = cJSON_AddObjectToObject(root, "color");
+    size_t before = 0;
+
+    cJSON_AddStringToObject(root, "after", "kept");
+    CHECK(cJSON_ParseInto(document, first, sizeof(first) - 1));
+    before = allocations;
+    CHECK(cJSON_ParseInto(document, first, sizeof(first) - 1));
+    CHECK(allocations == before);
+
+    CHECK(cJSON_ParseInto(document, second, sizeof(second) - 1));
+    check_same_as_parse(root, "{\"color\":[\"replaced\"],\"after\":\"kept\"}");
+    CHECK(cJSON_GetObjectItem(root, "color") == document);
+
+    CHECK(!cJSON_ParseInto(document, "[", 1));
+    CHECK(cJSON_GetObjectItem(root, "color") == document);
+    CHECK(strcmp(cJSON_GetObjectItem(root, "after")->valuestring, "kept") == 0);
+    cJSON_Delete(root);
+}
+
+int main(void)
+{
+    cJSON_Hooks hooks = { counting_malloc, counting_free };
+    cJSON_InitHooks(&hooks);
+
+    test_same_shape_allocates_nothing();
+    test_divergent_shape();
+    test_failure_leaves_invalid();
+    test_document_in_a_tree();
+    CHECK(allocations == frees);
+
+    printf("parse_into: all checks passed\n");
+    return 0;
+}
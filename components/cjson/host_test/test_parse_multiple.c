@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+static size_t allocations = 0;
+static size_t frees = 0;
+
+static void *counting_malloc(size_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+static void counting_free(void *pointer)
+{
+    if (pointer != NULL)
+    {
+        frees++;
+    }
+    free(pointer);
+}
+
+#define MAX_DOCUMENTS 16
+
+/* What the callback saw: each document printed, and its root node for the recycling check */
+typedef struct
+{
+    size_t count;
+    size_t stop_after;
+    size_t print_allocations;
+    char *printed[MAX_DOCUMENTS];
+    const cJSON *root[MAX_DOCUMENTS];
+} collected;
+
+static cJSON_bool collect(cJSON *document, size_t index, void *user_data)
+{
+    collected *seen = (collected*)user_data;
+
+    CHECK(index == seen->count);
+    CHECK(index < MAX_DOCUMENTS);
+    seen->print_allocations -= allocations;
+    seen->printed[index] = cJSON_PrintUnformatted(document);
+    seen->print_allocations += allocations;
+    seen->root[index] = document;
+    seen->count++;
+
+    return (seen->stop_after == 0) || (seen->count < seen->stop_after);
+}
+
+static void release(collected *seen)
+{
+    size_t i = 0;
+    for (i = 0; i < seen->count; i++)
+    {
+        cJSON_free(seen->printed[i]);
+    }
+    memset(seen, 0, sizeof(*seen));
+}
+
+static void test_ndjson(void)
+{
+    static const char text[] = "{\"n\":1,\"s\":\"a\"}\n{\"n\":2,\"s\":\"b\"}\r\n{\"n\":3,\"s\":\"c\"}\n";
+    collected seen = { 0 };
+    const char *end = NULL;
+
+    CHECK(cJSON_ParseMultiple(text, sizeof(text) - 1, collect, &seen, &end));
+    CHECK(seen.count == 3);
+    CHECK(strcmp(seen.printed[0], "{\"n\":1,\"s\":\"a\"}") == 0);
+    CHECK(strcmp(seen.printed[1], "{\"n\":2,\"s\":\"b\"}") == 0);
+    CHECK(strcmp(seen.printed[2], "{\"n\":3,\"s\":\"c\"}") == 0);
+    CHECK(end == text + sizeof(text) - 1);
+    release(&seen);
+}
+
+/* documents of any type following each other directly, or after a single space where they would run together */
+static void test_concatenated(void)
+{
+    static const char text[] = "{\"a\":1}[2,3]\"four\"5 true null{}";
+    static const char *const expected[] = { "{\"a\":1}", "[2,3]", "\"four\"", "5", "true", "null", "{}" };
+    collected seen = { 0 };
+    const char *end = NULL;
+    size_t i = 0;
+
+    CHECK(cJSON_ParseMultiple(text, sizeof(text) - 1, collect, &seen, &end));
+    CHECK(seen.count == sizeof(expected) / sizeof(expected[0]));
+    for (i = 0; i < seen.count; i++)
+    {
+        CHECK(strcmp(seen.printed[i], expected[i]) == 0);
+    }
+    CHECK(end == text + sizeof(text) - 1);
+    release(&seen);
+
+    /* the terminator counts as the end, like trailing whitespace */
+    CHECK(cJSON_ParseMultiple(text, sizeof(text), collect, &seen, &end));
+    CHECK(seen.count == sizeof(expected) / sizeof(expected[0]));
+    CHECK(end == text + sizeof(text));
+    release(&seen);
+}
+
+static void test_callback_stops(void)
+{
+    static const char text[] = "[1]\n[2]\n[3]\n";
+    collected seen = { 0 };
+    const char *end = NULL;
+
+    seen.stop_after = 2;
+    CHECK(cJSON_ParseMultiple(text, sizeof(text) - 1, collect, &seen, &end));
+    CHECK(seen.count == 2);
+    CHECK(strcmp(seen.printed[1], "[2]") == 0);
+    /* right after the last document handed over, so the caller can carry on from there */
+    CHECK(end == strstr(text, "[2]") + 3);
+    release(&seen);
+}
+
+static void test_error_mid_batch(void)
+{
+    static const char text[] = "{\"n\":1}\n{\"n\":2}\n{\"n\":}\n{\"n\":4}\n";
+    collected seen = { 0 };
+    const char *end = NULL;
+    size_t frees_before = 0;
+    size_t allocations_before = 0;
+
+    allocations_before = allocations;
+    frees_before = frees;
+    CHECK(!cJSON_ParseMultiple(text, sizeof(text) - 1, collect, &seen, &end));
+    CHECK(seen.count == 2);
+    CHECK(strcmp(seen.printed[1], "{\"n\":2}") == 0);
+    CHECK(end == strstr(text, ":}") + 1);
+    CHECK(cJSON_GetErrorPtr() == end);
+    release(&seen);
+    /* nothing of the failed document or the recycled nodes is left behind */
+    CHECK(allocations - allocations_before == frees - frees_before);
+
+    CHECK(!cJSON_ParseMultiple("", 0, collect, &seen, &end));
+    CHECK(!cJSON_ParseMultiple(text, sizeof(text) - 1, NULL, &seen, &end));
+    CHECK(seen.count == 0);
+}
+
+/* The second and later documents of the same shape are built from the first one's nodes and buffers */
+static void test_recycling(void)
+{
+    enum { documents = 12 };
+    char text[documents * 64];
+    size_t length = 0;
+    size_t i = 0;
+    size_t first_document = 0;
+    collected seen = { 0 };
+
+    for (i = 0; i < documents; i++)
+    {
+        length += (size_t)sprintf(text + length, "{\"id\":%u,\"name\":\"node-%02u\",\"tags\":[\"x\",\"y\"]}\n",
+                                  (unsigned)i, (unsigned)i);
+    }
+
+    /* how many allocations a single document of this shape takes, without the callback's printing */
+    first_document = allocations;
+    {
+        cJSON *single = cJSON_ParseWithLength(text, strchr(text, '\n') - text);
+        CHECK(single != NULL);
+        first_document = allocations - first_document;
+        cJSON_Delete(single);
+    }
+
+    {
+        size_t before = allocations;
+        CHECK(cJSON_ParseMultiple(text, length, collect, &seen, NULL));
+        CHECK(seen.count == documents);
+        for (i = 0; i < seen.count; i++)
+        {
+            char expected[64];
+            sprintf(expected, "{\"id\":%u,\"name\":\"node-%02u\",\"tags\":[\"x\",\"y\"]}", (unsigned)i, (unsigned)i);
+            CHECK(strcmp(seen.printed[i], expected) == 0);
+            CHECK(seen.root[i] == seen.root[0]);
+        }
+        /* one document's worth, the rest is the callback's printing */
+        CHECK(allocations - before - seen.print_allocations == first_document);
+    }
+    release(&seen);
+}
+
+int main(void)
+{
+    cJSON_Hooks hooks = { counting_malloc, counting_free };
+    cJSON_InitHooks(&hooks);
+
+    test_ndjson();
+    test_concatenated();
+    test_callback_stops();
+    test_error_mid_batch();
+    test_recycling();
+    CHECK(allocations == frees);
+
+    printf("parse_multiple: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+#include "mqtt_handler.h"
+#include "work_queue.h"
+#include "backpressure.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+typedef struct {
+    int msg_id;                 // 0 when free
+    int64_t sent_us;
+} tracked_publish_t;
+
+static tracked_publish_t tracked[BACKPRESSURE_TRACKED];
+static backpressure_stats_t stats = {
+    .rate = 100,
+};
+static bool rtt_sampled = false;
+static bool rtt_fresh = false;      // a PUBACK arrived since the last control period
+static esp_timer_handle_t control_timer = NULL;
+static portMUX_TYPE backpressure_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// --------------------------------------------------------------------------------
+// Round Trip
+// --------------------------------------------------------------------------------
+// Called by mqtt_publish() for every queued QoS 1/2 message; untimed when all slots are busy
+void backpressure_on_sent(int msg_id)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&backpressure_lock);
+    for (int i = 0; i < BACKPRESSURE_TRACKED; i++) {
+        if (tracked[i].msg_id == 0) {
+            tracked[i].msg_id = msg_id;
+            tracked[i].sent_us = now_us;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&backpressure_lock);
+}
+
+// Called from the MQTT event handler on PUBACK
+void backpressure_on_acked(int msg_id)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&backpressure_lock);
+    for (int i = 0; i < BACKPRESSURE_TRACKED; i++) {
+        if (tracked[i].msg_id == msg_id) {
+            uint32_t rtt_ms = (now_us - tracked[i].sent_us) / 1000;
+            // Same smoothing as TCP's SRTT: an eighth of each new sample
+            if (rtt_sampled) {
+                stats.srtt_ms = stats.srtt_ms - stats.srtt_ms / 8 + rtt_ms / 8;
+            } else {
+                stats.srtt_ms = rtt_ms;
+                rtt_sampled = true;
+            }
+            rtt_fresh = true;
+            tracked[i].msg_id = 0;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&backpressure_lock);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Control
+// --------------------------------------------------------------------------------
+// Runs on the I/O work queue, reading the outbox size takes the client lock
+static void control_work(void *arg)
+{
+    int outbox_bytes = esp_mqtt_client_get_outbox_size(mqtt_client);
+    int64_t now_us = esp_timer_get_time();
+    bool decreased = false;
+    uint32_t rate;
+
+    portENTER_CRITICAL(&backpressure_lock);
+    // A stalled broker sends no PUBACKs at all, so the oldest unanswered publish counts too
+    int64_t oldest_us = 0;
+    for (int i = 0; i < BACKPRESSURE_TRACKED; i++) {
+        int64_t age_us = now_us - tracked[i].sent_us;
+        if (tracked[i].msg_id != 0 && age_us > BACKPRESSURE_TRACK_TIMEOUT_MS * 1000LL) {
+            tracked[i].msg_id = 0;      // expired from the outbox or lost with the connection
+        } else if (tracked[i].msg_id != 0 && age_us > oldest_us) {
+            oldest_us = age_us;
+        }
+    }
+    bool congested = outbox_bytes >= BACKPRESSURE_OUTBOX_HIGH ||
+                     (rtt_fresh && stats.srtt_ms > BACKPRESSURE_RTT_HIGH_MS) ||
+                     oldest_us / 1000 > BACKPRESSURE_RTT_HIGH_MS;
+    rtt_fresh = false;
+
+    stats.outbox_bytes = outbox_bytes;
+    if (congested && stats.rate > BACKPRESSURE_MIN_RATE) {
+        stats.rate = (stats.rate / 2 > BACKPRESSURE_MIN_RATE) ? stats.rate / 2 : BACKPRESSURE_MIN_RATE;
+        stats.decreases++;
+        decreased = true;
+    } else if (!congested && stats.rate < 100) {
+        stats.rate = (stats.rate + BACKPRESSURE_INCREASE < 100) ? stats.rate + BACKPRESSURE_INCREASE : 100;
+    }
+    rate = stats.rate;
+    portEXIT_CRITICAL(&backpressure_lock);
+
+    if (decreased) {
+        ESP_LOGW(TAG, "Backpressure: outbox %d bytes, send rate down to %u%%", outbox_bytes, (unsigned)rate);
+    }
+}
+
+static void control_timer_callback(void *arg)
+{
+    work_queue_submit_io(control_work, NULL);
+}
+
+esp_err_t backpressure_init(void)
+{
+    const esp_timer_create_args_t timer_args = {
+        .callback = control_timer_callback,
+        .name = "backpressure",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &control_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return esp_timer_start_periodic(control_timer, BACKPRESSURE_PERIOD_MS * 1000ULL);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Producers
+// --------------------------------------------------------------------------------
+// False while the outbox is above BACKPRESSURE_OUTBOX_HIGH as of the last control period
+bool backpressure_can_send(void)
+{
+    bool can_send;
+
+    portENTER_CRITICAL(&backpressure_lock);
+    can_send = stats.outbox_bytes < BACKPRESSURE_OUTBOX_HIGH;
+    portEXIT_CRITICAL(&backpressure_lock);
+    return can_send;
+}
+
+// A nominal interval stretched to the current rate: at 50% a 10 s period becomes 20 s
+uint32_t backpressure_scale_interval(uint32_t interval_ms)
+{
+    uint32_t rate;
+
+    portENTER_CRITICAL(&backpressure_lock);
+    rate = stats.rate;
+    portEXIT_CRITICAL(&backpressure_lock);
+    return (uint64_t)interval_ms * 100 / rate;
+}
+
+void backpressure_get_stats(backpressure_stats_t *out)
+{
+    portENTER_CRITICAL(&backpressure_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&backpressure_lock);
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,36 @@
+#ifndef BACKPRESSURE_H
+#define BACKPRESSURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include "outbox_ring.h"
+
+// AIMD rate control for the periodic publishers. Every period the controller looks at the outbox and at
+// the PUBACK round trip of QoS 1 publishes: when either is high it halves the send rate, otherwise it
+// adds BACKPRESSURE_INCREASE percent back. Periodic intervals are stretched by the inverse of the rate,
+// and producers hold back while backpressure_can_send() is false.
+#define BACKPRESSURE_PERIOD_MS 1000
+#define BACKPRESSURE_OUTBOX_HIGH (OUTBOX_RING_SIZE / 2)     // bytes; at or above, producers hold back
+#define BACKPRESSURE_RTT_HIGH_MS 2000
+#define BACKPRESSURE_INCREASE 5             // percent per period without congestion
+#define BACKPRESSURE_MIN_RATE 10            // percent of the nominal rate
+#define BACKPRESSURE_TRACKED 8              // QoS 1 publishes timed at once
+#define BACKPRESSURE_TRACK_TIMEOUT_MS 30000 // a publish unanswered this long is no longer timed
+
+typedef struct {
+    uint32_t rate;              // percent of the nominal publish rate
+    uint32_t srtt_ms;           // smoothed PUBACK round trip
+    uint32_t outbox_bytes;
+    uint32_t decreases;
+} backpressure_stats_t;
+
+// Function prototypes
+esp_err_t backpressure_init(void);
+void backpressure_on_sent(int msg_id);
+void backpressure_on_acked(int msg_id);
+bool backpressure_can_send(void);
+uint32_t backpressure_scale_interval(uint32_t interval_ms);
+void backpressure_get_stats(backpressure_stats_t *stats);
+
+#endif // BACKPRESSURE_H
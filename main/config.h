@@ -10,4 +10,8 @@
 
 #define BUTTON_GPIO GPIO_NUM_0
 
+// Serve small cJSON blocks from json_alloc's static pool. Off: the pool reserves its blocks in internal RAM up
+// front and has not yet done better than the default heap; define it only to validate the pool on hardware
+// #define JSON_ALLOC_POOL
+
 #endif // CONFIG_H
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+# Generates the perfect-hash LED command table from a verb list.
+#
+# Usage: gen_command_table.py <verb list> <output header>
+#
+# The hash must match command_hash() in led_commands.c: 32-bit FNV-1a over the payload,
+# started from the offset basis xor a seed, folded and masked to the table size. The seed
+# is searched until every verb lands in its own slot.
+
+import re
+import sys
+
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+MAX_SEED = 1 << 16
+
+
+def command_hash(seed, verb):
+    h = FNV_OFFSET ^ seed
+    for byte in verb.encode('ascii'):
+        h ^= byte
+        h = (h * FNV_PRIME) & 0xFFFFFFFF
+    return h ^ (h >> 15)
+
+
+def read_verbs(path):
+    verbs = []
+    with open(path) as f:
+        for line in f:
+            verb = line.split('#', 1)[0].strip()
+            if not verb:
+                continue
+            if not re.fullmatch(r'[a-z][a-z0-9_]*', verb):
+                sys.exit('%s: invalid verb "%s"' % (path, verb))
+            if verb in verbs:
+                sys.exit('%s: duplicate verb "%s"' % (path, verb))
+            verbs.append(verb)
+    if not verbs:
+        sys.exit('%s: no verbs' % path)
+    return verbs
+
+
+def find_table(verbs):
+    size = 1
+    while size < len(verbs):
+        size *= 2
+    while True:
+        for seed in range(MAX_SEED):
+            slots = {}
+            for verb in verbs:
+                slot = command_hash(seed, verb) & (size - 1)
+                if slot in slots:
+                    break
+                slots[slot] = verb
+            else:
+                return size, seed, slots
+        size *= 2
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: gen_command_table.py <verb list> <output header>')
+    verbs = read_verbs(sys.argv[1])
+    size, seed, slots = find_table(verbs)
+
+    lines = [
+        '// Generated by gen_command_table.py from %s, do not edit' % sys.argv[1].replace('\\', '/').split('/')[-1],
+        '#ifndef LED_COMMAND_TABLE_H',
+        '#define LED_COMMAND_TABLE_H',
+        '',
+        '#define LED_COMMAND_TABLE_SIZE %d' % size,
+        '#define LED_COMMAND_TABLE_SEED %du' % seed,
+        '',
+    ]
+    for verb in verbs:
+        lines.append('void led_command_%s(void);' % verb)
+    lines.append('')
+    lines.append('static const led_command_entry_t led_command_table[LED_COMMAND_TABLE_SIZE] = {')
+    for slot in sorted(slots):
+        verb = slots[slot]
+        lines.append('    [%d] = { "%s", %d, led_command_%s },' % (slot, verb, len(verb), verb))
+    lines.append('};')
+    lines.append('')
+    lines.append('#endif // LED_COMMAND_TABLE_H')
+
+    with open(sys.argv[2], 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,281 @@
+// Replays a synthetic day of kiosk traffic against the simulated internal RAM and PSRAM regions, once with
+// cJSON on the default heap and once through json_alloc, and reports how fragmented internal RAM gets.
+// Usage: bench_json_alloc [steps]
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_heap_caps.h>
+#include <cJSON.h>
+#include "json_alloc.h"
+
+#define INTERNAL_SIZE (96 * 1024)
+#define POOL_SIZE (JSON_ALLOC_SMALL_COUNT * JSON_ALLOC_SMALL_BLOCK)
+#define SPIRAM_SIZE (1024 * 1024)
+#define HELD_BUFFERS 48             // network buffers alive at once, at most
+#define RETAINED_DOCUMENTS 2        // long-lived parsed documents, like the cached qos_policy updates
+
+typedef struct {
+    size_t min_free;
+    size_t end_largest;
+    unsigned end_fragmentation;
+    size_t min_largest;
+    unsigned max_fragmentation;
+    size_t failed_messages;
+    size_t failed_buffers;
+} trace_result_t;
+
+typedef struct {
+    void *ptr;
+    size_t expires;
+} held_buffer_t;
+
+static uint32_t rng_state;
+
+static uint32_t next_random(void)
+{
+    // xorshift32, so both runs replay the same trace
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint32_t random_between(uint32_t low, uint32_t high)
+{
+    return low + next_random() % (high - low + 1);
+}
+
+// --------------------------------------------------------------------------------
+// Default Heap Hooks
+// --------------------------------------------------------------------------------
+// What cJSON gets without json_alloc: malloc() on the target, internal RAM first
+static void *default_malloc(size_t size)
+{
+    return heap_caps_malloc(size, MALLOC_CAP_8BIT);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Messages
+// --------------------------------------------------------------------------------
+static bool led_command(void)
+{
+    char json[128];
+    snprintf(json, sizeof(json), "{\"state\":\"%s\",\"brightness\":%u,\"color\":[%u,%u,%u],\"fade_ms\":%u}",
+             (next_random() & 1) ? "on" : "off", random_between(0, 255), random_between(0, 255),
+             random_between(0, 255), random_between(0, 255), random_between(0, 2000));
+    cJSON *command = cJSON_Parse(json);
+    bool ok = command != NULL && cJSON_GetObjectItemCaseSensitive(command, "color") != NULL;
+    cJSON_Delete(command);
+    return ok;
+}
+
+static bool telemetry_frame(void)
+{
+    static const char *const fields[] = {
+        "uptime_s", "free_heap", "min_free_heap", "largest_block", "json_pool", "outbox_peak", "outbox_rejected",
+        "stored", "store_wear", "send_rate", "rtt_ms", "rssi",
+    };
+    static char buffer[512];
+    cJSON *frame = cJSON_CreateObject();
+    bool ok = frame != NULL;
+
+    for (size_t i = 0; ok && i < sizeof(fields) / sizeof(fields[0]); i++) {
+        ok = cJSON_AddNumberToObject(frame, fields[i], next_random() % 200000) != NULL;
+    }
+    ok = ok && cJSON_AddStringToObject(frame, "led", "on") != NULL;
+    ok = ok && cJSON_PrintPreallocated(frame, buffer, sizeof(buffer), false);
+    cJSON_Delete(frame);
+    return ok;
+}
+
+static bool state_publish(void)
+{
+    cJSON *state = cJSON_CreateObject();
+    bool ok = state != NULL && cJSON_AddStringToObject(state, "kiosk", "Kiosk 5") != NULL &&
+              cJSON_AddBoolToObject(state, "led", next_random() & 1) != NULL &&
+              cJSON_AddNumberToObject(state, "brightness", random_between(0, 255)) != NULL;
+    char *printed = ok ? cJSON_PrintUnformatted(state) : NULL;
+    ok = printed != NULL;
+    cJSON_free(printed);
+    cJSON_Delete(state);
+    return ok;
+}
+
+static bool announce(void)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *topics = root != NULL ? cJSON_AddArrayToObject(root, "topics") : NULL;
+    bool ok = topics != NULL;
+
+    for (int i = 0; ok && i < 8; i++) {
+        char topic[48];
+        snprintf(topic, sizeof(topic), "esp32/kiosk/Kiosk 5/topic_%d", i);
+        cJSON *entry = cJSON_CreateObject();
+        ok = entry != NULL && cJSON_AddItemToArray(topics, entry) &&
+             cJSON_AddStringToObject(entry, "topic", topic) != NULL && cJSON_AddNumberToObject(entry, "qos", i % 2) != NULL;
+        if (!ok && entry != NULL && entry->prev == NULL) {
+            cJSON_Delete(entry);        // never made it into the array
+        }
+    }
+    char *printed = ok ? cJSON_PrintUnformatted(root) : NULL;
+    ok = printed != NULL;
+    cJSON_free(printed);
+    cJSON_Delete(root);
+    return ok;
+}
+
+static cJSON *policy_document(void)
+{
+    char json[160];
+    snprintf(json, sizeof(json), "{\"button\":{\"qos\":1},\"led_status\":{\"qos\":%u,\"retain\":%s},"
+             "\"telemetry\":{\"qos\":%u}}", random_between(0, 1), (next_random() & 1) ? "true" : "false",
+             random_between(0, 1));
+    return cJSON_Parse(json);
+}
+
+// A few KB of configuration: long strings end up in large blocks
+static cJSON *bulk_document(void)
+{
+    char *json = malloc(4096);
+    size_t used = 0;
+    int entries = random_between(8, 24);
+
+    used += snprintf(json + used, 4096 - used, "[");
+    for (int i = 0; i < entries; i++) {
+        used += snprintf(json + used, 4096 - used, "%s{\"name\":\"scene_%d\",\"description\":\"%.*s\",\"steps\":[%d,%d]}",
+                         i ? "," : "", i, (int)random_between(40, 120),
+                         "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz",
+                         i, i + 1);
+    }
+    snprintf(json + used, 4096 - used, "]");
+    cJSON *document = cJSON_Parse(json);
+    free(json);
+    return document;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Trace
+// --------------------------------------------------------------------------------
+static unsigned internal_fragmentation(size_t *largest)
+{
+    size_t total_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    *largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    return total_free ? (unsigned)(100 - (*largest * 100) / total_free) : 0;
+}
+
+static trace_result_t replay(size_t steps)
+{
+    held_buffer_t held[HELD_BUFFERS] = { 0 };
+    cJSON *retained[RETAINED_DOCUMENTS] = { 0 };
+    trace_result_t result = { .min_largest = SIZE_MAX, .min_free = SIZE_MAX };
+
+    rng_state = 0x2545F491;
+    for (size_t step = 1; step <= steps; step++) {
+        // Network buffers in internal RAM, alive for a while, interleaved with the JSON traffic
+        for (int i = 0; i < HELD_BUFFERS; i++) {
+            if (held[i].ptr != NULL && held[i].expires <= step) {
+                heap_caps_free(held[i].ptr);
+                held[i].ptr = NULL;
+            }
+        }
+        if (next_random() % 2 == 0) {
+            held_buffer_t *slot = &held[next_random() % HELD_BUFFERS];
+            if (slot->ptr == NULL) {
+                slot->ptr = heap_caps_malloc(random_between(64, 640), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+                slot->expires = step + random_between(20, 400);
+                result.failed_buffers += slot->ptr == NULL;
+            }
+        }
+
+        // A retained document is replaced now and then and stays parsed until the next one
+        if (next_random() % 500 == 0) {
+            int index = next_random() % RETAINED_DOCUMENTS;
+            cJSON_Delete(retained[index]);
+            retained[index] = policy_document();
+            result.failed_messages += retained[index] == NULL;
+        }
+
+        uint32_t kind = next_random() % 100;
+        bool ok;
+        if (kind < 40) {
+            ok = led_command();
+        } else if (kind < 65) {
+            ok = telemetry_frame();
+        } else if (kind < 85) {
+            ok = state_publish();
+        } else if (kind < 98) {
+            ok = announce();
+        } else {
+            cJSON *document = bulk_document();
+            ok = document != NULL;
+            cJSON_Delete(document);
+        }
+        result.failed_messages += !ok;
+
+        size_t largest;
+        unsigned fragmentation = internal_fragmentation(&largest);
+        if (heap_caps_get_free_size(MALLOC_CAP_INTERNAL) < result.min_free) {
+            result.min_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        }
+        if (largest < result.min_largest) {
+            result.min_largest = largest;
+        }
+        if (fragmentation > result.max_fragmentation) {
+            result.max_fragmentation = fragmentation;
+        }
+    }
+
+    for (int i = 0; i < RETAINED_DOCUMENTS; i++) {
+        cJSON_Delete(retained[i]);
+    }
+    for (int i = 0; i < HELD_BUFFERS; i++) {
+        heap_caps_free(held[i].ptr);
+    }
+    // Measured with the traffic drained, so what is left is fragmentation rather than live data
+    result.end_fragmentation = internal_fragmentation(&result.end_largest);
+    return result;
+}
+
+static void print_result(const char *label, const trace_result_t *result)
+{
+    printf("%-12s %8u%% %8u%% %9zu %9zu %9zu %7zu %8zu\n", label, result->max_fragmentation,
+           result->end_fragmentation, result->min_free, result->min_largest, result->end_largest,
+           result->failed_messages, result->failed_buffers);
+}
+// --------------------------------------------------------------------------------
+
+
+int main(int argc, char **argv)
+{
+    size_t steps = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+
+    // The same internal RAM both times: json_alloc's pool is carved out of it
+    heap_caps_sim_init(INTERNAL_SIZE + POOL_SIZE, SPIRAM_SIZE);
+    cJSON_Hooks hooks = { .malloc_fn = default_malloc, .free_fn = heap_caps_free };
+    cJSON_InitHooks(&hooks);
+    trace_result_t baseline = replay(steps);
+
+    heap_caps_sim_init(INTERNAL_SIZE, SPIRAM_SIZE);
+    json_alloc_init();
+    trace_result_t pooled = replay(steps);
+    json_alloc_stats_t stats;
+    json_alloc_get_stats(&stats);
+
+    printf("%zu steps, %d KB internal RAM, %d KB PSRAM\n", steps, (INTERNAL_SIZE + POOL_SIZE) / 1024,
+           SPIRAM_SIZE / 1024);
+    printf("%-12s %9s %9s %9s %9s %9s %7s %8s\n", "", "max frag", "end frag", "min free", "min block", "end block",
+           "failed", "buf fail");
+    print_result("default heap", &baseline);
+    print_result("json_alloc", &pooled);
+    printf("json_alloc pool peak %zu/%d blocks, %zu fallbacks, %zu large blocks\n", stats.pool_peak,
+           JSON_ALLOC_SMALL_COUNT, stats.pool_fallbacks, stats.large_allocs);
+
+    // Every message must go through, and with the traffic drained internal RAM must be back in one piece
+    return (baseline.failed_messages == 0 && pooled.failed_messages == 0 && baseline.end_fragmentation == 0 &&
+            pooled.end_fragmentation == 0) ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// led_command_lookup() against the strncmp chain it replaced, for the firmware's 3 verbs or the 24 in
+// bench_led_verbs.txt (built twice, against each generated table). A fifth of the payloads are not verbs.
+// Usage: bench_led_commands [lookups]
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "led_control.h"
+#include "led_commands.h"
+#include "led_command_table.h"
+
+bool led_state = false;
+led_strip_handle_t led_strip = NULL;
+
+void set_led_state(bool state)
+{
+}
+
+static const char *verbs[LED_COMMAND_TABLE_SIZE];
+static int verb_count = 0;
+
+// The old decode: the first verb the payload is a prefix of wins
+static int strncmp_chain(const char *payload, int length)
+{
+    for (int i = 0; i < verb_count; i++) {
+        if (strncmp(payload, verbs[i], length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    static const char *const misses[] = { "o", "toggles", "blink_fast", "{\"state\":\"on\"}" };
+    int lookups = argc > 1 ? atoi(argv[1]) : 10000000;
+    const char *payloads[1024];
+    int failed = 0;
+    volatile int sink = 0;
+
+    // Verbs in table order stand in for the old chain's order
+    for (int i = 0; i < LED_COMMAND_TABLE_SIZE; i++) {
+        if (led_command_table[i].verb != NULL) {
+            verbs[verb_count++] = led_command_table[i].verb;
+        }
+    }
+
+    // Exact verbs only: every verb finds its own entry, prefixes and longer payloads find nothing
+    for (int i = 0; i < verb_count; i++) {
+        const led_command_entry_t *entry = led_command_lookup(verbs[i], strlen(verbs[i]));
+        if (entry == NULL || strcmp(entry->verb, verbs[i]) != 0) {
+            fprintf(stderr, "%s not found\n", verbs[i]);
+            failed = 1;
+        }
+    }
+    for (size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); i++) {
+        if (led_command_lookup(misses[i], strlen(misses[i])) != NULL) {
+            fprintf(stderr, "%s matched a verb\n", misses[i]);
+            failed = 1;
+        }
+    }
+
+    srand(1);
+    for (int i = 0; i < 1024; i++) {
+        payloads[i] = (rand() % 5 == 0) ? misses[rand() % 4] : verbs[rand() % verb_count];
+    }
+    int lengths[1024];
+    for (int i = 0; i < 1024; i++) {
+        lengths[i] = strlen(payloads[i]);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < lookups; i++) {
+        sink += led_command_lookup(payloads[i & 1023], lengths[i & 1023]) != NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double table_ns = elapsed_ns(&start, &end) / lookups;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < lookups; i++) {
+        sink += strncmp_chain(payloads[i & 1023], lengths[i & 1023]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double chain_ns = elapsed_ns(&start, &end) / lookups;
+
+    printf("%d verbs, table of %d: perfect hash %.1f ns, strncmp chain %.1f ns per lookup\n", verb_count,
+           LED_COMMAND_TABLE_SIZE, table_ns, chain_ns);
+    return failed;
+}
@@ -0,0 +1,111 @@
+// Dispatch cost of the topic trie against the strncmp chain it replaced, with 8, 32 and 128 exact routes.
+// Topics are drawn uniformly from the first N routes; the chain compares in registration order, like the
+// old if/else in mqtt_event_handler, the trie holds all 128 routes plus wildcard ones throughout.
+// Usage: bench_topic_router [dispatches]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "topic_router.h"
+
+#define KIOSKS 16
+#define COMMANDS 8
+#define ROUTES (KIOSKS * COMMANDS)
+
+static char filters[ROUTES][48];
+static int calls[ROUTES];
+static int wildcard_calls;
+
+static void route_handler(esp_mqtt_event_handle_t event, void *ctx)
+{
+    calls[(intptr_t)ctx]++;
+}
+
+static void wildcard_handler(esp_mqtt_event_handle_t event, void *ctx)
+{
+    wildcard_calls++;
+}
+
+// The old dispatch: the first filter the topic is a prefix of wins
+static int strncmp_chain(esp_mqtt_event_handle_t event, int route_count)
+{
+    for (int i = 0; i < route_count; i++) {
+        if (strncmp(event->topic, filters[i], event->topic_len) == 0) {
+            calls[i]++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    static const char *const commands[COMMANDS] = { "led", "brightness", "color", "reboot", "ota", "config",
+                                                    "qos_policy", "ping" };
+    static const int route_counts[] = { 8, 32, ROUTES };
+    int dispatches = argc > 1 ? atoi(argv[1]) : 1000000;
+    int failed = 0;
+
+    for (int i = 0; i < ROUTES; i++) {
+        snprintf(filters[i], sizeof(filters[i]), "esp32/kiosk/k%02d/%s", i / COMMANDS, commands[i % COMMANDS]);
+        if (topic_router_add(filters[i], route_handler, (void *)(intptr_t)i) != ESP_OK) {
+            fprintf(stderr, "could not add %s\n", filters[i]);
+            return 1;
+        }
+    }
+    // Wildcards that match none of the drawn topics, so both sides call one handler per dispatch
+    topic_router_add("esp32/+/status", wildcard_handler, NULL);
+    topic_router_add("esp32/fleet/#", wildcard_handler, NULL);
+
+    // Every route reached exactly, and a truncated topic matches nothing (the chain matched it as a prefix)
+    for (int i = 0; i < ROUTES; i++) {
+        esp_mqtt_event_t event = { .topic = filters[i], .topic_len = strlen(filters[i]) };
+        memset(calls, 0, sizeof(calls));
+        if (topic_router_dispatch(&event) != 1 || calls[i] != 1) {
+            fprintf(stderr, "%s not dispatched to its route\n", filters[i]);
+            failed = 1;
+        }
+    }
+    esp_mqtt_event_t truncated = { .topic = filters[0], .topic_len = strlen(filters[0]) - 1 };
+    printf("truncated topic %.*s: trie %d routes, strncmp chain %d routes\n", truncated.topic_len, truncated.topic,
+           topic_router_dispatch(&truncated), strncmp_chain(&truncated, ROUTES));
+    if (wildcard_calls != 0) {
+        failed = 1;
+    }
+
+    printf("%8s %14s %14s\n", "routes", "trie ns", "strncmp ns");
+    for (size_t r = 0; r < sizeof(route_counts) / sizeof(route_counts[0]); r++) {
+        int route_count = route_counts[r];
+        esp_mqtt_event_t *events = malloc(sizeof(esp_mqtt_event_t) * 1024);
+        struct timespec start, end;
+
+        srand(route_count);
+        for (int i = 0; i < 1024; i++) {
+            int route = rand() % route_count;
+            events[i] = (esp_mqtt_event_t){ .topic = filters[route], .topic_len = strlen(filters[route]) };
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < dispatches; i++) {
+            topic_router_dispatch(&events[i & 1023]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double trie_ns = elapsed_ns(&start, &end) / dispatches;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < dispatches; i++) {
+            strncmp_chain(&events[i & 1023], route_count);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double chain_ns = elapsed_ns(&start, &end) / dispatches;
+
+        printf("%8d %14.1f %14.1f\n", route_count, trie_ns, chain_ns);
+        free(events);
+    }
+    return failed;
+}
@@ -0,0 +1,23 @@
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for the ESP-IDF header. heap_caps.c simulates two regions, internal RAM and PSRAM, each a
+// good-fit allocator over a fixed arena, so fragmentation can be measured the way the target reports it.
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+// Simulation only: (re)create both regions, dropping everything allocated from them
+void heap_caps_sim_init(size_t internal_size, size_t spiram_size);
+size_t heap_caps_sim_failures(uint32_t caps);
+
+#endif // ESP_HEAP_CAPS_H
@@ -0,0 +1,16 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdio.h>
+
+// Host stand-in for the ESP-IDF header: errors and warnings go to stderr, the rest only with HOST_TEST_VERBOSE
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#ifdef HOST_TEST_VERBOSE
+#define ESP_LOGI(tag, format, ...) printf("I %s: " format "\n", tag, ##__VA_ARGS__)
+#else
+#define ESP_LOGI(tag, format, ...) do { if (0) { printf(format, ##__VA_ARGS__); } } while (0)
+#endif
+#define ESP_LOGD(tag, format, ...) do { if (0) { printf(format, ##__VA_ARGS__); } } while (0)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,53 @@
+#ifndef ESP_PARTITION_H
+#define ESP_PARTITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Host stand-in for the ESP-IDF header. partition.c backs one data partition with a file, mapped shared so
+// what was written survives the process, and behaves like NOR flash: erase sets a 4 KB sector to 0xFF,
+// writes can only clear bits. A write or erase can be torn, which ends the process the way a reset would.
+#define ESP_PARTITION_SIM_SECTOR_SIZE 4096
+#define ESP_PARTITION_SIM_TORN_EXIT 3       // exit status of a process stopped by a torn write
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+} esp_partition_t;
+
+typedef struct {
+    uint32_t writes;
+    uint64_t bytes_written;
+    uint32_t sectors_erased;
+} esp_partition_sim_counts_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+// Simulation only: map path as the partition called label, creating it erased if it doesn't exist
+esp_err_t esp_partition_sim_open(const char *label, const char *path, size_t size);
+// Each following write or erase stops part way with this probability, drawn from rand()
+void esp_partition_sim_tear(double probability);
+// The next count writes fail with ESP_FAIL without touching the flash
+void esp_partition_sim_fail_writes(int count);
+// Writes and erases that reached the flash since the partition was opened
+void esp_partition_sim_get_counts(esp_partition_sim_counts_t *counts);
+
+#endif // ESP_PARTITION_H
@@ -0,0 +1,14 @@
+#include "esp_rom_crc.h"
+
+// Bitwise CRC-32 (IEEE 802.3, reflected); like the ROM version the running value is passed in uninverted
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
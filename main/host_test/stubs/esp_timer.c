@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include "esp_timer.h"
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool armed;
+    int64_t due_us;
+    uint64_t period_us;         // 0 for a one-shot timer
+    struct esp_timer *next;
+};
+
+static int64_t now_us = 0;
+static struct esp_timer *timers = NULL;
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    if (timer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->args = *create_args;
+    timer->next = timers;
+    timers = timer;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->due_us = now_us + timeout_us;
+    timer->period_us = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->due_us = now_us + period;
+    timer->period_us = period;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    for (struct esp_timer **link = &timers; *link != NULL; link = &(*link)->next) {
+        if (*link == timer) {
+            *link = timer->next;
+            free(timer);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+// Fires due timers one at a time, earliest first, with the clock set to each one's due time
+void esp_timer_sim_advance(int64_t us)
+{
+    int64_t end_us = now_us + us;
+
+    while (true) {
+        struct esp_timer *earliest = NULL;
+        for (struct esp_timer *timer = timers; timer != NULL; timer = timer->next) {
+            if (timer->armed && timer->due_us <= end_us &&
+                (earliest == NULL || timer->due_us < earliest->due_us)) {
+                earliest = timer;
+            }
+        }
+        if (earliest == NULL) {
+            break;
+        }
+        now_us = earliest->due_us;
+        earliest->armed = earliest->period_us != 0;
+        earliest->due_us = now_us + earliest->period_us;
+        earliest->args.callback(earliest->args.arg);
+    }
+    now_us = end_us;
+}
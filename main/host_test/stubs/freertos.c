@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+// Host stand-in for the FreeRTOS calls the app makes. Ticks are milliseconds of the monotonic clock.
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t *items;
+};
+
+typedef struct {
+    TaskFunction_t task;
+    void *parameters;
+} task_start_t;
+
+#define MAX_NOTIFIED_TASKS 32
+
+static struct {
+    TaskHandle_t task;
+    uint32_t count;
+} notifications[MAX_NOTIFIED_TASKS];
+static int notified_tasks = 0;
+static pthread_mutex_t notify_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t notify_changed = PTHREAD_COND_INITIALIZER;
+
+// --------------------------------------------------------------------------------
+// Time
+// --------------------------------------------------------------------------------
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (TickType_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep(ticks * 1000);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake_time, TickType_t period)
+{
+    *previous_wake_time += period;
+    int32_t remaining = (int32_t)(*previous_wake_time - xTaskGetTickCount());
+    if (remaining > 0) {
+        usleep(remaining * 1000);
+    }
+}
+
+// Absolute CLOCK_REALTIME deadline for pthread_cond_timedwait
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+// Waits on the condition; false once the ticks have run out
+static bool wait_changed(pthread_cond_t *changed, pthread_mutex_t *lock, TickType_t ticks,
+                         const struct timespec *deadline)
+{
+    if (ticks == 0) {
+        return false;
+    }
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(changed, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(changed, lock, deadline) == 0;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Tasks
+// --------------------------------------------------------------------------------
+static void *task_entry(void *arg)
+{
+    task_start_t start = *(task_start_t *)arg;
+    free(arg);
+    start.task(start.parameters);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_depth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *created_task, BaseType_t core_id)
+{
+    pthread_t thread;
+    task_start_t *start = malloc(sizeof(*start));
+    if (start == NULL) {
+        return pdFAIL;
+    }
+    start->task = task;
+    start->parameters = parameters;
+    if (pthread_create(&thread, NULL, task_entry, start) != 0) {
+        free(start);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (created_task != NULL) {
+        *created_task = (TaskHandle_t)thread;
+    }
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t)pthread_self();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 0;       // not measured on the host
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
+
+static int notification_index(TaskHandle_t task)
+{
+    for (int i = 0; i < notified_tasks; i++) {
+        if (notifications[i].task == task) {
+            return i;
+        }
+    }
+    if (notified_tasks == MAX_NOTIFIED_TASKS) {
+        abort();
+    }
+    notifications[notified_tasks].task = task;
+    notifications[notified_tasks].count = 0;
+    return notified_tasks++;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = deadline_after(ticks_to_wait);
+
+    pthread_mutex_lock(&notify_lock);
+    int index = notification_index(xTaskGetCurrentTaskHandle());
+    while (notifications[index].count == 0 &&
+           wait_changed(&notify_changed, &notify_lock, ticks_to_wait, &deadline)) {
+    }
+    uint32_t count = notifications[index].count;
+    if (count > 0) {
+        notifications[index].count = clear_on_exit ? 0 : count - 1;
+    }
+    pthread_mutex_unlock(&notify_lock);
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&notify_lock);
+    notifications[notification_index(task)].count++;
+    pthread_cond_broadcast(&notify_changed);
+    pthread_mutex_unlock(&notify_lock);
+    return pdPASS;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Queues / Semaphores
+// --------------------------------------------------------------------------------
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t queue = calloc(1, sizeof(*queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->items = calloc(length, item_size ? item_size : 1);
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = deadline_after(ticks_to_wait);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        if (!wait_changed(&queue->changed, &queue->lock, ticks_to_wait, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    if (queue->item_size > 0) {
+        memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = deadline_after(ticks_to_wait);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (!wait_changed(&queue->changed, &queue->lock, ticks_to_wait, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+    }
+    if (queue->item_size > 0) {
+        memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+    if (mutex != NULL) {
+        xQueueSend(mutex, NULL, 0);
+    }
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+    return xQueueReceive(semaphore, NULL, ticks_to_wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return xQueueSend(semaphore, NULL, 0);
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,15 @@
+#ifndef FREERTOS_EVENT_GROUPS_H
+#define FREERTOS_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+// Host stand-in: the type and bit names headers refer to; nothing here waits on an event group
+typedef struct event_group *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+#define BIT0 (1u << 0)
+#define BIT1 (1u << 1)
+#define BIT2 (1u << 2)
+#define BIT3 (1u << 3)
+
+#endif // FREERTOS_EVENT_GROUPS_H
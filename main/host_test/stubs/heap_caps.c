@@ -0,0 +1,221 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+
+// Blocks carry boundary tags so a freed block merges with free neighbours on both sides. Free blocks are
+// kept on one list and allocation takes the smallest block that fits, close to the TLSF heap in ESP-IDF.
+typedef struct block {
+    size_t prev_size;           // 0 for the first block of the arena
+    size_t size;                // including this header; bit 0 set while allocated
+    struct block *next_free;    // only valid while free
+    struct block *prev_free;
+} block_t;
+
+#define HEADER_SIZE (2 * sizeof(size_t))
+#define ALIGNMENT 16
+#define MIN_BLOCK sizeof(block_t)
+#define USED 1
+
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    block_t *free_list;
+    size_t free_bytes;
+    size_t failures;
+} region_t;
+
+static region_t internal;
+static region_t spiram;
+
+// --------------------------------------------------------------------------------
+// Region
+// --------------------------------------------------------------------------------
+static size_t block_size(const block_t *block)
+{
+    return block->size & ~(size_t)USED;
+}
+
+static block_t *next_block(block_t *block)
+{
+    return (block_t *)((uint8_t *)block + block_size(block));
+}
+
+static void unlink_free(region_t *region, block_t *block)
+{
+    if (block->prev_free != NULL) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        region->free_list = block->next_free;
+    }
+    if (block->next_free != NULL) {
+        block->next_free->prev_free = block->prev_free;
+    }
+    region->free_bytes -= block_size(block) - HEADER_SIZE;
+}
+
+static void link_free(region_t *region, block_t *block)
+{
+    block->next_free = region->free_list;
+    block->prev_free = NULL;
+    if (region->free_list != NULL) {
+        region->free_list->prev_free = block;
+    }
+    region->free_list = block;
+    region->free_bytes += block_size(block) - HEADER_SIZE;
+}
+
+static void region_init(region_t *region, size_t size)
+{
+    free(region->base);
+    memset(region, 0, sizeof(*region));
+    if (size == 0) {
+        return;
+    }
+    region->base = aligned_alloc(ALIGNMENT, size);
+    region->size = size;
+
+    // One free block, then a permanently allocated header that stops merging at the end of the arena
+    block_t *block = (block_t *)region->base;
+    block->prev_size = 0;
+    block->size = size - HEADER_SIZE;
+    block_t *end = next_block(block);
+    end->prev_size = block->size;
+    end->size = HEADER_SIZE | USED;
+    link_free(region, block);
+}
+
+static void *region_malloc(region_t *region, size_t size)
+{
+    size_t needed = (size + HEADER_SIZE + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+    block_t *best = NULL;
+
+    if (needed < MIN_BLOCK) {
+        needed = MIN_BLOCK;
+    }
+    for (block_t *block = region->free_list; block != NULL; block = block->next_free) {
+        if (block_size(block) >= needed && (best == NULL || block_size(block) < block_size(best))) {
+            best = block;
+            if (block_size(block) == needed) {
+                break;
+            }
+        }
+    }
+    if (best == NULL) {
+        region->failures++;
+        return NULL;
+    }
+
+    unlink_free(region, best);
+    if (block_size(best) - needed >= MIN_BLOCK) {
+        block_t *rest = (block_t *)((uint8_t *)best + needed);
+        rest->prev_size = needed;
+        rest->size = block_size(best) - needed;
+        next_block(rest)->prev_size = rest->size;
+        best->size = needed;
+        link_free(region, rest);
+    }
+    best->size |= USED;
+    return (uint8_t *)best + HEADER_SIZE;
+}
+
+static void region_free(region_t *region, void *ptr)
+{
+    block_t *block = (block_t *)((uint8_t *)ptr - HEADER_SIZE);
+    block->size &= ~(size_t)USED;
+
+    block_t *next = next_block(block);
+    if (!(next->size & USED)) {
+        unlink_free(region, next);
+        block->size += next->size;
+    }
+    if (block->prev_size != 0) {
+        block_t *prev = (block_t *)((uint8_t *)block - block->prev_size);
+        if (!(prev->size & USED)) {
+            unlink_free(region, prev);
+            prev->size += block->size;
+            block = prev;
+        }
+    }
+    next_block(block)->prev_size = block->size;
+    link_free(region, block);
+}
+
+static size_t region_largest(const region_t *region)
+{
+    size_t largest = 0;
+
+    for (const block_t *block = region->free_list; block != NULL; block = block->next_free) {
+        if (block_size(block) - HEADER_SIZE > largest) {
+            largest = block_size(block) - HEADER_SIZE;
+        }
+    }
+    return largest;
+}
+
+static bool region_owns(const region_t *region, const void *ptr)
+{
+    return region->base != NULL && (const uint8_t *)ptr >= region->base &&
+           (const uint8_t *)ptr < region->base + region->size;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// heap_caps API
+// --------------------------------------------------------------------------------
+void heap_caps_sim_init(size_t internal_size, size_t spiram_size)
+{
+    region_init(&internal, internal_size);
+    region_init(&spiram, spiram_size);
+}
+
+size_t heap_caps_sim_failures(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? spiram.failures : internal.failures;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return spiram.base != NULL ? region_malloc(&spiram, size) : NULL;
+    }
+    void *ptr = region_malloc(&internal, size);
+    if (ptr == NULL && !(caps & MALLOC_CAP_INTERNAL) && spiram.base != NULL) {
+        ptr = region_malloc(&spiram, size);
+    }
+    return ptr;
+}
+
+void heap_caps_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    if (region_owns(&internal, ptr)) {
+        region_free(&internal, ptr);
+    } else if (region_owns(&spiram, ptr)) {
+        region_free(&spiram, ptr);
+    } else {
+        abort();        // not from either region
+    }
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return spiram.free_bytes;
+    }
+    return internal.free_bytes + ((caps & MALLOC_CAP_INTERNAL) ? 0 : spiram.free_bytes);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    size_t largest = (caps & MALLOC_CAP_SPIRAM) ? 0 : region_largest(&internal);
+
+    if (!(caps & MALLOC_CAP_INTERNAL) && region_largest(&spiram) > largest) {
+        largest = region_largest(&spiram);
+    }
+    return largest;
+}
+// --------------------------------------------------------------------------------
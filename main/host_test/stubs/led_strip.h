@@ -0,0 +1,7 @@
+#ifndef LED_STRIP_H
+#define LED_STRIP_H
+
+// Host stand-in for the led_strip component: only the handle type led_control.h needs
+typedef struct led_strip_t *led_strip_handle_t;
+
+#endif // LED_STRIP_H
@@ -0,0 +1,16 @@
+#ifndef MQTT5_CLIENT_H
+#define MQTT5_CLIENT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+// Host stand-in for the esp-mqtt MQTT 5 header: the one-shot publish property mqtt_publish.c sets
+typedef struct {
+    uint16_t topic_alias;
+} esp_mqtt5_publish_property_config_t;
+
+esp_err_t esp_mqtt5_client_set_publish_property(esp_mqtt_client_handle_t client,
+                                                const esp_mqtt5_publish_property_config_t *property);
+
+#endif // MQTT5_CLIENT_H
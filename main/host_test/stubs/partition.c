@@ -0,0 +1,145 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "esp_partition.h"
+
+static esp_partition_t sim_partition;
+static uint8_t *flash = NULL;
+static double tear_probability = 0;
+static int failing_writes = 0;
+static esp_partition_sim_counts_t counts;
+
+// --------------------------------------------------------------------------------
+// Simulation
+// --------------------------------------------------------------------------------
+esp_err_t esp_partition_sim_open(const char *label, const char *path, size_t size)
+{
+    if (flash != NULL || size % ESP_PARTITION_SIM_SECTOR_SIZE != 0 || strlen(label) >= sizeof(sim_partition.label)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    off_t existing = lseek(fd, 0, SEEK_END);
+    if ((existing != 0 && existing != (off_t)size) || (existing == 0 && ftruncate(fd, size) != 0)) {
+        close(fd);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    flash = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (flash == MAP_FAILED) {
+        flash = NULL;
+        return ESP_FAIL;
+    }
+    if (existing == 0) {
+        memset(flash, 0xFF, size);
+    }
+
+    sim_partition.type = ESP_PARTITION_TYPE_DATA;
+    sim_partition.subtype = ESP_PARTITION_SUBTYPE_ANY;
+    sim_partition.size = size;
+    sim_partition.erase_size = ESP_PARTITION_SIM_SECTOR_SIZE;
+    strcpy(sim_partition.label, label);
+    memset(&counts, 0, sizeof(counts));
+    return ESP_OK;
+}
+
+void esp_partition_sim_tear(double probability)
+{
+    tear_probability = probability;
+}
+
+void esp_partition_sim_fail_writes(int count)
+{
+    failing_writes = count;
+}
+
+void esp_partition_sim_get_counts(esp_partition_sim_counts_t *out)
+{
+    *out = counts;
+}
+
+// Decides whether this operation is torn, and if so how many of its bytes reach the flash
+static bool torn(size_t size, size_t *done)
+{
+    if (tear_probability <= 0 || (double)rand() / RAND_MAX >= tear_probability) {
+        return false;
+    }
+    *done = size > 0 ? (size_t)rand() % size : 0;
+    return true;
+}
+
+static void reset(void)
+{
+    msync(flash, sim_partition.size, MS_SYNC);
+    _exit(ESP_PARTITION_SIM_TORN_EXIT);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Partition API
+// --------------------------------------------------------------------------------
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    if (flash == NULL || type != sim_partition.type || (label != NULL && strcmp(label, sim_partition.label) != 0)) {
+        return NULL;
+    }
+    return &sim_partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (partition != &sim_partition || src_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, flash + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    const uint8_t *bytes = src;
+    size_t done = size;
+
+    if (partition != &sim_partition || dst_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (failing_writes > 0) {
+        failing_writes--;
+        return ESP_FAIL;
+    }
+    bool tear = torn(size, &done);
+    for (size_t i = 0; i < done; i++) {
+        flash[dst_offset + i] &= bytes[i];
+    }
+    counts.writes++;
+    counts.bytes_written += done;
+    if (tear) {
+        reset();
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    size_t done = size;
+
+    if (partition != &sim_partition || offset + size > partition->size ||
+        offset % ESP_PARTITION_SIM_SECTOR_SIZE != 0 || size % ESP_PARTITION_SIM_SECTOR_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool tear = torn(size, &done);
+    memset(flash + offset, 0xFF, done);
+    counts.sectors_erased += size / ESP_PARTITION_SIM_SECTOR_SIZE;
+    if (tear) {
+        reset();
+    }
+    return ESP_OK;
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,179 @@
+// backpressure.c over the real outbox ring through a 60 s broker stall, on the virtual clock. A producer
+// publishes a 200-byte QoS 1 message every 500 ms nominal; the broker answers in 50 ms, except between
+// 20 s and 80 s when it answers nothing. Run once with the producer following backpressure_can_send()
+// and backpressure_scale_interval(), and once ignoring them, for comparison.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_timer.h>
+#include <mqtt_outbox.h>
+#include "mqtt_handler.h"
+#include "work_queue.h"
+#include "backpressure.h"
+
+#define MESSAGE_SIZE 200
+#define NOMINAL_INTERVAL_MS 500
+#define RTT_MS 50
+#define STALL_START_MS 20000
+#define STALL_END_MS 80000
+#define RUN_MS 200000
+#define STEP_MS 10
+#define MSG_TYPE_PUBLISH 3
+
+esp_mqtt_client_handle_t mqtt_client = NULL;
+bool mqtt_connected = true;
+
+static outbox_handle_t outbox = NULL;
+
+// --------------------------------------------------------------------------------
+// Stand-ins
+// --------------------------------------------------------------------------------
+esp_err_t work_queue_submit_io(work_fn_t fn, void *arg)
+{
+    fn(arg);
+    return ESP_OK;
+}
+
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t client)
+{
+    return outbox_get_size(outbox);
+}
+// --------------------------------------------------------------------------------
+
+typedef struct {
+    size_t peak_bytes;
+    size_t refused;
+    uint32_t sent;
+    uint32_t min_rate;
+    int64_t recovered_ms;       // rate back at 100% after the stall, -1 if it never was
+    int64_t max_rtt_ms;         // longest round trip the broker gave
+    int64_t last_rtt_ms;
+    uint32_t srtt_ms;           // the controller's smoothed round trip at the end
+    bool srtt_out_of_range;     // ever above the longest round trip so far
+} run_result_t;
+
+static run_result_t run(bool follow_backpressure)
+{
+    static int64_t sent_ms[65536];      // by message id
+    static uint8_t message[MESSAGE_SIZE];
+    run_result_t result = { .min_rate = 100, .recovered_ms = -1 };
+    outbox_ring_stats_t before;
+    int next_id = 1;
+    int64_t next_send_ms = 0;
+
+    outbox_ring_get_stats(&before);
+    for (int64_t now_ms = 0; now_ms < RUN_MS; now_ms += STEP_MS) {
+        esp_timer_sim_advance(STEP_MS * 1000LL);
+        bool stalled = now_ms >= STALL_START_MS && now_ms < STALL_END_MS;
+
+        // The producer, stretched and held back by the controller when following it
+        if (now_ms >= next_send_ms) {
+            if (!follow_backpressure || backpressure_can_send()) {
+                outbox_message_t publish = {
+                    .data = message,
+                    .len = MESSAGE_SIZE,
+                    .msg_id = next_id,
+                    .msg_qos = 1,
+                    .msg_type = MSG_TYPE_PUBLISH,
+                };
+                if (outbox_enqueue(outbox, &publish, now_ms) != NULL) {
+                    sent_ms[next_id] = now_ms;
+                    backpressure_on_sent(next_id);
+                    result.sent++;
+                }
+                next_id = next_id == 65535 ? 1 : next_id + 1;
+            }
+            next_send_ms = now_ms + (follow_backpressure ? backpressure_scale_interval(NOMINAL_INTERVAL_MS)
+                                                         : NOMINAL_INTERVAL_MS);
+        }
+
+        // The broker acknowledges everything older than the round trip, oldest first, unless stalled
+        outbox_tick_t tick;
+        outbox_item_handle_t item;
+        while (!stalled && (item = outbox_dequeue(outbox, QUEUED, &tick)) != NULL && now_ms - tick >= RTT_MS) {
+            size_t len;
+            uint16_t msg_id;
+            int msg_type, qos;
+            outbox_item_get_data(item, &len, &msg_id, &msg_type, &qos);
+            outbox_delete_item(outbox, item);
+            backpressure_on_acked(msg_id);
+            result.last_rtt_ms = now_ms - sent_ms[msg_id];
+            if (result.last_rtt_ms > result.max_rtt_ms) {
+                result.max_rtt_ms = result.last_rtt_ms;
+            }
+        }
+
+        // A smoothed average of some of the round trips can't be longer than all of them
+        backpressure_stats_t stats;
+        backpressure_get_stats(&stats);
+        if (stats.srtt_ms > result.max_rtt_ms && result.max_rtt_ms > 0) {
+            result.srtt_out_of_range = true;
+        }
+        result.srtt_ms = stats.srtt_ms;
+        if (stats.rate < result.min_rate) {
+            result.min_rate = stats.rate;
+        }
+        if (now_ms >= STALL_END_MS && stats.rate == 100 && result.recovered_ms < 0) {
+            result.recovered_ms = now_ms - STALL_END_MS;
+        }
+    }
+
+    outbox_ring_stats_t after;
+    outbox_ring_get_stats(&after);
+    result.peak_bytes = after.peak_bytes;
+    result.refused = after.rejected - before.rejected;
+    return result;
+}
+
+static void report(const char *name, const run_result_t *result, bool rate)
+{
+    printf("%-22s %4u sent, %3zu refused by the outbox, outbox peak %4zu of %d bytes", name, (unsigned)result->sent,
+           result->refused, result->peak_bytes, OUTBOX_RING_SIZE);
+    if (rate) {
+        printf(", rate down to %u%%, back to 100%% %.1f s after the stall; smoothed RTT %u ms, longest %lld ms",
+               (unsigned)result->min_rate, result->recovered_ms / 1000.0, (unsigned)result->srtt_ms,
+               (long long)result->max_rtt_ms);
+    }
+    printf("\n");
+}
+
+int main(void)
+{
+    outbox = outbox_init();
+    if (outbox == NULL || backpressure_init() != ESP_OK) {
+        return 1;
+    }
+
+    run_result_t with = run(true);
+    outbox_destroy(outbox);
+    outbox = outbox_init();
+    run_result_t without = run(false);
+
+    report("with backpressure", &with, true);
+    report("ignoring backpressure", &without, false);
+
+    // The controller has to keep the outbox below its high-water mark plus what is in flight as it
+    // reacts, and come back to the full rate once the broker does
+    int failed = 0;
+    if (with.refused != 0 || with.peak_bytes >= OUTBOX_RING_SIZE * 3 / 4) {
+        fprintf(stderr, "outbox not held back during the stall\n");
+        failed = 1;
+    }
+    if (with.min_rate != BACKPRESSURE_MIN_RATE || with.recovered_ms < 0 || with.recovered_ms > 60000) {
+        fprintf(stderr, "rate did not fall to the floor and recover\n");
+        failed = 1;
+    }
+    // Once the broker is back to normal the smoothed round trip has to settle on what it really takes
+    if (with.srtt_out_of_range || with.srtt_ms + STEP_MS < with.last_rtt_ms ||
+        with.srtt_ms > with.last_rtt_ms + STEP_MS) {
+        fprintf(stderr, "smoothed RTT %u ms disagrees with the broker's %lld ms\n", (unsigned)with.srtt_ms,
+                (long long)with.last_rtt_ms);
+        failed = 1;
+    }
+    if (without.refused == 0) {
+        fprintf(stderr, "the stall is too short to fill the outbox without backpressure\n");
+        failed = 1;
+    }
+    return failed;
+}
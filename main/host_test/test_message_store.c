@@ -0,0 +1,440 @@
+// message_store.c on a file-backed flash partition (stubs/partition.c) and a virtual clock.
+//
+// Scenarios, each in a fresh process on an erased partition:
+//   lost_puback     a PUBACK never arrives: only that message is sent again after the resend timeout,
+//                   not the rest of the window
+//   queue_full      the PUBACK arrives while the work queue is full: it is still recorded
+//   ack_write_fail  writing the acknowledgement fails: it is kept and written by the next commit
+//   recovery        many boots of random appends, reconnects and lost PUBACKs over an 8-segment log, where
+//                   any flash write or erase may be torn and end the boot; a last clean boot then has to
+//                   deliver every message whose append returned, without ever delivering a corrupt one
+//   throughput      the same stream of messages, PUBACKed as they go out, once with the work queue
+//                   running after every burst of appends (batched commits) and once running each item as
+//                   it is submitted (one commit per append); reports messages/s on this host and flash
+//                   writes and sector erases per message
+// Usage: test_message_store [boots]
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include "mqtt_handler.h"
+#include "mqtt_publish.h"
+#include "publish_policy.h"
+#include "work_queue.h"
+#include "message_store.h"
+
+#define FLASH_FILE "test_message_store.flash"
+#define SEGMENTS 8
+#define BUTTON_TOPIC "esp32/kiosk/" KIOSK_NAME "/button"
+#define MAX_MESSAGES 200000
+#define STEPS_PER_BOOT 2000
+#define TEAR_PROBABILITY 0.002              // per flash write or erase
+#define PUBACK_LOSS 0.02
+#define THROUGHPUT_MESSAGES 20000
+#define THROUGHPUT_BURST 8                  // appends before the worker gets to run
+
+esp_mqtt_client_handle_t mqtt_client = NULL;
+bool mqtt_connected = false;
+
+// Outlives the boots: every boot is a forked process
+typedef struct {
+    int next_message;
+    uint8_t appended[MAX_MESSAGES];     // append returned ESP_OK and nothing was rejected
+    uint16_t delivered[MAX_MESSAGES];
+    int corrupt;
+    int torn_boots;
+    message_store_stats_t final_stats;
+    struct {
+        double messages_per_s;
+        esp_partition_sim_counts_t flash;
+    } throughput[2];
+} history_t;
+
+static history_t *history;
+
+static struct {
+    int awaiting[64];           // msg_ids published and not acknowledged yet
+    int awaiting_count;
+    int next_msg_id;
+    int lost_pubacks;
+    int last_delivered;
+} broker = { .next_msg_id = 1 };
+
+static bool work_queue_full = false;
+static bool work_queue_deferred = false;
+static struct {
+    work_fn_t fn;
+    void *arg;
+} work_items[WORK_QUEUE_IO_LENGTH];
+static int work_count = 0;
+
+// --------------------------------------------------------------------------------
+// Stand-ins
+// --------------------------------------------------------------------------------
+publish_policy_t publish_policy_get(publish_policy_class_t cls)
+{
+    return (publish_policy_t){ .qos = 1, .retain = false };
+}
+
+// Runs the item straight away, as if the worker were idle, or holds it for run_work_queue()
+esp_err_t work_queue_submit_io(work_fn_t fn, void *arg)
+{
+    if (work_queue_full || (work_queue_deferred && work_count == WORK_QUEUE_IO_LENGTH)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (work_queue_deferred) {
+        work_items[work_count].fn = fn;
+        work_items[work_count].arg = arg;
+        work_count++;
+        return ESP_OK;
+    }
+    fn(arg);
+    return ESP_OK;
+}
+
+int mqtt_publish(const char *topic, const char *data, int len, int qos, bool retain)
+{
+    int message;
+    char payload[64];
+
+    if (!mqtt_connected || broker.awaiting_count == sizeof(broker.awaiting) / sizeof(broker.awaiting[0])) {
+        return -1;
+    }
+    snprintf(payload, sizeof(payload), "%.*s", len, data);
+    if (strcmp(topic, BUTTON_TOPIC) != 0 || sscanf(payload, "{\"n\":%d}", &message) != 1 || message < 0 ||
+        message >= MAX_MESSAGES) {
+        fprintf(stderr, "corrupt message on %s: %s\n", topic, payload);
+        history->corrupt++;
+        return -1;
+    }
+    history->delivered[message]++;
+    broker.last_delivered = message;
+    broker.awaiting[broker.awaiting_count++] = broker.next_msg_id;
+    return broker.next_msg_id++;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Helpers
+// --------------------------------------------------------------------------------
+static void boot(void)
+{
+    if (esp_partition_sim_open(MESSAGE_STORE_PARTITION, FLASH_FILE, SEGMENTS * MESSAGE_STORE_SEGMENT_SIZE) != ESP_OK ||
+        message_store_init() != ESP_OK) {
+        fprintf(stderr, "message store failed to start\n");
+        exit(1);
+    }
+}
+
+static void connect(void)
+{
+    mqtt_connected = true;
+    broker.awaiting_count = 0;      // PUBACKs of the old connection are gone with it
+    message_store_on_connected();
+}
+
+static bool append(void)
+{
+    message_store_stats_t before, after;
+    char payload[32];
+    int message = history->next_message++;
+
+    message_store_get_stats(&before);
+    int length = snprintf(payload, sizeof(payload), "{\"n\":%d}", message);
+    esp_err_t err = message_store_append(BUTTON_TOPIC, payload, length);
+    message_store_get_stats(&after);
+    if (err == ESP_OK && after.rejected == before.rejected) {
+        history->appended[message] = 1;
+        return true;
+    }
+    return false;
+}
+
+// PUBACK for the index'th awaiting publish, or lose it
+static void puback(int index, bool lose)
+{
+    int msg_id = broker.awaiting[index];
+    broker.awaiting[index] = broker.awaiting[--broker.awaiting_count];
+    if (lose) {
+        broker.lost_pubacks++;
+    } else {
+        message_store_on_published(msg_id);
+    }
+}
+
+static int puback_of(int msg_id)
+{
+    for (int i = 0; i < broker.awaiting_count; i++) {
+        if (broker.awaiting[i] == msg_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// The worker getting the CPU: runs what is queued, and what that queues in turn
+static void run_work_queue(void)
+{
+    while (work_count > 0) {
+        work_fn_t fn = work_items[0].fn;
+        void *arg = work_items[0].arg;
+        memmove(work_items, work_items + 1, --work_count * sizeof(work_items[0]));
+        fn(arg);
+    }
+}
+
+static message_store_stats_t stats(void)
+{
+    message_store_stats_t snapshot;
+    message_store_get_stats(&snapshot);
+    return snapshot;
+}
+
+#define CHECK(condition)                                                    \
+    do {                                                                    \
+        if (!(condition)) {                                                 \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Scenarios
+// --------------------------------------------------------------------------------
+static void lost_puback(void)
+{
+    boot();
+    connect();
+    CHECK(append());
+    int first = broker.last_delivered;
+    int first_id = broker.next_msg_id - 1;
+    esp_timer_sim_advance(30 * 1000000LL);
+    CHECK(append());
+    int second = broker.last_delivered;
+
+    // The first PUBACK is lost; the second message is still within its timeout when the first runs out
+    puback(puback_of(first_id), true);
+    esp_timer_sim_advance((MESSAGE_STORE_RESEND_MS + MESSAGE_STORE_SERVICE_MS) * 1000LL - 30 * 1000000LL);
+    CHECK(stats().resent == 1);
+    CHECK(history->delivered[first] == 2);
+    CHECK(history->delivered[second] == 1);
+
+    while (broker.awaiting_count > 0) {
+        puback(0, false);
+    }
+    CHECK(stats().pending == 0);
+    CHECK(stats().acknowledged == 2);
+}
+
+static void queue_full(void)
+{
+    boot();
+    connect();
+    CHECK(append());
+    int message = broker.last_delivered;
+
+    work_queue_full = true;
+    puback(0, false);
+    work_queue_full = false;
+    esp_timer_sim_advance((MESSAGE_STORE_SERVICE_MS + 1) * 1000LL);
+    CHECK(stats().acknowledged == 1);
+    CHECK(stats().pending == 0);
+
+    esp_timer_sim_advance((MESSAGE_STORE_RESEND_MS + MESSAGE_STORE_SERVICE_MS) * 1000LL);
+    CHECK(stats().resent == 0);
+    CHECK(history->delivered[message] == 1);
+}
+
+static void ack_write_fail(void)
+{
+    boot();
+    connect();
+    CHECK(append());
+    int message = broker.last_delivered;
+
+    esp_partition_sim_fail_writes(1);
+    puback(0, false);
+    CHECK(stats().acknowledged == 0);
+    CHECK(stats().pending == 1);
+
+    // The next commit writes it; meanwhile the message is not sent again
+    esp_timer_sim_advance((MESSAGE_STORE_SERVICE_MS + 1) * 1000LL);
+    CHECK(stats().acknowledged == 1);
+    CHECK(stats().pending == 0);
+    esp_timer_sim_advance((MESSAGE_STORE_RESEND_MS + MESSAGE_STORE_SERVICE_MS) * 1000LL);
+    CHECK(history->delivered[message] == 1);
+}
+
+static void recovery_boot(int seed)
+{
+    srand(seed);
+    boot();
+    esp_partition_sim_tear(TEAR_PROBABILITY);
+
+    for (int step = 0; step < STEPS_PER_BOOT && history->next_message < MAX_MESSAGES; step++) {
+        esp_timer_sim_advance((rand() % 200) * 1000LL);
+        int choice = rand() % 100;
+        if (choice < 10) {
+            append();
+        } else if (choice < 12) {
+            if (mqtt_connected) {
+                mqtt_connected = false;
+            } else {
+                connect();
+            }
+        } else if (choice < 40 && broker.awaiting_count > 0) {
+            puback(rand() % broker.awaiting_count, (double)rand() / RAND_MAX < PUBACK_LOSS);
+        }
+    }
+}
+
+static void recovery_drain(void)
+{
+    boot();
+    connect();
+    for (int round = 0; round < 1000 && stats().pending > 0; round++) {
+        while (broker.awaiting_count > 0) {
+            puback(0, false);
+        }
+        esp_timer_sim_advance((MESSAGE_STORE_RESEND_MS + MESSAGE_STORE_SERVICE_MS) * 1000LL);
+    }
+    history->final_stats = stats();
+    CHECK(history->final_stats.pending == 0);
+}
+
+static void throughput(int batched)
+{
+    struct timespec start, end;
+
+    work_queue_deferred = batched;
+    boot();
+    connect();
+    run_work_queue();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (history->next_message < THROUGHPUT_MESSAGES) {
+        for (int i = 0; i < THROUGHPUT_BURST; i++) {
+            CHECK(append());
+        }
+        run_work_queue();
+        // The PUBACKs for the window arrive together, while the worker is busy
+        while (broker.awaiting_count > 0) {
+            while (broker.awaiting_count > 0) {
+                puback(0, false);
+            }
+            run_work_queue();
+        }
+        esp_timer_sim_advance(1000);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    CHECK(stats().pending == 0);
+    for (int i = 0; i < THROUGHPUT_MESSAGES; i++) {
+        CHECK(history->delivered[i] == 1);
+    }
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    history->throughput[batched].messages_per_s = THROUGHPUT_MESSAGES / seconds;
+    esp_partition_sim_get_counts(&history->throughput[batched].flash);
+}
+// --------------------------------------------------------------------------------
+
+
+// Runs fn in a child process, as one boot of the device
+static int run(void (*fn)(int), int arg)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn(arg);
+        exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void scenario(int index)
+{
+    static void (*const scenarios[])(void) = { lost_puback, queue_full, ack_write_fail, recovery_drain };
+    scenarios[index]();
+}
+
+int main(int argc, char **argv)
+{
+    static const char *const names[] = { "lost_puback", "queue_full", "ack_write_fail" };
+    int boots = argc > 1 ? atoi(argv[1]) : 200;
+    int failed = 0;
+
+    history = mmap(NULL, sizeof(*history), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (history == MAP_FAILED) {
+        return 1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        unlink(FLASH_FILE);
+        memset(history, 0, sizeof(*history));
+        int status = run(scenario, i);
+        printf("%-15s %s\n", names[i], status == 0 ? "ok" : "FAILED");
+        failed |= status != 0;
+    }
+
+    unlink(FLASH_FILE);
+    memset(history, 0, sizeof(*history));
+    for (int i = 0; i < boots; i++) {
+        int status = run(recovery_boot, i + 1);
+        if (status == ESP_PARTITION_SIM_TORN_EXIT) {
+            history->torn_boots++;
+        } else if (status != 0) {
+            printf("recovery boot %d FAILED\n", i);
+            return 1;
+        }
+    }
+    if (run(scenario, 3) != 0) {
+        printf("recovery drain FAILED\n");
+        return 1;
+    }
+
+    int appended = 0, lost = 0, duplicates = 0;
+    for (int i = 0; i < history->next_message; i++) {
+        appended += history->appended[i];
+        if (history->appended[i] && history->delivered[i] == 0) {
+            if (lost++ < 10) {
+                fprintf(stderr, "message %d appended but never delivered\n", i);
+            }
+        }
+        duplicates += history->delivered[i] > 1 ? history->delivered[i] - 1 : 0;
+    }
+    const message_store_stats_t *final = &history->final_stats;
+    printf("recovery        %d boots, %d torn; %d of %d messages appended, %d lost, %d duplicates, %d corrupt; "
+           "max erase count %u\n", boots, history->torn_boots, appended, history->next_message, lost, duplicates,
+           history->corrupt, (unsigned)final->max_erase_count);
+    failed |= lost != 0 || history->corrupt != 0 || history->torn_boots == 0 || final->max_erase_count < 2;
+
+    // Batching has to save flash writes; the erases are the same log either way
+    static const char *const modes[] = { "one per append", "batched" };
+    for (int batched = 0; batched < 2; batched++) {
+        unlink(FLASH_FILE);
+        memset(history, 0, sizeof(*history) - sizeof(history->throughput));
+        if (run(throughput, batched) != 0) {
+            printf("throughput %s FAILED\n", modes[batched]);
+            return 1;
+        }
+        const esp_partition_sim_counts_t *flash = &history->throughput[batched].flash;
+        printf("throughput      %-15s %8.0f messages/s, %.2f writes (%.1f bytes), %.4f sector erases per message\n",
+               modes[batched], history->throughput[batched].messages_per_s,
+               (double)flash->writes / THROUGHPUT_MESSAGES, (double)flash->bytes_written / THROUGHPUT_MESSAGES,
+               (double)flash->sectors_erased / THROUGHPUT_MESSAGES);
+    }
+    failed |= history->throughput[1].flash.writes >= history->throughput[0].flash.writes;
+
+    unlink(FLASH_FILE);
+    return failed;
+}
@@ -0,0 +1,179 @@
+// mqtt_publish.c against a scripted MQTT 5 broker that checks every aliased packet and counts the bytes each
+// PUBLISH takes on the wire, with and without the alias. Sends a day of telemetry frames plus LED status
+// refreshes, reconnecting every few hundred frames. Some reconnects happen while a publish still holds
+// publish_lock, the way the CONNECTED handler can run on the MQTT task: the alias reset must not wait for it.
+// Usage: test_mqtt_publish [frames]
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mqtt5_client.h>
+#include "mqtt_handler.h"
+#include "mqtt_publish.h"
+
+#define TELEMETRY_TOPIC "esp32/kiosk/" KIOSK_NAME "/telemetry"
+#define LED_STATUS_TOPIC "esp32/kiosk/" KIOSK_NAME "/led_status"
+#define TELEMETRY_FRAME_SIZE 420            // a typical frame, see telemetry.h
+#define TOPIC_ALIAS_MAXIMUM 4               // what the broker advertises
+#define RECONNECT_EVERY 500                 // telemetry frames
+#define FRAMES_PER_DAY (24 * 3600 / 10)
+
+esp_mqtt_client_handle_t mqtt_client = NULL;
+bool mqtt_connected = false;
+
+typedef struct {
+    long packets;
+    long bytes;                 // as sent
+    long unaliased_bytes;       // the same packets with the full topic and no alias property
+} wire_count_t;
+
+static struct {
+    char aliases[TOPIC_ALIAS_MAXIMUM + 1][MQTT_PUBLISH_TOPIC_SIZE];     // per connection, index 0 unused
+    uint16_t pending_alias;     // the publish property, consumed by the next publish
+    bool connect_in_publish;    // run the CONNECTED handler from inside the next publish
+    int connections;
+    int errors;
+    wire_count_t telemetry;
+    wire_count_t other;
+} broker;
+
+void backpressure_on_sent(int msg_id)
+{
+}
+
+static int varint_size(int value)
+{
+    int size = 1;
+    while (value >= 128) {
+        value /= 128;
+        size++;
+    }
+    return size;
+}
+
+// Fixed header, topic, packet id for QoS > 0, properties, payload
+static int publish_size(int topic_len, int qos, bool alias, int len)
+{
+    int properties = alias ? 3 : 0;
+    int remaining = 2 + topic_len + (qos > 0 ? 2 : 0) + varint_size(properties) + properties + len;
+    return 1 + varint_size(remaining) + remaining;
+}
+
+static void count(const char *topic, int qos, bool alias, int len, int sent_topic_len)
+{
+    wire_count_t *counter = strcmp(topic, TELEMETRY_TOPIC) == 0 ? &broker.telemetry : &broker.other;
+    counter->packets++;
+    counter->bytes += publish_size(sent_topic_len, qos, alias, len);
+    counter->unaliased_bytes += publish_size(strlen(topic), qos, false, len);
+}
+
+// What the CONNECTED handler does for aliases: a fresh connection knows none
+static void connect(void)
+{
+    memset(broker.aliases, 0, sizeof(broker.aliases));
+    broker.connections++;
+    mqtt_connected = true;
+    mqtt_publish_reset_aliases();
+}
+
+esp_err_t esp_mqtt5_client_set_publish_property(esp_mqtt_client_handle_t client,
+                                                const esp_mqtt5_publish_property_config_t *property)
+{
+    broker.pending_alias = property->topic_alias;
+    return ESP_OK;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos,
+                            int retain)
+{
+    uint16_t alias = broker.pending_alias;
+    broker.pending_alias = 0;
+    if (!mqtt_connected || alias > TOPIC_ALIAS_MAXIMUM) {
+        return -1;
+    }
+
+    const char *resolved = topic;
+    if (alias != 0 && topic[0] == '\0') {
+        resolved = broker.aliases[alias];
+        if (resolved[0] == '\0') {
+            fprintf(stderr, "connection %d: alias %u used before it was set\n", broker.connections, alias);
+            broker.errors++;
+            return -1;
+        }
+    } else if (alias != 0) {
+        strcpy(broker.aliases[alias], topic);
+    }
+    count(resolved, qos, alias != 0, len, strlen(topic));
+
+    if (broker.connect_in_publish) {
+        broker.connect_in_publish = false;
+        connect();
+    }
+    return 0;
+}
+
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos,
+                            int retain, bool store)
+{
+    if (broker.pending_alias != 0) {
+        fprintf(stderr, "alias %u left set for an outbox publish to %s\n", broker.pending_alias, topic);
+        broker.errors++;
+        broker.pending_alias = 0;
+    }
+    count(topic, qos, false, len, strlen(topic));
+    return qos > 0 ? 1 : 0;
+}
+
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t client)
+{
+    return 0;
+}
+
+static void report(const char *name, const wire_count_t *counter, long scale)
+{
+    printf("%-11s %6ld packets, %8ld bytes (%ld without aliases, %.1f%% saved)\n", name, counter->packets * scale,
+           counter->bytes * scale, counter->unaliased_bytes * scale,
+           counter->unaliased_bytes ? 100.0 * (counter->unaliased_bytes - counter->bytes) / counter->unaliased_bytes : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : FRAMES_PER_DAY;
+    static char frame[TELEMETRY_FRAME_SIZE];
+    memset(frame, 'x', sizeof(frame));
+
+    if (mqtt_publish_init() != ESP_OK) {
+        return 1;
+    }
+    connect();
+
+    for (int i = 0; i < frames; i++) {
+        if (i % RECONNECT_EVERY == RECONNECT_EVERY - 1) {
+            // Every other reconnect lands while mqtt_publish() is between its lock and the client's
+            if ((i / RECONNECT_EVERY) % 2 == 0) {
+                broker.connect_in_publish = true;
+            } else {
+                mqtt_connected = false;
+                connect();
+            }
+        }
+        if (mqtt_publish(TELEMETRY_TOPIC, frame, sizeof(frame), 0, false) < 0) {
+            fprintf(stderr, "telemetry frame %d not sent\n", i);
+            broker.errors++;
+        }
+        // The LED status refresh, every 5 minutes
+        if (i % 30 == 0 && mqtt_publish(LED_STATUS_TOPIC, "off", 3, 1, false) < 0) {
+            broker.errors++;
+        }
+    }
+
+    printf("%d frames of %d bytes over %d connections, broker Topic Alias Maximum %d\n", frames,
+           TELEMETRY_FRAME_SIZE, broker.connections, TOPIC_ALIAS_MAXIMUM);
+    report("telemetry", &broker.telemetry, 1);
+    report("led_status", &broker.other, 1);
+    if (broker.telemetry.bytes >= broker.telemetry.unaliased_bytes) {
+        fprintf(stderr, "telemetry was never aliased\n");
+        broker.errors++;
+    }
+    return broker.errors != 0;
+}
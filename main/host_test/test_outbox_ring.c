@@ -0,0 +1,213 @@
+// outbox_ring.c against a reference list: random enqueues (some QoS 0 with id 0, some with remaining
+// data), deletes by id, pending changes, dequeues and expiry, the way esp-mqtt drives the outbox. After
+// every operation the outbox size must match the list, and every so often each live message is read back
+// and compared byte for byte.
+// Usage: test_outbox_ring [operations]
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mqtt_outbox.h>
+#include "outbox_ring.h"
+
+#define MSG_TYPE_PUBLISH 3
+#define MAX_HEADER 400
+#define MAX_REMAINING 600
+#define EXPIRY_TICKS 100            // operations
+#define VERIFY_EVERY 1000
+
+typedef struct {
+    int msg_id;                 // 0 for QoS 0
+    int length;
+    int header_length;          // bytes from data, the rest came from remaining_data
+    uint8_t fill;
+    pending_state_t pending;
+    outbox_tick_t tick;
+} reference_t;
+
+static reference_t reference[OUTBOX_RING_MAX_ITEMS];
+static int reference_count = 0;
+
+static void reference_remove(int k)
+{
+    memmove(&reference[k], &reference[k + 1], (reference_count - k - 1) * sizeof(reference[0]));
+    reference_count--;
+}
+
+static bool data_matches(outbox_item_handle_t item, const reference_t *ref)
+{
+    size_t len;
+    uint16_t msg_id;
+    int msg_type, qos;
+    const uint8_t *data = outbox_item_get_data(item, &len, &msg_id, &msg_type, &qos);
+
+    if (data == NULL || len != (size_t)ref->length || msg_id != (uint16_t)ref->msg_id ||
+        msg_type != MSG_TYPE_PUBLISH || qos != (ref->msg_id != 0)) {
+        return false;
+    }
+    for (int i = 0; i < ref->length; i++) {
+        uint8_t expected = i < ref->header_length ? ref->fill : (uint8_t)~ref->fill;
+        if (data[i] != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int fail(const char *what, long op)
+{
+    fprintf(stderr, "operation %ld: %s\n", op, what);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    long operations = argc > 1 ? atol(argv[1]) : 200000;
+    static uint8_t header[MAX_HEADER], remaining[MAX_REMAINING];
+    int next_id = 1;
+    long rejected = 0, expired = 0, dequeued = 0;
+
+    outbox_handle_t outbox = outbox_init();
+    if (outbox == NULL || outbox_init() != NULL) {
+        return fail("outbox_init should hand out the ring once", 0);
+    }
+    srand(1);
+
+    for (long op = 0; op < operations; op++) {
+        int choice = rand() % 10;
+        if (choice < 3) {
+            int header_length = 1 + rand() % MAX_HEADER;
+            int remaining_length = rand() % 2 ? rand() % MAX_REMAINING : 0;
+            int msg_id = rand() % 5 == 0 ? 0 : next_id;
+            uint8_t fill = rand();
+            memset(header, fill, header_length);
+            memset(remaining, (uint8_t)~fill, remaining_length);
+            outbox_message_t message = {
+                .data = header,
+                .len = header_length,
+                .msg_id = msg_id,
+                .msg_qos = msg_id != 0,
+                .msg_type = MSG_TYPE_PUBLISH,
+                .remaining_data = remaining_length ? remaining : NULL,
+                .remaining_len = remaining_length,
+            };
+            outbox_item_handle_t item = outbox_enqueue(outbox, &message, op);
+            if (item == NULL) {
+                if (reference_count < OUTBOX_RING_MAX_ITEMS && outbox_get_size(outbox) == 0) {
+                    return fail("empty outbox refused a message", op);
+                }
+                rejected++;
+                continue;
+            }
+            if (msg_id != 0) {
+                next_id = next_id == 65535 ? 1 : next_id + 1;
+            }
+            reference[reference_count] = (reference_t){ msg_id, header_length + remaining_length, header_length, fill,
+                                                        QUEUED, op };
+            if (!data_matches(item, &reference[reference_count++])) {
+                return fail("enqueued message reads back wrong", op);
+            }
+        } else if (choice < 7 && reference_count > 0) {
+            // PUBACK: delete by id
+            int k = rand() % reference_count;
+            if (reference[k].msg_id == 0) {
+                continue;
+            }
+            if (outbox_delete(outbox, reference[k].msg_id, MSG_TYPE_PUBLISH) != ESP_OK) {
+                return fail("delete of a stored message failed", op);
+            }
+            if (outbox_get(outbox, reference[k].msg_id) != NULL) {
+                return fail("deleted message still found", op);
+            }
+            reference_remove(k);
+        } else if (choice < 8 && reference_count > 0) {
+            int k = rand() % reference_count;
+            if (reference[k].msg_id == 0) {
+                continue;
+            }
+            if (outbox_set_pending(outbox, reference[k].msg_id, TRANSMITTED) != ESP_OK) {
+                return fail("set_pending of a stored message failed", op);
+            }
+            reference[k].pending = TRANSMITTED;
+        } else if (choice < 9) {
+            // The oldest queued message is sent next; QoS 0 ones are deleted once written
+            outbox_tick_t tick;
+            outbox_item_handle_t item = outbox_dequeue(outbox, QUEUED, &tick);
+            int k = 0;
+            while (k < reference_count && reference[k].pending != QUEUED) {
+                k++;
+            }
+            if ((item == NULL) != (k == reference_count)) {
+                return fail("dequeue disagrees with the reference", op);
+            }
+            if (item == NULL) {
+                continue;
+            }
+            if (!data_matches(item, &reference[k]) || tick != reference[k].tick ||
+                outbox_item_get_pending(item) != QUEUED) {
+                return fail("dequeued the wrong message", op);
+            }
+            dequeued++;
+            if (reference[k].msg_id == 0) {
+                if (outbox_delete_item(outbox, item) != ESP_OK || outbox_delete_item(outbox, item) == ESP_OK) {
+                    return fail("delete_item should succeed once", op);
+                }
+                reference_remove(k);
+            }
+        } else {
+            // Expiry takes the oldest message past the timeout
+            int msg_id = outbox_delete_single_expired(outbox, op, EXPIRY_TICKS);
+            int k = 0;
+            while (k < reference_count && op - reference[k].tick <= EXPIRY_TICKS) {
+                k++;
+            }
+            if ((msg_id == -1) != (k == reference_count) || (msg_id != -1 && msg_id != reference[k].msg_id)) {
+                return fail("expiry disagrees with the reference", op);
+            }
+            if (msg_id != -1) {
+                reference_remove(k);
+                expired++;
+            }
+        }
+
+        uint64_t bytes = 0;
+        for (int k = 0; k < reference_count; k++) {
+            bytes += reference[k].length;
+        }
+        if (outbox_get_size(outbox) != bytes) {
+            return fail("outbox size differs from the reference", op);
+        }
+        if (op % VERIFY_EVERY == 0) {
+            bool oldest_id_0_checked = false;
+            for (int k = 0; k < reference_count; k++) {
+                // outbox_get() only finds the oldest of the QoS 0 messages
+                if (reference[k].msg_id == 0 && oldest_id_0_checked) {
+                    continue;
+                }
+                oldest_id_0_checked |= reference[k].msg_id == 0;
+                outbox_item_handle_t item = outbox_get(outbox, reference[k].msg_id);
+                if (item == NULL || !data_matches(item, &reference[k])) {
+                    return fail("stored message corrupted", op);
+                }
+            }
+        }
+    }
+
+    outbox_ring_stats_t stats;
+    outbox_ring_get_stats(&stats);
+    if (stats.items != (size_t)reference_count || stats.rejected != (size_t)rejected) {
+        return fail("statistics differ from the reference", operations);
+    }
+    outbox_delete_all_items(outbox);
+    if (outbox_get_size(outbox) != 0 || outbox_dequeue(outbox, QUEUED, NULL) != NULL) {
+        return fail("delete_all_items left messages behind", operations);
+    }
+    outbox_destroy(outbox);
+    if ((outbox = outbox_init()) == NULL) {
+        return fail("outbox_init after destroy failed", operations);
+    }
+
+    printf("%ld operations: %ld dequeued, %ld expired, %ld refused, peak %zu of %d bytes\n", operations, dequeued,
+           expired, rejected, stats.peak_bytes, OUTBOX_RING_SIZE);
+    return 0;
+}
@@ -0,0 +1,133 @@
+// publish_policy.c against an in-memory NVS: the defaults, which updates are accepted or refused as a whole,
+// that only a change is saved, and that the saved table is what the next boot loads.
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <nvs.h>
+#include <cJSON.h>
+#include "work_queue.h"
+#include "publish_policy.h"
+
+static struct {
+    uint8_t blob[64];
+    size_t length;              // 0 until something is saved
+    int saves;
+} nvs;
+
+// --------------------------------------------------------------------------------
+// Stand-ins
+// --------------------------------------------------------------------------------
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    *out_handle = 1;
+    return (open_mode == NVS_READONLY && nvs.length == 0) ? ESP_ERR_NVS_NOT_FOUND : ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    if (nvs.length == 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (*length < nvs.length) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, nvs.blob, nvs.length);
+    *length = nvs.length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    if (length > sizeof(nvs.blob)) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(nvs.blob, value, length);
+    nvs.length = length;
+    nvs.saves++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t work_queue_submit_io(work_fn_t fn, void *arg)
+{
+    fn(arg);
+    return ESP_OK;
+}
+// --------------------------------------------------------------------------------
+
+#define CHECK(condition)                                                    \
+    do {                                                                    \
+        if (!(condition)) {                                                 \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                       \
+        }                                                                   \
+    } while (0)
+
+static esp_err_t update(const char *json)
+{
+    return publish_policy_update(json, strlen(json));
+}
+
+static bool policy_is(publish_policy_class_t cls, int qos, bool retain)
+{
+    publish_policy_t policy = publish_policy_get(cls);
+    return policy.qos == qos && policy.retain == retain;
+}
+
+int main(void)
+{
+    static const char *const refused[] = {
+        "{\"button\":{\"qos\":0}}",             // stored presses need their PUBACK
+        "{\"telemetry\":{\"qos\":3}}",
+        "{\"telemetry\":{\"qos\":-1}}",
+        "{\"telemetry\":{\"qos\":0.5}}",
+        "{\"telemetry\":{\"qos\":1.9999}}",
+        "{\"telemetry\":{\"qos\":\"1\"}}",
+        "{\"telemetry\":{\"retain\":1}}",
+        "{\"telemetry\":1}",
+        "{\"telemetry\":{\"qos\":1},\"announce\":{\"qos\":7}}",    // all or nothing
+        "[]",
+        "not json",
+    };
+
+    CHECK(publish_policy_init() == ESP_OK);
+    CHECK(policy_is(PUBLISH_POLICY_BUTTON, 1, false));
+    CHECK(policy_is(PUBLISH_POLICY_ANNOUNCE, 1, false));
+    CHECK(policy_is(PUBLISH_POLICY_LED_STATUS, 1, false));
+    CHECK(policy_is(PUBLISH_POLICY_TELEMETRY, 0, false));
+
+    for (size_t i = 0; i < sizeof(refused) / sizeof(refused[0]); i++) {
+        if (update(refused[i]) == ESP_OK) {
+            fprintf(stderr, "accepted %s\n", refused[i]);
+            return 1;
+        }
+    }
+    CHECK(policy_is(PUBLISH_POLICY_TELEMETRY, 0, false));
+    CHECK(policy_is(PUBLISH_POLICY_ANNOUNCE, 1, false));
+    CHECK(nvs.saves == 0);
+
+    // Unknown classes are skipped; a repeat of the same update (a retained message on reconnect) isn't saved
+    CHECK(update("{\"telemetry\":{\"qos\":1.0},\"led_status\":{\"retain\":true},\"lamp\":{}}") == ESP_OK);
+    CHECK(policy_is(PUBLISH_POLICY_TELEMETRY, 1, false));
+    CHECK(policy_is(PUBLISH_POLICY_LED_STATUS, 1, true));
+    CHECK(nvs.saves == 1);
+    CHECK(update("{\"telemetry\":{\"qos\":1.0},\"led_status\":{\"retain\":true},\"lamp\":{}}") == ESP_OK);
+    CHECK(nvs.saves == 1);
+
+    // The next boot starts from the saved table
+    CHECK(publish_policy_init() == ESP_OK);
+    CHECK(policy_is(PUBLISH_POLICY_TELEMETRY, 1, false));
+    CHECK(policy_is(PUBLISH_POLICY_LED_STATUS, 1, true));
+    CHECK(policy_is(PUBLISH_POLICY_BUTTON, 1, false));
+
+    printf("ok: %zu updates refused, %d save(s)\n", sizeof(refused) / sizeof(refused[0]), nvs.saves);
+    return 0;
+}
@@ -0,0 +1,193 @@
+// publish_scheduler.c with a scripted client: a message the client keeps refusing is dropped after
+// PUBLISH_SCHEDULER_MAX_ATTEMPTS and stops blocking its class, while a full outbox or a lost connection
+// only holds the queue back, however long it lasts. Messages submitted while the dispatcher is inside
+// mqtt_publish() don't wait for it, and one that replaces or pushes out the message being published
+// is still sent, after it.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_timer.h>
+#include "mqtt_handler.h"
+#include "mqtt_publish.h"
+#include "outbox_ring.h"
+#include "work_queue.h"
+#include "publish_scheduler.h"
+
+#define BAD_TOPIC "esp32/kiosk/" KIOSK_NAME "/bad"
+
+esp_mqtt_client_handle_t mqtt_client = NULL;
+bool mqtt_connected = true;
+
+static struct {
+    bool outbox_full;
+    void (*during_publish)(void);   // another task submitting while the client has the message
+    int refused;
+    int published;
+    char last_topic[PUBLISH_SCHEDULER_TOPIC_SIZE];
+    char last_data[PUBLISH_SCHEDULER_PAYLOAD_SIZE + 1];
+    outbox_ring_stats_t outbox;
+} client;
+
+// --------------------------------------------------------------------------------
+// Stand-ins
+// --------------------------------------------------------------------------------
+static work_fn_t waiting_fn = NULL;
+
+// One worker: an item submitted while it is busy runs after the current one
+esp_err_t work_queue_submit_io(work_fn_t fn, void *arg)
+{
+    static bool busy = false;
+    if (busy) {
+        if (waiting_fn != NULL) {
+            return ESP_ERR_TIMEOUT;
+        }
+        waiting_fn = fn;
+        return ESP_OK;
+    }
+    busy = true;
+    fn(arg);
+    while (waiting_fn != NULL) {
+        work_fn_t next = waiting_fn;
+        waiting_fn = NULL;
+        next(NULL);
+    }
+    busy = false;
+    return ESP_OK;
+}
+
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t handle)
+{
+    return 0;
+}
+
+void outbox_ring_get_stats(outbox_ring_stats_t *stats)
+{
+    *stats = client.outbox;
+}
+
+// The outbox ring counts the refusal when it is full; a topic the client can't take is refused outright
+int mqtt_publish(const char *topic, const char *data, int len, int qos, bool retain)
+{
+    if (!mqtt_connected) {
+        return -1;
+    }
+    if (client.outbox_full) {
+        client.outbox.rejected++;
+        return -1;
+    }
+    if (strcmp(topic, BAD_TOPIC) == 0) {
+        client.refused++;
+        return -1;
+    }
+    client.published++;
+    strcpy(client.last_topic, topic);
+    strcpy(client.last_data, data);
+    if (client.during_publish != NULL) {
+        void (*during_publish)(void) = client.during_publish;
+        client.during_publish = NULL;
+        during_publish();
+    }
+    return client.published;
+}
+// --------------------------------------------------------------------------------
+
+#define CHECK(condition)                                                    \
+    do {                                                                    \
+        if (!(condition)) {                                                 \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                       \
+        }                                                                   \
+    } while (0)
+
+// Would deadlock if the dispatcher held the scheduler lock across mqtt_publish()
+static void replace_state(void)
+{
+    publish_scheduler_submit(PUBLISH_CLASS_STATE, "esp32/kiosk/" KIOSK_NAME "/led_status", "on", 0, 1, true);
+}
+
+static void push_out_telemetry(void)
+{
+    for (int i = 0; i < PUBLISH_SCHEDULER_TELEMETRY_LIMIT; i++) {
+        publish_scheduler_submit(PUBLISH_CLASS_TELEMETRY, "esp32/kiosk/" KIOSK_NAME "/telemetry", "2", 0, 0, false);
+    }
+}
+
+static publish_class_stats_t stats(publish_class_t cls)
+{
+    publish_class_stats_t snapshot;
+    publish_scheduler_get_stats(cls, &snapshot);
+    return snapshot;
+}
+
+static void retry(int times)
+{
+    esp_timer_sim_advance(times * (PUBLISH_SCHEDULER_RETRY_MS + 1) * 1000LL);
+}
+
+int main(void)
+{
+    CHECK(publish_scheduler_init() == ESP_OK);
+
+    // A full outbox holds the queue for as long as it lasts
+    client.outbox_full = true;
+    CHECK(publish_scheduler_submit(PUBLISH_CLASS_EVENT, "esp32/kiosk/" KIOSK_NAME "/a", "1", 0, 1, false) == ESP_OK);
+    retry(10 * PUBLISH_SCHEDULER_MAX_ATTEMPTS);
+    CHECK(stats(PUBLISH_CLASS_EVENT).queued == 1);
+    CHECK(stats(PUBLISH_CLASS_EVENT).dropped == 0);
+    client.outbox_full = false;
+    retry(1);
+    CHECK(stats(PUBLISH_CLASS_EVENT).sent == 1);
+
+    // So does a lost connection; the reconnect kicks the dispatcher
+    mqtt_connected = false;
+    CHECK(publish_scheduler_submit(PUBLISH_CLASS_EVENT, "esp32/kiosk/" KIOSK_NAME "/b", "2", 0, 1, false) == ESP_OK);
+    retry(10 * PUBLISH_SCHEDULER_MAX_ATTEMPTS);
+    CHECK(stats(PUBLISH_CLASS_EVENT).queued == 1);
+    mqtt_connected = true;
+    publish_scheduler_kick();
+    CHECK(stats(PUBLISH_CLASS_EVENT).sent == 2);
+
+    // A message refused for any other reason is dropped, and the one behind it goes out
+    CHECK(publish_scheduler_submit(PUBLISH_CLASS_EVENT, BAD_TOPIC, "3", 0, 1, false) == ESP_OK);
+    CHECK(publish_scheduler_submit(PUBLISH_CLASS_EVENT, "esp32/kiosk/" KIOSK_NAME "/c", "4", 0, 1, false) == ESP_OK);
+    retry(PUBLISH_SCHEDULER_MAX_ATTEMPTS);
+    CHECK(client.refused == PUBLISH_SCHEDULER_MAX_ATTEMPTS);
+    CHECK(stats(PUBLISH_CLASS_EVENT).dropped == 1);
+    CHECK(stats(PUBLISH_CLASS_EVENT).sent == 3);
+    CHECK(stats(PUBLISH_CLASS_EVENT).queued == 0);
+    CHECK(strcmp(client.last_topic, "esp32/kiosk/" KIOSK_NAME "/c") == 0);
+
+    // Full-outbox attempts don't count towards the limit
+    client.outbox_full = true;
+    CHECK(publish_scheduler_submit(PUBLISH_CLASS_STATE, BAD_TOPIC, "5", 0, 1, false) == ESP_OK);
+    retry(10);
+    client.outbox_full = false;
+    retry(PUBLISH_SCHEDULER_MAX_ATTEMPTS - 1);
+    CHECK(stats(PUBLISH_CLASS_STATE).queued == 1);
+    retry(1);
+    CHECK(stats(PUBLISH_CLASS_STATE).queued == 0);
+    CHECK(stats(PUBLISH_CLASS_STATE).dropped == 1);
+
+    // A newer state for the topic being published is sent after it rather than lost with it
+    client.during_publish = replace_state;
+    int published = client.published;
+    CHECK(publish_scheduler_submit(PUBLISH_CLASS_STATE, "esp32/kiosk/" KIOSK_NAME "/led_status", "off", 0, 1,
+                                   true) == ESP_OK);
+    CHECK(client.published == published + 2);
+    CHECK(strcmp(client.last_data, "on") == 0);
+    CHECK(stats(PUBLISH_CLASS_STATE).queued == 0);
+
+    // Telemetry pushed out while it was being published: the newer messages behind it still go out
+    client.during_publish = push_out_telemetry;
+    published = client.published;
+    CHECK(publish_scheduler_submit(PUBLISH_CLASS_TELEMETRY, "esp32/kiosk/" KIOSK_NAME "/telemetry", "1", 0, 0,
+                                   false) == ESP_OK);
+    CHECK(client.published == published + 1 + PUBLISH_SCHEDULER_TELEMETRY_LIMIT);
+    CHECK(strcmp(client.last_data, "2") == 0);
+    CHECK(stats(PUBLISH_CLASS_TELEMETRY).queued == 0);
+
+    printf("ok: %d published, %d refused by the client, %zu while the outbox was full\n", client.published,
+           client.refused, client.outbox.rejected);
+    return 0;
+}
@@ -0,0 +1,93 @@
+// work_queue.c on the FreeRTOS stand-in's threads: while the I/O worker is stuck in a long flash write
+// and its queue has filled up behind it, LED commands are still accepted and applied straight away. Once
+// the write finishes the queued I/O items run in submission order.
+// Usage: test_work_queue
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "work_queue.h"
+
+#define COMMANDS 8
+#define COMMAND_TIMEOUT_MS 1000
+
+#define CHECK(condition)                                                    \
+    do {                                                                    \
+        if (!(condition)) {                                                 \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                       \
+        }                                                                   \
+    } while (0)
+
+static SemaphoreHandle_t write_started = NULL;
+static SemaphoreHandle_t write_may_finish = NULL;
+static SemaphoreHandle_t command_applied = NULL;
+static SemaphoreHandle_t io_done = NULL;
+static portMUX_TYPE order_lock = portMUX_INITIALIZER_UNLOCKED;
+static int io_order[WORK_QUEUE_IO_LENGTH];
+static int io_count = 0;
+
+// Stands in for a flash write waiting out a sector erase
+static void slow_write(void *arg)
+{
+    xSemaphoreGive(write_started);
+    xSemaphoreTake(write_may_finish, portMAX_DELAY);
+}
+
+static void queued_write(void *arg)
+{
+    portENTER_CRITICAL(&order_lock);
+    io_order[io_count++] = (int)(intptr_t)arg;
+    bool last = io_count == WORK_QUEUE_IO_LENGTH;
+    portEXIT_CRITICAL(&order_lock);
+    if (last) {
+        xSemaphoreGive(io_done);
+    }
+}
+
+static void led_command(void *arg)
+{
+    xSemaphoreGive(command_applied);
+}
+
+int main(void)
+{
+    write_started = xSemaphoreCreateBinary();
+    write_may_finish = xSemaphoreCreateBinary();
+    command_applied = xSemaphoreCreateBinary();
+    io_done = xSemaphoreCreateBinary();
+    CHECK(work_queue_init() == ESP_OK);
+
+    // The I/O worker busy, its queue full behind it
+    CHECK(work_queue_submit_io(slow_write, NULL) == ESP_OK);
+    CHECK(xSemaphoreTake(write_started, pdMS_TO_TICKS(COMMAND_TIMEOUT_MS)) == pdTRUE);
+    for (int i = 0; i < WORK_QUEUE_IO_LENGTH; i++) {
+        CHECK(work_queue_submit_io(queued_write, (void *)(intptr_t)i) == ESP_OK);
+    }
+    CHECK(work_queue_submit_io(queued_write, NULL) == ESP_ERR_TIMEOUT);
+
+    // LED commands don't wait for it
+    for (int i = 0; i < COMMANDS; i++) {
+        CHECK(work_queue_submit(led_command, NULL) == ESP_OK);
+        CHECK(xSemaphoreTake(command_applied, pdMS_TO_TICKS(COMMAND_TIMEOUT_MS)) == pdTRUE);
+    }
+    CHECK(io_count == 0);
+
+    xSemaphoreGive(write_may_finish);
+    CHECK(xSemaphoreTake(io_done, pdMS_TO_TICKS(COMMAND_TIMEOUT_MS)) == pdTRUE);
+    for (int i = 0; i < WORK_QUEUE_IO_LENGTH; i++) {
+        CHECK(io_order[i] == i);
+    }
+
+    work_queue_stats_t command, io;
+    work_queue_get_stats(WORK_LANE_COMMAND, &command);
+    work_queue_get_stats(WORK_LANE_IO, &io);
+    CHECK(command.submitted == COMMANDS && command.dropped == 0);
+    CHECK(io.submitted == WORK_QUEUE_IO_LENGTH + 1 && io.dropped == 1);
+
+    printf("ok: %d LED commands applied while the I/O worker was stuck, %d I/O items in order after it\n",
+           COMMANDS, io_count);
+    return 0;
+}
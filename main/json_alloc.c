@@ -0,0 +1,162 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <cJSON.h>
+#include "config.h"
+#include "json_alloc.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+#ifdef CONFIG_SPIRAM
+#define JSON_ALLOC_LARGE_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define JSON_ALLOC_LARGE_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#endif
+
+#ifdef JSON_ALLOC_POOL
+typedef union small_block {
+    union small_block *next;
+    uint8_t data[JSON_ALLOC_SMALL_BLOCK];
+    max_align_t align;
+} small_block_t;
+
+// Every node has to fit a small block, or the pool would only ever serve keys
+_Static_assert(sizeof(cJSON) <= JSON_ALLOC_SMALL_BLOCK, "cJSON node does not fit JSON_ALLOC_SMALL_BLOCK");
+
+static small_block_t small_pool[JSON_ALLOC_SMALL_COUNT];
+static small_block_t *free_list = NULL;
+#endif
+static json_alloc_stats_t stats;
+static portMUX_TYPE pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#ifdef JSON_ALLOC_POOL
+// --------------------------------------------------------------------------------
+// Allocation Hooks
+// --------------------------------------------------------------------------------
+static void *json_malloc(size_t size)
+{
+    if (size <= JSON_ALLOC_SMALL_BLOCK) {
+        small_block_t *block;
+
+        portENTER_CRITICAL(&pool_lock);
+        block = free_list;
+        if (block != NULL) {
+            free_list = block->next;
+            if (++stats.pool_in_use > stats.pool_peak) {
+                stats.pool_peak = stats.pool_in_use;
+            }
+        } else {
+            stats.pool_fallbacks++;
+        }
+        portEXIT_CRITICAL(&pool_lock);
+
+        if (block != NULL) {
+            return block;
+        }
+        return heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+
+    portENTER_CRITICAL(&pool_lock);
+    stats.large_allocs++;
+    portEXIT_CRITICAL(&pool_lock);
+
+    void *ptr = heap_caps_malloc(size, JSON_ALLOC_LARGE_CAPS);
+    if (ptr == NULL) {
+        // Secondary region full (or absent): internal RAM is better than failing
+        ptr = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    return ptr;
+}
+
+static void json_free(void *ptr)
+{
+    small_block_t *block = ptr;
+    uintptr_t address = (uintptr_t)ptr;
+
+    if (address >= (uintptr_t)&small_pool[0] && address < (uintptr_t)&small_pool[JSON_ALLOC_SMALL_COUNT]) {
+        portENTER_CRITICAL(&pool_lock);
+        block->next = free_list;
+        free_list = block;
+        stats.pool_in_use--;
+        portEXIT_CRITICAL(&pool_lock);
+        return;
+    }
+    heap_caps_free(ptr);
+}
+// --------------------------------------------------------------------------------
+#endif
+
+
+// --------------------------------------------------------------------------------
+// Init / Stats
+// --------------------------------------------------------------------------------
+void json_alloc_init(void)
+{
+#ifdef JSON_ALLOC_POOL
+    for (size_t i = 0; i < JSON_ALLOC_SMALL_COUNT; i++) {
+        small_pool[i].next = (i + 1 < JSON_ALLOC_SMALL_COUNT) ? &small_pool[i + 1] : NULL;
+    }
+    free_list = &small_pool[0];
+    memset(&stats, 0, sizeof(stats));
+
+    // Must run before any cJSON allocation: blocks are freed by the tier that allocated them
+    cJSON_Hooks hooks = {
+        .malloc_fn = json_malloc,
+        .free_fn = json_free,
+    };
+    cJSON_InitHooks(&hooks);
+    ESP_LOGI(TAG, "JSON allocator: %d x %d byte pool, large blocks in %s", JSON_ALLOC_SMALL_COUNT,
+             JSON_ALLOC_SMALL_BLOCK, (JSON_ALLOC_LARGE_CAPS & MALLOC_CAP_SPIRAM) ? "PSRAM" : "internal RAM");
+#else
+    ESP_LOGI(TAG, "JSON allocator: default heap");
+#endif
+}
+
+void json_alloc_get_stats(json_alloc_stats_t *out)
+{
+    portENTER_CRITICAL(&pool_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&pool_lock);
+}
+
+// Percent of a region's free memory that is outside its largest free block
+static unsigned region_fragmentation(uint32_t caps, size_t *largest_free, size_t *total_free)
+{
+    *total_free = heap_caps_get_free_size(caps);
+    *largest_free = heap_caps_get_largest_free_block(caps);
+    return *total_free ? (unsigned)(100 - (*largest_free * 100) / *total_free) : 0;
+}
+
+static void log_region(const char *label, const char *region, uint32_t caps)
+{
+    size_t total_free, largest_free;
+    unsigned fragmentation = region_fragmentation(caps, &largest_free, &total_free);
+
+    ESP_LOGI(TAG, "%s: %s largest free block %u of %u bytes free (%u%% fragmented)", label, region,
+             (unsigned)largest_free, (unsigned)total_free, fragmentation);
+}
+
+void json_alloc_get_fragmentation(json_alloc_fragmentation_t *out)
+{
+    size_t total_free, largest_free;
+
+    out->internal = region_fragmentation(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, &largest_free, &total_free);
+    out->large = region_fragmentation(JSON_ALLOC_LARGE_CAPS, &largest_free, &total_free);
+}
+
+void json_alloc_log_fragmentation(const char *label)
+{
+    json_alloc_stats_t snapshot;
+
+    log_region(label, "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#ifdef CONFIG_SPIRAM
+    log_region(label, "PSRAM", MALLOC_CAP_SPIRAM);
+#endif
+    json_alloc_get_stats(&snapshot);
+    ESP_LOGI(TAG, "%s: JSON pool %u/%d in use (peak %u), %u fallbacks, %u large blocks", label,
+             (unsigned)snapshot.pool_in_use, JSON_ALLOC_SMALL_COUNT, (unsigned)snapshot.pool_peak,
+             (unsigned)snapshot.pool_fallbacks, (unsigned)snapshot.large_allocs);
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,35 @@
+#ifndef JSON_ALLOC_H
+#define JSON_ALLOC_H
+
+#include <stddef.h>
+
+// With JSON_ALLOC_POOL defined (config.h), cJSON allocations are split in two tiers: blocks up to
+// JSON_ALLOC_SMALL_BLOCK bytes (nodes, keys, short strings) come from a static pool in internal RAM, larger ones
+// (long strings, print buffers) from the heap, in PSRAM when CONFIG_SPIRAM is enabled. When the pool is
+// exhausted, small blocks fall back to the heap. Without it cJSON stays on the default heap, the pool stats
+// read zero and only the fragmentation figures are live.
+#ifndef JSON_ALLOC_SMALL_BLOCK
+#define JSON_ALLOC_SMALL_BLOCK 64      // a cJSON node with 32-bit pointers; host builds need more
+#endif
+#define JSON_ALLOC_SMALL_COUNT 128
+
+typedef struct {
+    size_t pool_in_use;
+    size_t pool_peak;
+    size_t pool_fallbacks;      // small blocks that had to come from the heap
+    size_t large_allocs;
+} json_alloc_stats_t;
+
+// Percent of each region's free memory that is outside its largest free block
+typedef struct {
+    unsigned internal;
+    unsigned large;             // the region large blocks come from; internal RAM without PSRAM
+} json_alloc_fragmentation_t;
+
+// Function prototypes
+void json_alloc_init(void);
+void json_alloc_get_stats(json_alloc_stats_t *stats);
+void json_alloc_get_fragmentation(json_alloc_fragmentation_t *fragmentation);
+void json_alloc_log_fragmentation(const char *label);
+
+#endif // JSON_ALLOC_H
@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_log.h>
+#include "config.h"
+#include "led_control.h"
+#include "led_commands.h"
+#include "led_command_table.h"      // Generated from led_commands.txt
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+// --------------------------------------------------------------------------------
+// Command Handlers
+// --------------------------------------------------------------------------------
+void led_command_toggle(void)
+{
+    led_state = !led_state;
+    set_led_state(led_state);
+    ESP_LOGI(TAG, "LED toggled to %d", led_state);
+}
+
+void led_command_on(void)
+{
+    led_state = true;
+    set_led_state(led_state);
+    ESP_LOGI(TAG, "LED turned on");
+}
+
+void led_command_off(void)
+{
+    led_state = false;
+    set_led_state(led_state);
+    ESP_LOGI(TAG, "LED turned off");
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Lookup
+// --------------------------------------------------------------------------------
+// Must match command_hash() in gen_command_table.py
+static uint32_t command_hash(const char *payload, size_t length)
+{
+    uint32_t hash = 2166136261U ^ LED_COMMAND_TABLE_SEED;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)payload[i]) * 16777619U;
+    }
+    return hash ^ (hash >> 15);
+}
+
+// Returns the entry for a payload that is exactly one of the verbs, NULL otherwise
+const led_command_entry_t *led_command_lookup(const char *payload, int length)
+{
+    if (payload == NULL || length <= 0) {
+        return NULL;
+    }
+    const led_command_entry_t *entry = &led_command_table[command_hash(payload, length) & (LED_COMMAND_TABLE_SIZE - 1)];
+    if (entry->verb == NULL || entry->length != (size_t)length || memcmp(entry->verb, payload, length) != 0) {
+        return NULL;
+    }
+    return entry;
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,17 @@
+#ifndef LED_COMMANDS_H
+#define LED_COMMANDS_H
+
+#include <stddef.h>
+
+typedef void (*led_command_handler_t)(void);
+
+typedef struct {
+    const char *verb;
+    size_t length;
+    led_command_handler_t handler;
+} led_command_entry_t;
+
+// Function prototypes
+const led_command_entry_t *led_command_lookup(const char *payload, int length);
+
+#endif // LED_COMMANDS_H
@@ -8,6 +8,15 @@
 #include <freertos/event_groups.h>
 #include <driver/gpio.h>
 #include "led_control.h"
+#include "json_alloc.h"
+#include "work_queue.h"
+#include "state_publisher.h"
+#include "telemetry.h"
+#include "mqtt_publish.h"
+#include "publish_scheduler.h"
+#include "backpressure.h"
+#include "publish_policy.h"
+#include "message_store.h"
 #include "mqtt_handler.h"
 #include "config.h"
 
@@ -23,6 +32,13 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    // QoS and retain settings saved by an earlier policy update
+    ESP_ERROR_CHECK(publish_policy_init());
+
+    // Before anything builds a document: installs the pooled cJSON hooks when JSON_ALLOC_POOL is defined
+    json_alloc_init();
+    json_alloc_log_fragmentation("Startup");
+
     // Create event group
     connectivity_event_group = xEventGroupCreate();
     if (connectivity_event_group == NULL) {
@@ -33,6 +49,12 @@ void app_main(void)
     // Initialize RGB LED
     configure_led();
 
+    // LED commands from the MQTT task are applied by the work queue, publishing and flash writes by its I/O lane
+    ESP_ERROR_CHECK(work_queue_init());
+
+    // Button presses are kept on flash until acknowledged; without the partition they are sent from RAM
+    message_store_init();
+
     // Initialize button GPIO
     gpio_config_t io_conf = {
         .pin_bit_mask = (1ULL << BUTTON_GPIO),
@@ -76,6 +98,9 @@ void app_main(void)
         .broker.address.port = 1883,
         .credentials.client_id = KIOSK_NAME,
         .session.keepalive = 30,
+#ifdef CONFIG_MQTT_PROTOCOL_5
+        .session.protocol_ver = MQTT_PROTOCOL_V_5,      // for topic aliases, see mqtt_publish.h
+#endif
         .network.timeout_ms = 10000,
         .network.reconnect_timeout_ms = 5000,
     };
@@ -84,11 +109,23 @@ void app_main(void)
         ESP_LOGE(TAG, "Failed to initialize MQTT client");
         return;
     }
+    ESP_ERROR_CHECK(mqtt_publish_init());
+    ESP_ERROR_CHECK(publish_scheduler_init());
+    ESP_ERROR_CHECK(backpressure_init());
+    mqtt_register_routes();
+    mqtt_register_state_values();
+    ESP_ERROR_CHECK(state_publisher_start());
     ESP_ERROR_CHECK(esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL));
     ESP_ERROR_CHECK(esp_mqtt_client_start(mqtt_client));
 
     // Start tasks
-    xTaskCreate(heartbeat_task, "heartbeat_task", 3072, NULL, 5, NULL);
-    xTaskCreate(led_status_task, "led_status_task", 3072, NULL, 5, NULL);
-    xTaskCreate(button_task, "button_task", 3072, NULL, 5, NULL);
+    TaskHandle_t button_task_handle = NULL;
+    xTaskCreate(button_task, "button_task", 3072, NULL, 5, &button_task_handle);
+
+    // One telemetry frame per interval carries liveness, LED state and health metrics
+    mqtt_register_telemetry();
+    if (button_task_handle != NULL) {
+        ESP_ERROR_CHECK(telemetry_watch_task("button", button_task_handle));
+    }
+    ESP_ERROR_CHECK(telemetry_start());
 }
@@ -0,0 +1,620 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "mqtt_handler.h"
+#include "mqtt_publish.h"
+#include "publish_policy.h"
+#include "work_queue.h"
+#include "message_store.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+#define SEGMENT_MAGIC 0x5347534DU           // "MSGS"
+#define STATE_PENDING 0xFFFFFFFFU           // as written; acknowledging clears the bits in place
+#define STATE_ACKNOWLEDGED 0x00000000U
+#define NO_ADDRESS UINT32_MAX
+#define RECORD_ALIGN 4
+
+typedef struct {
+    uint32_t magic;
+    uint32_t generation;        // increases with every segment opened, the highest one is being written
+    uint32_t erase_count;
+    uint32_t reserved;
+} segment_header_t;
+
+typedef struct {
+    uint32_t state;             // outside the CRC, so it can be rewritten
+    uint32_t seq;
+    uint16_t topic_length;
+    uint16_t payload_length;
+    uint32_t crc;               // over seq, the lengths, topic and payload
+} record_header_t;
+
+typedef struct {
+    bool valid;
+    uint32_t generation;
+    uint32_t erase_count;
+    uint16_t pending;
+} segment_t;
+
+typedef struct {
+    int msg_id;
+    uint32_t address;
+    int64_t sent_ms;
+} inflight_t;
+
+static const esp_partition_t *partition = NULL;
+static SemaphoreHandle_t store_lock = NULL;
+static esp_timer_handle_t service_timer = NULL;
+
+static segment_t segments[MESSAGE_STORE_MAX_SEGMENTS];
+static int segment_count = 0;
+static int head_segment = -1;       // segment being written, -1 while the store is empty
+static uint32_t head_offset = 0;    // MESSAGE_STORE_SEGMENT_SIZE once the head can't take more records
+static uint32_t last_generation = 0;
+static uint32_t next_seq = 0;
+
+static uint8_t staging[MESSAGE_STORE_STAGING_SIZE];
+static size_t staging_length = 0;
+static uint32_t acks[MESSAGE_STORE_MAX_ACKS];
+static int ack_count = 0;
+static bool service_scheduled = false;
+
+static inflight_t inflight[MESSAGE_STORE_WINDOW];
+static int inflight_count = 0;
+static int pubacks[MESSAGE_STORE_PUBACKS];      // message ids from the event handler, not matched yet
+static int puback_count = 0;
+static bool puback_drain_submitted = false;
+static portMUX_TYPE puback_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t send_address = NO_ADDRESS;      // next record to consider for sending
+static bool send_address_valid = false;
+
+static uint32_t record_buffer[MESSAGE_STORE_MAX_RECORD / sizeof(uint32_t)];
+static message_store_stats_t stats;
+
+// --------------------------------------------------------------------------------
+// Records
+// --------------------------------------------------------------------------------
+static uint32_t record_size(size_t data_length)
+{
+    return (sizeof(record_header_t) + data_length + RECORD_ALIGN - 1) & ~(uint32_t)(RECORD_ALIGN - 1);
+}
+
+static uint32_t record_crc(const record_header_t *header, const uint8_t *data)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&header->seq,
+                                    sizeof(header->seq) + sizeof(header->topic_length) + sizeof(header->payload_length));
+    return esp_rom_crc32_le(crc, data, header->topic_length + header->payload_length);
+}
+
+// Reads the record at address into record_buffer. Returns its size, or 0 at the end of the segment's
+// records: erased flash, or a record torn by a reset during the write.
+static uint32_t load_record(uint32_t address)
+{
+    record_header_t *header = (record_header_t *)record_buffer;
+    uint32_t offset = address % MESSAGE_STORE_SEGMENT_SIZE;
+
+    if (offset + sizeof(*header) > MESSAGE_STORE_SEGMENT_SIZE ||
+        esp_partition_read(partition, address, header, sizeof(*header)) != ESP_OK) {
+        return 0;
+    }
+    size_t data_length = header->topic_length + header->payload_length;
+    uint32_t size = record_size(data_length);
+    if (header->topic_length == 0 || header->topic_length >= MESSAGE_STORE_TOPIC_SIZE ||
+        size > MESSAGE_STORE_MAX_RECORD || offset + size > MESSAGE_STORE_SEGMENT_SIZE) {
+        return 0;
+    }
+    if (esp_partition_read(partition, address + sizeof(*header), header + 1, data_length) != ESP_OK ||
+        record_crc(header, (const uint8_t *)(header + 1)) != header->crc) {
+        return 0;
+    }
+    return size;
+}
+
+// Segment of a record position; a position on a segment boundary is the end of the segment before it
+static int segment_of(uint32_t address)
+{
+    return (address - 1) / MESSAGE_STORE_SEGMENT_SIZE;
+}
+
+static uint32_t segment_start(int segment)
+{
+    return segment * MESSAGE_STORE_SEGMENT_SIZE + sizeof(segment_header_t);
+}
+
+// The segment after the head is the oldest one still around, if it holds anything
+static uint32_t oldest_address(void)
+{
+    if (head_segment < 0) {
+        return NO_ADDRESS;
+    }
+    for (int i = 1; i <= segment_count; i++) {
+        int segment = (head_segment + i) % segment_count;
+        if (segments[segment].valid) {
+            return segment_start(segment);
+        }
+    }
+    return NO_ADDRESS;
+}
+
+static bool is_skipped(uint32_t address)
+{
+    for (int i = 0; i < ack_count; i++) {
+        if (acks[i] == address) {
+            return true;
+        }
+    }
+    for (int i = 0; i < inflight_count; i++) {
+        if (inflight[i].address == address) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Finds the first pending record at or after from, in write order; leaves it in record_buffer
+static uint32_t find_pending(uint32_t from)
+{
+    int segment = segment_of(from);
+    uint32_t address = from;
+
+    while (true) {
+        uint32_t end = (segment + 1) * MESSAGE_STORE_SEGMENT_SIZE;
+        if (segment == head_segment) {
+            end = segment * MESSAGE_STORE_SEGMENT_SIZE + head_offset;
+        }
+        while (segments[segment].valid && address < end) {
+            uint32_t size = load_record(address);
+            if (size == 0) {
+                break;
+            }
+            const record_header_t *header = (const record_header_t *)record_buffer;
+            if (header->state == STATE_PENDING && !is_skipped(address)) {
+                return address;
+            }
+            address += size;
+        }
+        if (segment == head_segment) {
+            return NO_ADDRESS;
+        }
+        segment = (segment + 1) % segment_count;
+        address = segment_start(segment);
+    }
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Segments
+// --------------------------------------------------------------------------------
+// Makes the head segment able to take size more bytes, moving on to the next segment if needed
+static bool reserve(uint32_t size)
+{
+    if (head_segment >= 0 && head_offset + size <= MESSAGE_STORE_SEGMENT_SIZE) {
+        return true;
+    }
+
+    int next = (head_segment < 0) ? 0 : (head_segment + 1) % segment_count;
+    segment_t *segment = &segments[next];
+    if (segment->valid && segment->pending > 0) {
+        return false;   // the oldest segment still has unacknowledged messages
+    }
+
+    uint32_t address = next * MESSAGE_STORE_SEGMENT_SIZE;
+    if (esp_partition_erase_range(partition, address, MESSAGE_STORE_SEGMENT_SIZE) != ESP_OK) {
+        return false;
+    }
+    segment_header_t header = {
+        .magic = SEGMENT_MAGIC,
+        .generation = ++last_generation,
+        .erase_count = segment->erase_count + 1,
+        .reserved = UINT32_MAX,
+    };
+    if (esp_partition_write(partition, address, &header, sizeof(header)) != ESP_OK) {
+        segment->valid = false;
+        return false;
+    }
+    segment->valid = true;
+    segment->generation = header.generation;
+    segment->erase_count = header.erase_count;
+    segment->pending = 0;
+    if (header.erase_count > stats.max_erase_count) {
+        stats.max_erase_count = header.erase_count;
+    }
+
+    // The send position may have pointed into the old contents
+    if (send_address != NO_ADDRESS && segment_of(send_address) == next) {
+        send_address_valid = false;
+    }
+    head_segment = next;
+    head_offset = sizeof(segment_header_t);
+    return head_offset + size <= MESSAGE_STORE_SEGMENT_SIZE;
+}
+
+// Writes the batched acknowledgements and appended records
+static void commit(void)
+{
+    // Acknowledgements first, they may free the segment the records need. One that fails to write is
+    // kept for the next commit; until then it also keeps its record from being sent again.
+    int kept = 0;
+    for (int i = 0; i < ack_count; i++) {
+        const uint32_t state = STATE_ACKNOWLEDGED;
+        if (esp_partition_write(partition, acks[i], &state, sizeof(state)) == ESP_OK) {
+            segments[acks[i] / MESSAGE_STORE_SEGMENT_SIZE].pending--;
+            stats.acknowledged++;
+        } else {
+            acks[kept++] = acks[i];
+        }
+    }
+    ack_count = kept;
+
+    size_t done = 0;
+    int failed_writes = 0;
+    while (done < staging_length && failed_writes < segment_count) {
+        const record_header_t *first = (const record_header_t *)&staging[done];
+        if (!reserve(record_size(first->topic_length + first->payload_length))) {
+            break;
+        }
+        // As many records as fit in the head segment go out in one write
+        size_t run = 0;
+        uint16_t records = 0;
+        while (done + run < staging_length) {
+            const record_header_t *header = (const record_header_t *)&staging[done + run];
+            uint32_t size = record_size(header->topic_length + header->payload_length);
+            if (head_offset + run + size > MESSAGE_STORE_SEGMENT_SIZE) {
+                break;
+            }
+            run += size;
+            records++;
+        }
+        uint32_t address = head_segment * MESSAGE_STORE_SEGMENT_SIZE + head_offset;
+        if (esp_partition_write(partition, address, &staging[done], run) != ESP_OK) {
+            head_offset = MESSAGE_STORE_SEGMENT_SIZE;   // don't write after a failed write, go on in the next segment
+            failed_writes++;
+            continue;
+        }
+        head_offset += run;
+        segments[head_segment].pending += records;
+        done += run;
+    }
+
+    if (done < staging_length) {
+        uint32_t lost = 0;
+        for (size_t offset = done; offset < staging_length;) {
+            const record_header_t *header = (const record_header_t *)&staging[offset];
+            offset += record_size(header->topic_length + header->payload_length);
+            lost++;
+        }
+        stats.rejected += lost;
+        ESP_LOGE(TAG, "Message store full, %u message(s) lost", (unsigned)lost);
+    }
+    staging_length = 0;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Sending
+// --------------------------------------------------------------------------------
+static void send_pending(void)
+{
+    int64_t now_ms = esp_timer_get_time() / 1000;
+
+    // esp-mqtt drops messages it could not deliver in time; send those again from the log. Only the
+    // timed out ones: the rest of the window may still be acknowledged.
+    for (int i = 0; i < inflight_count;) {
+        if (now_ms - inflight[i].sent_ms > MESSAGE_STORE_RESEND_MS) {
+            inflight[i] = inflight[--inflight_count];
+            stats.resent++;
+            send_address_valid = false;
+        } else {
+            i++;
+        }
+    }
+
+    if (!mqtt_connected || head_segment < 0) {
+        return;
+    }
+    if (!send_address_valid) {
+        send_address = oldest_address();
+        send_address_valid = true;
+    }
+
+    while (inflight_count < MESSAGE_STORE_WINDOW && send_address != NO_ADDRESS) {
+        uint32_t address = find_pending(send_address);
+        if (address == NO_ADDRESS) {
+            // Nothing left: continue from the write position, unless the next record opens a new segment
+            send_address = head_segment * MESSAGE_STORE_SEGMENT_SIZE + head_offset;
+            send_address_valid = head_offset < MESSAGE_STORE_SEGMENT_SIZE;
+            return;
+        }
+
+        const record_header_t *header = (const record_header_t *)record_buffer;
+        const char *data = (const char *)(header + 1);
+        char topic[MESSAGE_STORE_TOPIC_SIZE];
+        memcpy(topic, data, header->topic_length);
+        topic[header->topic_length] = '\0';
+
+        publish_policy_t policy = publish_policy_get(PUBLISH_POLICY_BUTTON);
+        int msg_id = mqtt_publish(topic, data + header->topic_length, header->payload_length, policy.qos,
+                                  policy.retain);
+        if (msg_id < 0) {
+            return;     // outbox full or disconnected, try again on the next service
+        }
+        inflight[inflight_count].msg_id = msg_id;
+        inflight[inflight_count].address = address;
+        inflight[inflight_count].sent_ms = now_ms;
+        inflight_count++;
+        send_address = address + record_size(header->topic_length + header->payload_length);
+    }
+}
+
+// Moves the PUBACKs recorded by message_store_on_published() from the window to the batched acknowledgements
+static void drain_pubacks(void)
+{
+    int drained[MESSAGE_STORE_PUBACKS];
+    int count;
+
+    portENTER_CRITICAL(&puback_lock);
+    count = puback_count;
+    memcpy(drained, pubacks, count * sizeof(drained[0]));
+    puback_count = 0;
+    puback_drain_submitted = false;
+    portEXIT_CRITICAL(&puback_lock);
+
+    for (int n = 0; n < count; n++) {
+        for (int i = 0; i < inflight_count; i++) {
+            if (inflight[i].msg_id != drained[n]) {
+                continue;
+            }
+            if (ack_count == MESSAGE_STORE_MAX_ACKS) {
+                commit();
+            }
+            if (ack_count == MESSAGE_STORE_MAX_ACKS) {
+                ESP_LOGW(TAG, "Acknowledgements not written, message %d will be sent again", drained[n]);
+                break;
+            }
+            acks[ack_count++] = inflight[i].address;
+            inflight[i] = inflight[--inflight_count];
+            break;
+        }
+    }
+}
+
+static void service_work(void *arg)
+{
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    service_scheduled = false;
+    drain_pubacks();
+    commit();
+    send_pending();
+    xSemaphoreGive(store_lock);
+}
+
+static void schedule_service(void)
+{
+    bool submit;
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    submit = !service_scheduled;
+    service_scheduled = true;
+    xSemaphoreGive(store_lock);
+
+    if (submit && work_queue_submit_io(service_work, NULL) != ESP_OK) {
+        // The service timer picks it up
+        xSemaphoreTake(store_lock, portMAX_DELAY);
+        service_scheduled = false;
+        xSemaphoreGive(store_lock);
+    }
+}
+
+static void service_timer_callback(void *arg)
+{
+    work_queue_submit_io(service_work, NULL);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Init / API
+// --------------------------------------------------------------------------------
+static void scan_segments(void)
+{
+    uint32_t head_generation = 0;
+    uint32_t last_seq = 0;
+    bool any_record = false;
+
+    for (int segment = 0; segment < segment_count; segment++) {
+        segment_header_t header;
+        segment_t *state = &segments[segment];
+
+        memset(state, 0, sizeof(*state));
+        if (esp_partition_read(partition, segment * MESSAGE_STORE_SEGMENT_SIZE, &header, sizeof(header)) != ESP_OK ||
+            header.magic != SEGMENT_MAGIC) {
+            continue;
+        }
+        state->valid = true;
+        state->generation = header.generation;
+        state->erase_count = header.erase_count;
+        if (header.erase_count > stats.max_erase_count) {
+            stats.max_erase_count = header.erase_count;
+        }
+        if (head_segment < 0 || header.generation > head_generation) {
+            head_segment = segment;
+            head_generation = header.generation;
+        }
+
+        uint32_t address = segment_start(segment);
+        uint32_t size;
+        while ((size = load_record(address)) != 0) {
+            const record_header_t *record = (const record_header_t *)record_buffer;
+            if (record->state == STATE_PENDING) {
+                state->pending++;
+            }
+            if (!any_record || (int32_t)(record->seq - last_seq) > 0) {
+                last_seq = record->seq;
+                any_record = true;
+            }
+            address += size;
+        }
+        if (segment == head_segment) {
+            head_offset = address % MESSAGE_STORE_SEGMENT_SIZE;
+            if (address % MESSAGE_STORE_SEGMENT_SIZE == 0) {
+                head_offset = MESSAGE_STORE_SEGMENT_SIZE;
+            }
+        }
+    }
+    last_generation = head_generation;
+    next_seq = any_record ? last_seq + 1 : 0;
+
+    // Records only go after the last good one when the flash behind it is still erased
+    if (head_segment >= 0 && head_offset + sizeof(record_header_t) <= MESSAGE_STORE_SEGMENT_SIZE) {
+        record_header_t tail;
+        const uint8_t *bytes = (const uint8_t *)&tail;
+        esp_partition_read(partition, head_segment * MESSAGE_STORE_SEGMENT_SIZE + head_offset, &tail, sizeof(tail));
+        for (size_t i = 0; i < sizeof(tail); i++) {
+            if (bytes[i] != 0xFF) {
+                head_offset = MESSAGE_STORE_SEGMENT_SIZE;
+                break;
+            }
+        }
+    }
+}
+
+esp_err_t message_store_init(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, MESSAGE_STORE_PARTITION);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "No %s partition, messages won't survive a reset", MESSAGE_STORE_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    store_lock = xSemaphoreCreateMutex();
+    if (store_lock == NULL) {
+        partition = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    segment_count = partition->size / MESSAGE_STORE_SEGMENT_SIZE;
+    if (segment_count > MESSAGE_STORE_MAX_SEGMENTS) {
+        segment_count = MESSAGE_STORE_MAX_SEGMENTS;
+    }
+    if (segment_count < 2) {
+        partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    scan_segments();
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = service_timer_callback,
+        .name = "message_store",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &service_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(service_timer, MESSAGE_STORE_SERVICE_MS * 1000ULL);
+    }
+    if (err != ESP_OK) {
+        partition = NULL;
+        return err;
+    }
+
+    message_store_stats_t snapshot;
+    message_store_get_stats(&snapshot);
+    ESP_LOGI(TAG, "Message store: %d segments, %" PRIu32 " unacknowledged message(s) to replay", segment_count,
+             snapshot.pending);
+    return ESP_OK;
+}
+
+// Stages a QoS 1 message; it is written to flash and published from the I/O work queue
+esp_err_t message_store_append(const char *topic, const char *payload, size_t length)
+{
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t topic_length = strlen(topic);
+    uint32_t size = record_size(topic_length + length);
+    if (topic_length == 0 || topic_length >= MESSAGE_STORE_TOPIC_SIZE || size > MESSAGE_STORE_MAX_RECORD) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    if (staging_length + size > sizeof(staging)) {
+        xSemaphoreGive(store_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    uint8_t *record = &staging[staging_length];
+    record_header_t header = {
+        .state = STATE_PENDING,
+        .seq = next_seq++,
+        .topic_length = topic_length,
+        .payload_length = length,
+    };
+    memcpy(record + sizeof(header), topic, topic_length);
+    memcpy(record + sizeof(header) + topic_length, payload, length);
+    memset(record + sizeof(header) + topic_length + length, 0xFF, size - sizeof(header) - topic_length - length);
+    header.crc = record_crc(&header, record + sizeof(header));
+    memcpy(record, &header, sizeof(header));
+    staging_length += size;
+    stats.appended++;
+    xSemaphoreGive(store_lock);
+
+    schedule_service();
+    return ESP_OK;
+}
+
+// Called from the MQTT event handler; the work happens on the I/O work queue
+void message_store_on_connected(void)
+{
+    if (partition != NULL) {
+        work_queue_submit_io(service_work, NULL);
+    }
+}
+
+// Every PUBACK is recorded, the work queue sorts out which ones belong to stored messages. Nothing is lost
+// when the work queue is full: the service timer drains them instead.
+void message_store_on_published(int msg_id)
+{
+    bool submit;
+
+    if (partition == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&puback_lock);
+    if (puback_count == MESSAGE_STORE_PUBACKS) {
+        // Undrained this long, the oldest id goes; a stored message among them is resent after the timeout
+        memmove(pubacks, pubacks + 1, (MESSAGE_STORE_PUBACKS - 1) * sizeof(pubacks[0]));
+        puback_count--;
+    }
+    pubacks[puback_count++] = msg_id;
+    submit = !puback_drain_submitted;
+    puback_drain_submitted = true;
+    portEXIT_CRITICAL(&puback_lock);
+
+    if (submit && work_queue_submit_io(service_work, NULL) != ESP_OK) {
+        portENTER_CRITICAL(&puback_lock);
+        puback_drain_submitted = false;
+        portEXIT_CRITICAL(&puback_lock);
+    }
+}
+
+void message_store_get_stats(message_store_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (partition == NULL) {
+        return;
+    }
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    *out = stats;
+    for (int i = 0; i < segment_count; i++) {
+        out->pending += segments[i].pending;
+    }
+    xSemaphoreGive(store_lock);
+}
+// --------------------------------------------------------------------------------
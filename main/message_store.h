@@ -0,0 +1,41 @@
+#ifndef MESSAGE_STORE_H
+#define MESSAGE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+// QoS 1 messages that must survive outages and resets are appended to a log on the "msgstore" flash
+// partition and published from there, oldest first, with at most MESSAGE_STORE_WINDOW awaiting their
+// PUBACK. The log is a ring of one-sector segments written in turn, so every sector wears evenly; a
+// segment is only erased for reuse once all of its messages are acknowledged. Appends and
+// acknowledgements are committed to flash in batches on the I/O work queue.
+#define MESSAGE_STORE_PARTITION "msgstore"
+#define MESSAGE_STORE_SEGMENT_SIZE 4096     // one flash sector
+#define MESSAGE_STORE_MAX_SEGMENTS 64
+#define MESSAGE_STORE_TOPIC_SIZE 64
+#define MESSAGE_STORE_MAX_RECORD 256        // header, topic and payload
+#define MESSAGE_STORE_STAGING_SIZE 1024     // appended records waiting for the next commit
+#define MESSAGE_STORE_MAX_ACKS 16           // acknowledgements waiting for the next commit
+#define MESSAGE_STORE_WINDOW 4
+#define MESSAGE_STORE_PUBACKS 16            // PUBACK ids held for the work queue, any QoS 1 message's
+#define MESSAGE_STORE_RESEND_MS 60000       // longer than esp-mqtt keeps an unacknowledged message
+#define MESSAGE_STORE_SERVICE_MS 5000
+
+typedef struct {
+    uint32_t pending;           // stored and not acknowledged yet
+    uint32_t appended;
+    uint32_t acknowledged;
+    uint32_t rejected;          // lost because every segment still held unacknowledged messages
+    uint32_t resent;
+    uint32_t max_erase_count;
+} message_store_stats_t;
+
+// Function prototypes
+esp_err_t message_store_init(void);
+esp_err_t message_store_append(const char *topic, const char *payload, size_t length);
+void message_store_on_connected(void);
+void message_store_on_published(int msg_id);
+void message_store_get_stats(message_store_stats_t *stats);
+
+#endif // MESSAGE_STORE_H
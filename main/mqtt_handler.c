@@ -5,11 +5,24 @@
 #include <esp_wifi.h>
 #include <esp_netif.h>
 #include <esp_event.h>
+#include <esp_heap_caps.h>
 #include <driver/gpio.h>
-#include <cJSON.h>
 #include "config.h"
 #include "mqtt_handler.h"
 #include "led_control.h"
+#include "led_commands.h"
+#include "payload_template.h"
+#include "json_alloc.h"
+#include "topic_router.h"
+#include "work_queue.h"
+#include "state_publisher.h"
+#include "telemetry.h"
+#include "mqtt_publish.h"
+#include "publish_scheduler.h"
+#include "backpressure.h"
+#include "publish_policy.h"
+#include "outbox_ring.h"
+#include "message_store.h"
 #include <esp_random.h> // For random 4-digit value (if needed)
 
 static const char *TAG = CONFIG_TAG;        // Defined in config.h
@@ -54,49 +67,168 @@ void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id
 
 
 // --------------------------------------------------------------------------------
-// Heartbeat Task
+// Telemetry Providers
 // --------------------------------------------------------------------------------
-void heartbeat_task(void *pvParameters)
+static esp_err_t provide_health(cJSON *frame, void *ctx)
 {
-    TaskHandle_t task_handle = xTaskGetCurrentTaskHandle();
-    TickType_t last_wake_time = xTaskGetTickCount();
-    const TickType_t heartbeat_interval = pdMS_TO_TICKS(10000);
+    outbox_ring_stats_t outbox;
+    message_store_stats_t store;
+    backpressure_stats_t backpressure;
+    outbox_ring_get_stats(&outbox);
+    message_store_get_stats(&store);
+    backpressure_get_stats(&backpressure);
 
-    while (true) {
-        if (mqtt_connected && wifi_connected) {
-            char topic[64];
-            snprintf(topic, sizeof(topic), "esp32/kiosk/%s/heartbeat", KIOSK_NAME);
-            esp_mqtt_client_enqueue(mqtt_client, topic, "alive", 0, 1, 0, false);
-            ESP_LOGI(TAG, "Enqueued heartbeat to %s", topic);
-            log_stack_usage("Heartbeat", task_handle);
-            ESP_LOGI(TAG, "Free heap: %" PRIu32 " bytes", esp_get_free_heap_size());
+    if (cJSON_AddInt64ToObject(frame, "free_heap", esp_get_free_heap_size()) == NULL ||
+        cJSON_AddInt64ToObject(frame, "min_free_heap", esp_get_minimum_free_heap_size()) == NULL ||
+        cJSON_AddInt64ToObject(frame, "largest_block", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT)) == NULL ||
+        cJSON_AddInt64ToObject(frame, "outbox_peak", outbox.peak_bytes) == NULL ||
+        cJSON_AddInt64ToObject(frame, "outbox_rejected", outbox.rejected) == NULL ||
+        cJSON_AddInt64ToObject(frame, "stored", store.pending) == NULL ||
+        cJSON_AddInt64ToObject(frame, "store_wear", store.max_erase_count) == NULL ||
+        cJSON_AddInt64ToObject(frame, "send_rate", backpressure.rate) == NULL ||
+        cJSON_AddInt64ToObject(frame, "rtt_ms", backpressure.srtt_ms) == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t provide_led_state(cJSON *frame, void *ctx)
+{
+    return cJSON_AddStringToObject(frame, "led", led_state ? "on" : "off") != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static esp_err_t provide_rssi(cJSON *frame, void *ctx)
+{
+    wifi_ap_record_t ap_info;
+    esp_err_t err = esp_wifi_sta_get_ap_info(&ap_info);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return cJSON_AddInt64ToObject(frame, "rssi", ap_info.rssi) != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+// Work queue, "work" for the command lane and "io_work" for the I/O lane:
+// [completed, dropped, average wait ms, max wait ms, max run ms]
+static esp_err_t provide_work_queue(cJSON *frame, void *ctx)
+{
+    static const char *const names[WORK_LANE_COUNT] = {
+        [WORK_LANE_COMMAND] = "work",
+        [WORK_LANE_IO] = "io_work",
+    };
+
+    for (int lane = 0; lane < WORK_LANE_COUNT; lane++) {
+        work_queue_stats_t work;
+        work_queue_get_stats(lane, &work);
+
+        int64_t average_wait_us = work.completed ? work.total_wait_us / work.completed : 0;
+        const int values[] = {
+            work.completed,
+            work.dropped,
+            average_wait_us / 1000,
+            work.max_wait_us / 1000,
+            work.max_run_us / 1000,
+        };
+        cJSON *entry = cJSON_CreateIntArray(values, sizeof(values) / sizeof(values[0]));
+        if (entry == NULL || !cJSON_AddItemToObject(frame, names[lane], entry)) {
+            cJSON_Delete(entry);
+            return ESP_ERR_NO_MEM;
         }
-        vTaskDelayUntil(&last_wake_time, heartbeat_interval);
     }
+    return ESP_OK;
+}
+
+// JSON allocator: [pool blocks in use, pool peak, pool fallbacks, internal RAM fragmentation %,
+// large block region fragmentation %]; the pool figures are 0 unless JSON_ALLOC_POOL is defined
+static esp_err_t provide_json_heap(cJSON *frame, void *ctx)
+{
+    json_alloc_stats_t pool;
+    json_alloc_fragmentation_t fragmentation;
+    json_alloc_get_stats(&pool);
+    json_alloc_get_fragmentation(&fragmentation);
+
+    const int values[] = {
+        pool.pool_in_use,
+        pool.pool_peak,
+        pool.pool_fallbacks,
+        fragmentation.internal,
+        fragmentation.large,
+    };
+    cJSON *entry = cJSON_CreateIntArray(values, sizeof(values) / sizeof(values[0]));
+    if (entry == NULL || !cJSON_AddItemToObject(frame, "json_heap", entry)) {
+        cJSON_Delete(entry);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Per publish class: [sent, dropped or refused, average latency ms, max latency ms]
+static esp_err_t provide_publish_classes(cJSON *frame, void *ctx)
+{
+    static const char *const names[PUBLISH_CLASS_COUNT] = { "event", "state", "telemetry" };
+    cJSON *classes = cJSON_AddObjectToObject(frame, "publish");
+    if (classes == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int cls = 0; cls < PUBLISH_CLASS_COUNT; cls++) {
+        publish_class_stats_t stats;
+        publish_scheduler_get_stats(cls, &stats);
+        int64_t average_us = stats.sent ? stats.total_latency_us / stats.sent : 0;
+        const int values[] = {
+            stats.sent,
+            stats.dropped + stats.rejected,
+            average_us / 1000,
+            stats.max_latency_us / 1000,
+        };
+        cJSON *entry = cJSON_CreateIntArray(values, sizeof(values) / sizeof(values[0]));
+        if (entry == NULL || !cJSON_AddItemToObject(classes, names[cls], entry)) {
+            cJSON_Delete(entry);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+// Called once from app_main before telemetry starts; replaces the separate heartbeat publish
+void mqtt_register_telemetry(void)
+{
+    ESP_ERROR_CHECK(telemetry_register(provide_health, NULL));
+    ESP_ERROR_CHECK(telemetry_register(provide_work_queue, NULL));
+    ESP_ERROR_CHECK(telemetry_register(provide_json_heap, NULL));
+    ESP_ERROR_CHECK(telemetry_register(provide_led_state, NULL));
+    ESP_ERROR_CHECK(telemetry_register(provide_rssi, NULL));
+    ESP_ERROR_CHECK(telemetry_register(provide_publish_classes, NULL));
 }
 // --------------------------------------------------------------------------------
 
 
 // --------------------------------------------------------------------------------
-// LED Status Task
+// LED Status
 // --------------------------------------------------------------------------------
-void led_status_task(void *pvParameters)
+static int led_status_value = -1;
+
+static int32_t read_led_state(void)
 {
-    TaskHandle_t task_handle = xTaskGetCurrentTaskHandle();
-    TickType_t last_wake_time = xTaskGetTickCount();
-    const TickType_t status_interval = pdMS_TO_TICKS(5000);     // Update status every 5s
+    return led_state;
+}
 
-    while (true) {
-        if (mqtt_connected && wifi_connected) {
-            char topic[64];
-            snprintf(topic, sizeof(topic), "esp32/kiosk/%s/led_status", KIOSK_NAME);
-            const char *status = led_state ? "on" : "off";
-            esp_mqtt_client_enqueue(mqtt_client, topic, status, 0, 1, 0, false);
-            ESP_LOGI(TAG, "Enqueued LED status to %s: %s", topic, status);
-            log_stack_usage("LED Status", task_handle);
-        }
-        vTaskDelayUntil(&last_wake_time, status_interval);
-    }
+static void format_led_state(int32_t value, char *payload, size_t size)
+{
+    snprintf(payload, size, "%s", value ? "on" : "off");
+}
+
+// Called once from app_main before the state publisher starts
+void mqtt_register_state_values(void)
+{
+    // Published on every change, refreshed every 5 minutes
+    const state_value_config_t led_status = {
+        .topic = "esp32/kiosk/" KIOSK_NAME "/led_status",
+        .read = read_led_state,
+        .format = format_led_state,
+        .min_interval_ms = 100,
+        .max_interval_ms = 5 * 60 * 1000,
+        .policy = PUBLISH_POLICY_LED_STATUS,
+    };
+    ESP_ERROR_CHECK(state_publisher_register(&led_status, &led_status_value));
 }
 // --------------------------------------------------------------------------------
 
@@ -111,44 +243,44 @@ void button_task(void *pvParameters)
     const TickType_t debounce_interval = pdMS_TO_TICKS(50); // 50ms debounce
     bool last_button_state = true; // Assume button not pressed (pull-up, active-low)
 
+    // Compile the payload once; each press only overwrites the slot digits
+    payload_template_t payload;
+    ESP_ERROR_CHECK(payload_template_compile(&payload, "{\"user_id\":\"${user_id:7}\",\"pin\":\"${pin:4}\"}"));
+    const int user_id_slot = payload_template_find_slot(&payload, "user_id");
+    const int pin_slot = payload_template_find_slot(&payload, "pin");
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "esp32/kiosk/%s/button", KIOSK_NAME);
+
     while (true) {
         bool current_button_state = gpio_get_level(BUTTON_GPIO);
 
         // Detect button press (simulating * or #)
         if (last_button_state && !current_button_state) {
-            if (mqtt_connected && wifi_connected) {
-                char topic[64];
-                snprintf(topic, sizeof(topic), "esp32/kiosk/%s/button", KIOSK_NAME);
-
-                // Create JSON payload
-                cJSON *root = cJSON_CreateObject();
-
-                // Generate 7 digit number
-                char seven_digit_str[8];
-                uint32_t seven_digit_value = esp_random() % 10000000; // Random number between 0 and 9999999
-                snprintf(seven_digit_str, sizeof(seven_digit_str), "%07" PRIu32, seven_digit_value);
-                cJSON_AddStringToObject(root, "user_id", seven_digit_str);
-
-                // Generate or set the 4-digit value (example: random 0000-9999)
-                char four_digit_str[5];
-                uint32_t four_digit_value = esp_random() % 10000; // Random 4-digit value
-                snprintf(four_digit_str, sizeof(four_digit_str), "%04" PRIu32, four_digit_value);
-                cJSON_AddStringToObject(root, "pin", four_digit_str);
-
-                char *payload = cJSON_PrintUnformatted(root);
-                if (payload) {
-                    esp_mqtt_client_enqueue(mqtt_client, topic, payload, 0, 1, 0, false);
-                    ESP_LOGI(TAG, "Enqueued JSON to %s: %s", topic, payload);
-                    cJSON_free(payload); // Free the JSON string
+            // Generate 7 digit number
+            uint32_t seven_digit_value = esp_random() % 10000000; // Random number between 0 and 9999999
+            // Generate or set the 4-digit value (example: random 0000-9999)
+            uint32_t four_digit_value = esp_random() % 10000; // Random 4-digit value
+
+            publish_policy_t button_policy = publish_policy_get(PUBLISH_POLICY_BUTTON);
+            if (payload_template_set_u32(&payload, user_id_slot, seven_digit_value) == ESP_OK &&
+                payload_template_set_u32(&payload, pin_slot, four_digit_value) == ESP_OK) {
+                // Stored presses are published from flash, and kept across outages and resets until acknowledged
+                if (message_store_append(topic, payload.buffer, payload.length) == ESP_OK) {
+                    ESP_LOGI(TAG, "Stored JSON for %s: %s", topic, payload.buffer);
+                } else if (publish_scheduler_submit(PUBLISH_CLASS_EVENT, topic, payload.buffer, payload.length,
+                                                    button_policy.qos, button_policy.retain) == ESP_OK) {
+                    ESP_LOGI(TAG, "Queued JSON to %s: %s", topic, payload.buffer);
                 } else {
-                    ESP_LOGE(TAG, "Failed to create JSON payload");
+                    ESP_LOGW(TAG, "Message store unavailable and publish queue full, button press dropped");
                 }
-                cJSON_Delete(root); // Free the JSON object
-                log_stack_usage("Button", task_handle);
-
-                // Reset buffer and counter
-                ESP_LOGI(TAG, "Buffer reset, ready for new input");
+            } else {
+                ESP_LOGE(TAG, "Failed to fill JSON payload");
             }
+            log_stack_usage("Button", task_handle);
+
+            // Reset buffer and counter
+            ESP_LOGI(TAG, "Buffer reset, ready for new input");
         }
 
         last_button_state = current_button_state;
@@ -158,6 +290,72 @@ void button_task(void *pvParameters)
 // --------------------------------------------------------------------------------
 
 
+// --------------------------------------------------------------------------------
+// Topic Handlers
+// --------------------------------------------------------------------------------
+// Runs on the work queue's command lane so the LED strip I/O never holds up the MQTT task, and no flash
+// write or publish holds up the LEDs
+static void apply_led_command(void *arg)
+{
+    const led_command_entry_t *command = arg;
+    command->handler();
+    state_publisher_notify(led_status_value);
+}
+
+static void handle_led_command(esp_mqtt_event_handle_t event, void *ctx)
+{
+    const led_command_entry_t *command = led_command_lookup(event->data, event->data_len);
+    if (command == NULL) {
+        ESP_LOGW(TAG, "Unknown LED command: %.*s", event->data_len, event->data);
+        return;
+    }
+    if (work_queue_submit(apply_led_command, (void *)command) != ESP_OK) {
+        ESP_LOGW(TAG, "Work queue full, dropped LED command %s", command->verb);
+    }
+}
+
+// Runs on the I/O work queue: publishing must not block the MQTT event handler on the scheduler
+static void publish_announce(void *arg)
+{
+    esp_netif_ip_info_t ip_info;
+    esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_STA_DEF"), &ip_info);
+    char ip_str[16];
+    snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip_info.ip));
+    char announce_topic[64];
+    snprintf(announce_topic, sizeof(announce_topic), "esp32/kiosk/%s/announce", KIOSK_NAME);
+    publish_policy_t policy = publish_policy_get(PUBLISH_POLICY_ANNOUNCE);
+    if (publish_scheduler_submit(PUBLISH_CLASS_EVENT, announce_topic, ip_str, 0, policy.qos,
+                                 policy.retain) == ESP_OK) {
+        ESP_LOGI(TAG, "Queued IP: %s to %s", ip_str, announce_topic);
+    }
+}
+
+static void handle_announce_request(esp_mqtt_event_handle_t event, void *ctx)
+{
+    ESP_LOGI(TAG, "Announce requested");
+    work_queue_submit_io(publish_announce, NULL);
+}
+
+static void handle_qos_policy(esp_mqtt_event_handle_t event, void *ctx)
+{
+    esp_err_t err = publish_policy_update(event->data, event->data_len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Rejected publish policy update from %.*s: %s", event->topic_len, event->topic,
+                 esp_err_to_name(err));
+    }
+}
+
+// Called once from app_main before the MQTT client starts
+void mqtt_register_routes(void)
+{
+    ESP_ERROR_CHECK(topic_router_add("esp32/kiosk/" KIOSK_NAME "/led", handle_led_command, NULL));
+    ESP_ERROR_CHECK(topic_router_add("esp32/request_announce", handle_announce_request, NULL));
+    ESP_ERROR_CHECK(topic_router_add("esp32/qos_policy", handle_qos_policy, NULL));
+    ESP_ERROR_CHECK(topic_router_add("esp32/kiosk/" KIOSK_NAME "/qos_policy", handle_qos_policy, NULL));
+}
+// --------------------------------------------------------------------------------
+
+
 // --------------------------------------------------------------------------------
 // MQTT Event Handler
 // --------------------------------------------------------------------------------
@@ -168,60 +366,29 @@ void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT connected to broker");
             mqtt_connected = true;
+            mqtt_publish_reset_aliases();
             xEventGroupSetBits(connectivity_event_group, MQTT_CONNECTED_BIT);
             esp_mqtt_client_subscribe(mqtt_client, "esp32/kiosk/" KIOSK_NAME "/led", 1);
             esp_mqtt_client_subscribe(mqtt_client, "esp32/request_announce", 1);
-            esp_netif_ip_info_t ip_info;
-            esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_STA_DEF"), &ip_info);
-            char ip_str[16];
-            snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip_info.ip));
-            char announce_topic[64];
-            snprintf(announce_topic, sizeof(announce_topic), "esp32/kiosk/%s/announce", KIOSK_NAME);
-            esp_mqtt_client_enqueue(mqtt_client, announce_topic, ip_str, 0, 1, 0, false);
-            ESP_LOGI(TAG, "Enqueued IP: %s to %s", ip_str, announce_topic);
+            esp_mqtt_client_subscribe(mqtt_client, "esp32/qos_policy", 1);
+            esp_mqtt_client_subscribe(mqtt_client, "esp32/kiosk/" KIOSK_NAME "/qos_policy", 1);
+            state_publisher_refresh_all();
+            message_store_on_connected();
+            publish_scheduler_kick();
+            work_queue_submit_io(publish_announce, NULL);
             break;
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "MQTT disconnected from broker");
             mqtt_connected = false;
             xEventGroupClearBits(connectivity_event_group, MQTT_CONNECTED_BIT);
             break;
+        case MQTT_EVENT_PUBLISHED:
+            backpressure_on_acked(event->msg_id);
+            message_store_on_published(event->msg_id);
+            publish_scheduler_kick();       // the outbox has room again
+            break;
         case MQTT_EVENT_DATA:
-            if (strncmp(event->topic, "esp32/kiosk/" KIOSK_NAME "/led", event->topic_len) == 0) {
-                bool publish_status = false;
-                if (strncmp(event->data, "toggle", event->data_len) == 0) {
-                    led_state = !led_state;
-                    set_led_state(led_state);
-                    ESP_LOGI(TAG, "LED toggled to %d", led_state);
-                    publish_status = true;
-                } else if (strncmp(event->data, "on", event->data_len) == 0) {
-                    led_state = true;
-                    set_led_state(led_state);
-                    ESP_LOGI(TAG, "LED turned on");
-                    publish_status = true;
-                } else if (strncmp(event->data, "off", event->data_len) == 0) {
-                    led_state = false;
-                    set_led_state(led_state);
-                    ESP_LOGI(TAG, "LED turned off");
-                    publish_status = true;
-                }
-
-                if (publish_status && mqtt_connected && wifi_connected) {
-                    char status_topic[64];
-                    snprintf(status_topic, sizeof(status_topic), "esp32/kiosk/%s/led_status", KIOSK_NAME);
-                    const char *status = led_state ? "on" : "off";
-                    esp_mqtt_client_enqueue(mqtt_client, status_topic, status, 0, 0, 0, true);
-                    ESP_LOGI(TAG, "Immediate LED status update enqueued to %s: %s", status_topic, status);
-                }
-            } else if (strncmp(event->topic, "esp32/request_announce", event->topic_len) == 0) {
-                esp_netif_ip_info_t ip_info;
-                esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_STA_DEF"), &ip_info);
-                char ip_str[16];
-                snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip_info.ip));
-                char announce_topic[64];
-                snprintf(announce_topic, sizeof(announce_topic), "esp32/kiosk/%s/announce", KIOSK_NAME);
-                esp_mqtt_client_enqueue(mqtt_client, announce_topic, ip_str, 0, 1, 0, false);
-                ESP_LOGI(TAG, "Enqueued IP: %s to %s on announce request", ip_str, announce_topic);
-            }
+            topic_router_dispatch(event);
             break;
         case MQTT_EVENT_ERROR:
             ESP_LOGE(TAG, "MQTT error, error_code=%d", event->error_handle->error_type);
@@ -23,8 +23,9 @@ extern EventGroupHandle_t connectivity_event_group;
 // Function prototypes
 void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
-void heartbeat_task(void *pvParameters);
-void led_status_task(void *pvParameters);
+void mqtt_register_routes(void);
+void mqtt_register_telemetry(void);
+void mqtt_register_state_values(void);
 void button_task(void *pvParameters);
 
 #endif // MQTT_HANDLER_H
@@ -0,0 +1,168 @@
+#include <string.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#ifdef CONFIG_MQTT_PROTOCOL_5
+#include <mqtt5_client.h>
+#endif
+#include "config.h"
+#include "mqtt_handler.h"
+#include "mqtt_publish.h"
+#include "backpressure.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+#ifdef CONFIG_MQTT_PROTOCOL_5
+typedef struct {
+    char topic[MQTT_PUBLISH_TOPIC_SIZE];
+    uint32_t publishes;
+    uint16_t alias;             // 0 until the topic is hot
+    bool established;           // the broker has seen topic and alias together on this connection
+} alias_topic_t;
+
+static alias_topic_t topics[MQTT_PUBLISH_MAX_TOPICS];
+static int topic_count = 0;
+static uint16_t next_alias = 1;
+static uint16_t alias_limit = MQTT_PUBLISH_MAX_ALIASES;
+static uint32_t alias_generation = 0;       // connection the aliases above were handed out on
+#endif
+
+static SemaphoreHandle_t publish_lock = NULL;
+static uint32_t connection_generation = 0;  // bumped on every connect
+static portMUX_TYPE generation_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// --------------------------------------------------------------------------------
+// Topic Aliases
+// --------------------------------------------------------------------------------
+#ifdef CONFIG_MQTT_PROTOCOL_5
+static alias_topic_t *find_topic(const char *topic)
+{
+    for (int i = 0; i < topic_count; i++) {
+        if (strcmp(topics[i].topic, topic) == 0) {
+            return &topics[i];
+        }
+    }
+    if (topic_count == MQTT_PUBLISH_MAX_TOPICS || strlen(topic) >= MQTT_PUBLISH_TOPIC_SIZE) {
+        return NULL;
+    }
+    alias_topic_t *entry = &topics[topic_count++];
+    strcpy(entry->topic, topic);
+    entry->publishes = 0;
+    entry->alias = 0;
+    entry->established = false;
+    return entry;
+}
+
+// The publish property is consumed by the next publish, so it is set and used under publish_lock
+static int publish_aliased(alias_topic_t *entry, const char *data, int len, bool retain)
+{
+    esp_mqtt5_publish_property_config_t property = {
+        .topic_alias = entry->alias,
+    };
+    if (esp_mqtt5_client_set_publish_property(mqtt_client, &property) != ESP_OK) {
+        return -1;
+    }
+    // Once established, the empty topic tells the broker to use the alias
+    const char *topic = entry->established ? "" : entry->topic;
+    int msg_id = esp_mqtt_client_publish(mqtt_client, topic, data, len, 0, retain);
+    if (msg_id < 0) {
+        // Don't leave the alias behind for an unrelated publish
+        const esp_mqtt5_publish_property_config_t no_alias = { 0 };
+        esp_mqtt5_client_set_publish_property(mqtt_client, &no_alias);
+        return -1;
+    }
+    entry->established = true;
+    return msg_id;
+}
+
+// A new connection since the last QoS 0 publish: the broker has forgotten every alias
+static void expire_aliases(void)
+{
+    portENTER_CRITICAL(&generation_lock);
+    uint32_t generation = connection_generation;
+    portEXIT_CRITICAL(&generation_lock);
+
+    if (generation == alias_generation) {
+        return;
+    }
+    for (int i = 0; i < topic_count; i++) {
+        topics[i].alias = 0;
+        topics[i].established = false;
+    }
+    next_alias = 1;
+    alias_limit = MQTT_PUBLISH_MAX_ALIASES;
+    alias_generation = generation;
+}
+
+static int publish_qos0(const char *topic, const char *data, int len, bool retain)
+{
+    expire_aliases();
+    alias_topic_t *entry = find_topic(topic);
+
+    if (entry != NULL && mqtt_connected) {
+        entry->publishes++;
+        if (entry->alias == 0 && entry->publishes >= MQTT_PUBLISH_HOT_THRESHOLD && next_alias <= alias_limit) {
+            entry->alias = next_alias++;
+            entry->established = false;
+            ESP_LOGI(TAG, "Topic alias %u assigned to %s", entry->alias, entry->topic);
+        }
+        if (entry->alias != 0) {
+            int msg_id = publish_aliased(entry, data, len, retain);
+            if (msg_id >= 0) {
+                return msg_id;
+            }
+            if (!entry->established) {
+                // Most likely above the broker's Topic Alias Maximum: stop handing out aliases from here on
+                ESP_LOGW(TAG, "Topic alias %u rejected, aliases limited to %u", entry->alias, entry->alias - 1);
+                alias_limit = entry->alias - 1;
+                entry->alias = 0;
+            }
+        }
+    }
+    return esp_mqtt_client_enqueue(mqtt_client, topic, data, len, 0, retain, true);
+}
+#endif
+
+// Aliases are per connection, call on every (re)connect. Runs in the MQTT event handler with the client
+// lock held, so it must not wait for publish_lock: it only marks the aliases stale, and the next QoS 0
+// publish clears them under publish_lock.
+void mqtt_publish_reset_aliases(void)
+{
+    portENTER_CRITICAL(&generation_lock);
+    connection_generation++;
+    portEXIT_CRITICAL(&generation_lock);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Publish
+// --------------------------------------------------------------------------------
+esp_err_t mqtt_publish_init(void)
+{
+    publish_lock = xSemaphoreCreateMutex();
+    return publish_lock != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+// Same contract as esp_mqtt_client_enqueue: returns the message id, -1 on failure or -2 when the outbox is full
+int mqtt_publish(const char *topic, const char *data, int len, int qos, bool retain)
+{
+    int msg_id;
+
+    xSemaphoreTake(publish_lock, portMAX_DELAY);
+#ifdef CONFIG_MQTT_PROTOCOL_5
+    if (qos == 0) {
+        msg_id = publish_qos0(topic, data, len, retain);
+    } else {
+        msg_id = esp_mqtt_client_enqueue(mqtt_client, topic, data, len, qos, retain, false);
+    }
+#else
+    msg_id = esp_mqtt_client_enqueue(mqtt_client, topic, data, len, qos, retain, qos == 0);
+#endif
+    xSemaphoreGive(publish_lock);
+    if (qos > 0 && msg_id > 0) {
+        backpressure_on_sent(msg_id);
+    }
+    return msg_id;
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,26 @@
+#ifndef MQTT_PUBLISH_H
+#define MQTT_PUBLISH_H
+
+#include <stdbool.h>
+#include <esp_err.h>
+
+// Every outbound message goes through mqtt_publish(). With CONFIG_MQTT_PROTOCOL_5, QoS 0 topics that are
+// published repeatedly get an MQTT 5 topic alias, so after the first packet only the 2-byte alias is
+// sent instead of the topic. QoS 0 aliased packets are sent directly rather than queued in the outbox:
+// aliases only live for one connection, and a stored packet could be replayed on the next one.
+// Only QoS 0 publishes are aliased, which with the default publish policy means the telemetry frame;
+// QoS 1 messages (button, announce, LED status) always carry their full topic.
+// Don't call mqtt_publish() from the MQTT event handler: that runs with the client lock held, which
+// mqtt_publish() takes after its own lock, so hand the publish to the work queue instead.
+// mqtt_publish_reset_aliases() is the exception and is meant to be called from there.
+#define MQTT_PUBLISH_MAX_ALIASES 8          // aliases 1..N, brokers advertising fewer cap this
+#define MQTT_PUBLISH_MAX_TOPICS 12          // topics tracked for aliasing
+#define MQTT_PUBLISH_HOT_THRESHOLD 2        // publishes of a topic before it gets an alias
+#define MQTT_PUBLISH_TOPIC_SIZE 64
+
+// Function prototypes
+esp_err_t mqtt_publish_init(void);
+int mqtt_publish(const char *topic, const char *data, int len, int qos, bool retain);
+void mqtt_publish_reset_aliases(void);
+
+#endif // MQTT_PUBLISH_H
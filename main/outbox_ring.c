@@ -0,0 +1,336 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+#include "outbox_ring.h"
+
+#ifdef CONFIG_MQTT_CUSTOM_OUTBOX
+#include <mqtt_outbox.h>
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+#define NO_ITEM (-1)
+#define ENTRY_ALIGN 4
+
+// Descriptors are taken in enqueue order from a ring of their own, so the oldest one always
+// describes the oldest bytes in the data ring. Deleted descriptors stay until they reach the head.
+struct outbox_item {
+    uint32_t offset;            // into ring_data
+    uint32_t length;
+    int msg_id;
+    int msg_type;
+    int msg_qos;
+    outbox_tick_t tick;
+    pending_state_t pending;
+    bool live;
+    int16_t index_next;         // next descriptor in the same message id bucket
+};
+
+struct outbox_t {
+    struct outbox_item items[OUTBOX_RING_MAX_ITEMS];
+    int16_t buckets[OUTBOX_RING_BUCKETS];
+    int head;                   // oldest descriptor, live or not
+    int count;                  // descriptors from head, including deleted ones
+    uint32_t write_offset;
+    outbox_ring_stats_t stats;
+};
+
+static struct outbox_t ring;
+static uint8_t ring_data[OUTBOX_RING_SIZE];
+static bool ring_in_use = false;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// --------------------------------------------------------------------------------
+// Ring Helpers
+// --------------------------------------------------------------------------------
+static int item_index(outbox_handle_t outbox, outbox_item_handle_t item)
+{
+    return (int)(item - outbox->items);
+}
+
+static int16_t *bucket_of(outbox_handle_t outbox, int msg_id)
+{
+    return &outbox->buckets[(uint32_t)msg_id & (OUTBOX_RING_BUCKETS - 1)];
+}
+
+static void index_remove(outbox_handle_t outbox, outbox_item_handle_t item)
+{
+    int16_t *link = bucket_of(outbox, item->msg_id);
+    while (*link != NO_ITEM) {
+        if (*link == item_index(outbox, item)) {
+            *link = item->index_next;
+            return;
+        }
+        link = &outbox->items[*link].index_next;
+    }
+}
+
+// Finds room for length bytes after the newest entry, wrapping to the start when the end is too short
+static bool reserve(outbox_handle_t outbox, uint32_t length, uint32_t *offset)
+{
+    if (outbox->count == 0) {
+        if (length > OUTBOX_RING_SIZE) {
+            return false;
+        }
+        *offset = 0;
+        return true;
+    }
+
+    uint32_t read_offset = outbox->items[outbox->head].offset;
+    if (outbox->write_offset > read_offset) {
+        if (length <= OUTBOX_RING_SIZE - outbox->write_offset) {
+            *offset = outbox->write_offset;
+            return true;
+        }
+        if (length < read_offset) {
+            *offset = 0;
+            return true;
+        }
+        return false;
+    }
+    // Already wrapped: the free space is between the newest and the oldest entry
+    if (outbox->write_offset + length < read_offset) {
+        *offset = outbox->write_offset;
+        return true;
+    }
+    return false;
+}
+
+// Drops deleted descriptors from the head, which is what frees their bytes
+static void reclaim(outbox_handle_t outbox)
+{
+    while (outbox->count > 0 && !outbox->items[outbox->head].live) {
+        outbox->head = (outbox->head + 1) % OUTBOX_RING_MAX_ITEMS;
+        outbox->count--;
+    }
+    if (outbox->count == 0) {
+        outbox->head = 0;
+        outbox->write_offset = 0;
+    }
+}
+
+static void remove_item(outbox_handle_t outbox, outbox_item_handle_t item)
+{
+    index_remove(outbox, item);
+    item->live = false;
+    portENTER_CRITICAL(&stats_lock);
+    outbox->stats.items--;
+    outbox->stats.bytes -= item->length;
+    portEXIT_CRITICAL(&stats_lock);
+    reclaim(outbox);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// esp-mqtt Outbox Interface (mqtt_outbox.h), called with the client lock held
+// --------------------------------------------------------------------------------
+outbox_handle_t outbox_init(void)
+{
+    // A single client is supported, its outbox is the static ring
+    if (ring_in_use) {
+        ESP_LOGE(TAG, "Outbox ring already in use by another client");
+        return NULL;
+    }
+    memset(&ring, 0, sizeof(ring));
+    for (int i = 0; i < OUTBOX_RING_BUCKETS; i++) {
+        ring.buckets[i] = NO_ITEM;
+    }
+    ring_in_use = true;
+    return &ring;
+}
+
+outbox_item_handle_t outbox_enqueue(outbox_handle_t outbox, outbox_message_handle_t message, outbox_tick_t tick)
+{
+    uint32_t length = (uint32_t)message->len + (uint32_t)message->remaining_len;
+    uint32_t reserved = (length + ENTRY_ALIGN - 1) & ~(uint32_t)(ENTRY_ALIGN - 1);
+    uint32_t offset;
+
+    if (outbox->count == OUTBOX_RING_MAX_ITEMS || !reserve(outbox, reserved, &offset)) {
+        portENTER_CRITICAL(&stats_lock);
+        outbox->stats.rejected++;
+        portEXIT_CRITICAL(&stats_lock);
+        ESP_LOGW(TAG, "Outbox full, message %d not stored", message->msg_id);
+        return NULL;
+    }
+
+    int index = (outbox->head + outbox->count) % OUTBOX_RING_MAX_ITEMS;
+    outbox_item_handle_t item = &outbox->items[index];
+    memcpy(&ring_data[offset], message->data, message->len);
+    if (message->remaining_data != NULL) {
+        memcpy(&ring_data[offset + message->len], message->remaining_data, message->remaining_len);
+    }
+    item->offset = offset;
+    item->length = length;
+    item->msg_id = message->msg_id;
+    item->msg_type = message->msg_type;
+    item->msg_qos = message->msg_qos;
+    item->tick = tick;
+    item->pending = QUEUED;
+    item->live = true;
+
+    int16_t *bucket = bucket_of(outbox, item->msg_id);
+    item->index_next = *bucket;
+    *bucket = index;
+
+    outbox->count++;
+    outbox->write_offset = offset + reserved;
+    portENTER_CRITICAL(&stats_lock);
+    outbox->stats.items++;
+    outbox->stats.bytes += length;
+    if (outbox->stats.bytes > outbox->stats.peak_bytes) {
+        outbox->stats.peak_bytes = outbox->stats.bytes;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+    return item;
+}
+
+outbox_item_handle_t outbox_get(outbox_handle_t outbox, int msg_id)
+{
+    // Buckets are newest first; ids repeat only for QoS 0 (id 0), where the oldest is wanted
+    outbox_item_handle_t found = NULL;
+    for (int16_t i = *bucket_of(outbox, msg_id); i != NO_ITEM; i = outbox->items[i].index_next) {
+        if (outbox->items[i].msg_id == msg_id) {
+            found = &outbox->items[i];
+        }
+    }
+    return found;
+}
+
+outbox_item_handle_t outbox_dequeue(outbox_handle_t outbox, pending_state_t pending, outbox_tick_t *tick)
+{
+    for (int n = 0; n < outbox->count; n++) {
+        outbox_item_handle_t item = &outbox->items[(outbox->head + n) % OUTBOX_RING_MAX_ITEMS];
+        if (item->live && item->pending == pending) {
+            if (tick != NULL) {
+                *tick = item->tick;
+            }
+            return item;
+        }
+    }
+    return NULL;
+}
+
+uint8_t *outbox_item_get_data(outbox_item_handle_t item, size_t *len, uint16_t *msg_id, int *msg_type, int *qos)
+{
+    if (item == NULL) {
+        return NULL;
+    }
+    *len = item->length;
+    *msg_id = (uint16_t)item->msg_id;
+    *msg_type = item->msg_type;
+    *qos = item->msg_qos;
+    return &ring_data[item->offset];
+}
+
+esp_err_t outbox_delete_item(outbox_handle_t outbox, outbox_item_handle_t item)
+{
+    if (item == NULL || !item->live) {
+        return ESP_FAIL;
+    }
+    remove_item(outbox, item);
+    return ESP_OK;
+}
+
+esp_err_t outbox_delete(outbox_handle_t outbox, int msg_id, int msg_type)
+{
+    for (int16_t i = *bucket_of(outbox, msg_id); i != NO_ITEM; i = outbox->items[i].index_next) {
+        if (outbox->items[i].msg_id == msg_id && outbox->items[i].msg_type == msg_type) {
+            remove_item(outbox, &outbox->items[i]);
+            return ESP_OK;
+        }
+    }
+    return ESP_FAIL;
+}
+
+int outbox_delete_single_expired(outbox_handle_t outbox, outbox_tick_t current_tick, outbox_tick_t timeout)
+{
+    for (int n = 0; n < outbox->count; n++) {
+        outbox_item_handle_t item = &outbox->items[(outbox->head + n) % OUTBOX_RING_MAX_ITEMS];
+        if (item->live && current_tick - item->tick > timeout) {
+            int msg_id = item->msg_id;
+            remove_item(outbox, item);
+            return msg_id;
+        }
+    }
+    return -1;
+}
+
+int outbox_delete_expired(outbox_handle_t outbox, outbox_tick_t current_tick, outbox_tick_t timeout)
+{
+    int deleted = 0;
+    while (outbox_delete_single_expired(outbox, current_tick, timeout) != -1) {
+        deleted++;
+    }
+    return deleted;
+}
+
+esp_err_t outbox_set_pending(outbox_handle_t outbox, int msg_id, pending_state_t pending)
+{
+    outbox_item_handle_t item = outbox_get(outbox, msg_id);
+    if (item == NULL) {
+        return ESP_FAIL;
+    }
+    item->pending = pending;
+    return ESP_OK;
+}
+
+pending_state_t outbox_item_get_pending(outbox_item_handle_t item)
+{
+    return item != NULL ? item->pending : QUEUED;
+}
+
+esp_err_t outbox_set_tick(outbox_handle_t outbox, int msg_id, outbox_tick_t tick)
+{
+    outbox_item_handle_t item = outbox_get(outbox, msg_id);
+    if (item == NULL) {
+        return ESP_FAIL;
+    }
+    item->tick = tick;
+    return ESP_OK;
+}
+
+uint64_t outbox_get_size(outbox_handle_t outbox)
+{
+    return outbox->stats.bytes;
+}
+
+void outbox_delete_all_items(outbox_handle_t outbox)
+{
+    for (int i = 0; i < OUTBOX_RING_BUCKETS; i++) {
+        outbox->buckets[i] = NO_ITEM;
+    }
+    outbox->head = 0;
+    outbox->count = 0;
+    outbox->write_offset = 0;
+    portENTER_CRITICAL(&stats_lock);
+    outbox->stats.items = 0;
+    outbox->stats.bytes = 0;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void outbox_destroy(outbox_handle_t outbox)
+{
+    outbox_delete_all_items(outbox);
+    ring_in_use = false;
+}
+// --------------------------------------------------------------------------------
+#endif // CONFIG_MQTT_CUSTOM_OUTBOX
+
+
+// --------------------------------------------------------------------------------
+// Statistics
+// --------------------------------------------------------------------------------
+void outbox_ring_get_stats(outbox_ring_stats_t *out)
+{
+#ifdef CONFIG_MQTT_CUSTOM_OUTBOX
+    portENTER_CRITICAL(&stats_lock);
+    *out = ring.stats;
+    portEXIT_CRITICAL(&stats_lock);
+#else
+    memset(out, 0, sizeof(*out));
+#endif
+}
+// --------------------------------------------------------------------------------
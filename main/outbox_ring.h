@@ -0,0 +1,23 @@
+#ifndef OUTBOX_RING_H
+#define OUTBOX_RING_H
+
+#include <stddef.h>
+
+// esp-mqtt outbox (CONFIG_MQTT_CUSTOM_OUTBOX) kept in one static ring buffer instead of a heap
+// allocation per message. Entries are appended at the tail and reclaimed from the head, so a message
+// acknowledged out of order only frees its space once everything older is gone too.
+#define OUTBOX_RING_SIZE 8192           // bytes of packet data
+#define OUTBOX_RING_MAX_ITEMS 32
+#define OUTBOX_RING_BUCKETS 32          // message id index, power of two
+
+typedef struct {
+    size_t items;
+    size_t bytes;               // packet bytes of the live entries
+    size_t peak_bytes;
+    size_t rejected;            // enqueues refused for lack of space or slots
+} outbox_ring_stats_t;
+
+// Function prototypes
+void outbox_ring_get_stats(outbox_ring_stats_t *stats);
+
+#endif // OUTBOX_RING_H
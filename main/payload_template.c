@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include "config.h"
+#include "payload_template.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+// --------------------------------------------------------------------------------
+// Slot Parsing
+// --------------------------------------------------------------------------------
+// Parse "${name:N}" or "${name:<N}" at text. Returns the length of the placeholder, or 0 if it is malformed.
+static size_t parse_slot(const char *text, payload_slot_t *slot)
+{
+    const char *name = text + 2;
+    const char *colon = strchr(name, ':');
+    const char *cursor;
+    size_t width = 0;
+
+    if (colon == NULL || colon == name || (size_t)(colon - name) >= PAYLOAD_TEMPLATE_MAX_NAME) {
+        return 0;
+    }
+    memset(slot, 0, sizeof(*slot));
+    memcpy(slot->name, name, colon - name);
+
+    cursor = colon + 1;
+    if (*cursor == '<') {
+        slot->bounded = true;
+        cursor++;
+    }
+    if (*cursor < '0' || *cursor > '9') {
+        return 0;
+    }
+    while (*cursor >= '0' && *cursor <= '9') {
+        width = width * 10 + (size_t)(*cursor - '0');
+        if (width > 255) {
+            return 0;
+        }
+        cursor++;
+    }
+    if (*cursor != '}' || width == 0) {
+        return 0;
+    }
+    slot->width = width;
+
+    return (size_t)(cursor + 1 - text);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Compile / Free
+// --------------------------------------------------------------------------------
+esp_err_t payload_template_compile(payload_template_t *tmpl, const char *text)
+{
+    payload_slot_t slot;
+    size_t length = 0;
+    size_t placeholder;
+    const char *cursor;
+    char *out;
+
+    if (tmpl == NULL || text == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(tmpl, 0, sizeof(*tmpl));
+
+    // First pass: validate the slots and size the buffer
+    for (cursor = text; *cursor != '\0'; ) {
+        if (cursor[0] == '$' && cursor[1] == '{') {
+            placeholder = parse_slot(cursor, &slot);
+            if (placeholder == 0 || tmpl->slot_count == PAYLOAD_TEMPLATE_MAX_SLOTS) {
+                ESP_LOGE(TAG, "Bad template slot at offset %u", (unsigned)(cursor - text));
+                return ESP_ERR_INVALID_ARG;
+            }
+            slot.offset = length;
+            tmpl->slots[tmpl->slot_count++] = slot;
+            length += slot.width;
+            cursor += placeholder;
+        } else {
+            length++;
+            cursor++;
+        }
+    }
+
+    tmpl->buffer = malloc(length + 1);
+    if (tmpl->buffer == NULL) {
+        tmpl->slot_count = 0;
+        return ESP_ERR_NO_MEM;
+    }
+    tmpl->length = length;
+
+    // Second pass: copy the literal text; fixed slots start as spaces, bounded ones as "0" so the text stays valid
+    out = tmpl->buffer;
+    for (cursor = text; *cursor != '\0'; ) {
+        if (cursor[0] == '$' && cursor[1] == '{') {
+            placeholder = parse_slot(cursor, &slot);
+            memset(out, ' ', slot.width);
+            if (slot.bounded) {
+                out[0] = '0';
+            }
+            out += slot.width;
+            cursor += placeholder;
+        } else {
+            *out++ = *cursor++;
+        }
+    }
+    *out = '\0';
+
+    return ESP_OK;
+}
+
+void payload_template_free(payload_template_t *tmpl)
+{
+    if (tmpl == NULL) {
+        return;
+    }
+    free(tmpl->buffer);
+    memset(tmpl, 0, sizeof(*tmpl));
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Slot Access
+// --------------------------------------------------------------------------------
+int payload_template_find_slot(const payload_template_t *tmpl, const char *name)
+{
+    for (size_t i = 0; i < tmpl->slot_count; i++) {
+        if (strcmp(tmpl->slots[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t payload_template_set(payload_template_t *tmpl, int slot, const char *value, size_t length)
+{
+    if (tmpl == NULL || tmpl->buffer == NULL || slot < 0 || (size_t)slot >= tmpl->slot_count || value == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const payload_slot_t *s = &tmpl->slots[slot];
+    if (s->bounded ? (length == 0 || length > s->width) : (length != s->width)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // The value is copied verbatim, so anything that would need escaping is refused
+    for (size_t i = 0; i < length; i++) {
+        if (value[i] == '"' || value[i] == '\\' || (unsigned char)value[i] < 0x20) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    memcpy(tmpl->buffer + s->offset, value, length);
+    memset(tmpl->buffer + s->offset + length, ' ', s->width - length);
+
+    return ESP_OK;
+}
+
+esp_err_t payload_template_set_u32(payload_template_t *tmpl, int slot, uint32_t value)
+{
+    char digits[10];
+    size_t count = 0;
+
+    if (tmpl == NULL || slot < 0 || (size_t)slot >= tmpl->slot_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Fixed slots are zero padded to their width, bounded ones get the shortest form
+    const payload_slot_t *s = &tmpl->slots[slot];
+    if (!s->bounded && s->width > sizeof(digits)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    do {
+        digits[sizeof(digits) - 1 - count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    if (count > s->width) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!s->bounded) {
+        while (count < s->width) {
+            digits[sizeof(digits) - 1 - count++] = '0';
+        }
+    }
+
+    return payload_template_set(tmpl, slot, digits + sizeof(digits) - count, count);
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,38 @@
+#ifndef PAYLOAD_TEMPLATE_H
+#define PAYLOAD_TEMPLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+// A payload template is JSON text compiled once into a reusable buffer. Slots are written as
+//   ${name:N}   fixed slot, the value is always exactly N bytes (e.g. a quoted 7 digit id)
+//   ${name:<N}  bounded slot, up to N bytes padded with trailing spaces; only valid outside quotes
+// Setting a slot overwrites its bytes in place, so sending a message needs no tree and no printing.
+// A template is owned by one task; the buffer may be reused as soon as mqtt_publish returns.
+#define PAYLOAD_TEMPLATE_MAX_SLOTS 8
+#define PAYLOAD_TEMPLATE_MAX_NAME 16
+
+typedef struct {
+    char name[PAYLOAD_TEMPLATE_MAX_NAME];
+    size_t offset;
+    size_t width;
+    bool bounded;
+} payload_slot_t;
+
+typedef struct {
+    char *buffer;
+    size_t length;
+    payload_slot_t slots[PAYLOAD_TEMPLATE_MAX_SLOTS];
+    size_t slot_count;
+} payload_template_t;
+
+// Function prototypes
+esp_err_t payload_template_compile(payload_template_t *tmpl, const char *text);
+void payload_template_free(payload_template_t *tmpl);
+int payload_template_find_slot(const payload_template_t *tmpl, const char *name);
+esp_err_t payload_template_set(payload_template_t *tmpl, int slot, const char *value, size_t length);
+esp_err_t payload_template_set_u32(payload_template_t *tmpl, int slot, uint32_t value);
+
+#endif // PAYLOAD_TEMPLATE_H
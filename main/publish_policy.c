@@ -0,0 +1,192 @@
+#include <stdbool.h>
+#include <string.h>
+#include <esp_log.h>
+#include <nvs.h>
+#include <cJSON.h>
+#include <cJSON_Cache.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+#include "work_queue.h"
+#include "publish_policy.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+typedef struct {
+    const char *name;           // key in the JSON update
+    publish_policy_t defaults;
+    uint8_t min_qos;
+} policy_class_t;
+
+static const policy_class_t classes[PUBLISH_POLICY_COUNT] = {
+    // Stored button presses are only marked done by their PUBACK
+    [PUBLISH_POLICY_BUTTON] = { "button", { .qos = 1, .retain = false }, 1 },
+    [PUBLISH_POLICY_ANNOUNCE] = { "announce", { .qos = 1, .retain = false }, 0 },
+    // Not retained, as before the policy table; {"led_status":{"retain":true}} opts in
+    [PUBLISH_POLICY_LED_STATUS] = { "led_status", { .qos = 1, .retain = false }, 0 },
+    // Superseded by the next frame, so no PUBACK is needed
+    [PUBLISH_POLICY_TELEMETRY] = { "telemetry", { .qos = 0, .retain = false }, 0 },
+};
+
+static publish_policy_t policies[PUBLISH_POLICY_COUNT];
+static portMUX_TYPE policy_lock = portMUX_INITIALIZER_UNLOCKED;
+static cJSONCache *update_cache = NULL;     // only touched by publish_policy_update()
+
+// --------------------------------------------------------------------------------
+// Storage
+// --------------------------------------------------------------------------------
+static bool table_valid(const publish_policy_t *table)
+{
+    for (int i = 0; i < PUBLISH_POLICY_COUNT; i++) {
+        if (table[i].qos > 2 || table[i].qos < classes[i].min_qos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs on the I/O work queue, NVS writes stall for the flash erase
+static void save_work(void *arg)
+{
+    publish_policy_t table[PUBLISH_POLICY_COUNT];
+    nvs_handle_t handle;
+
+    portENTER_CRITICAL(&policy_lock);
+    memcpy(table, policies, sizeof(table));
+    portEXIT_CRITICAL(&policy_lock);
+
+    esp_err_t err = nvs_open(PUBLISH_POLICY_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, PUBLISH_POLICY_KEY, table, sizeof(table));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save publish policy: %s", esp_err_to_name(err));
+    }
+}
+
+// After nvs_flash_init(); a missing or unusable stored table leaves the defaults in place
+esp_err_t publish_policy_init(void)
+{
+    publish_policy_t table[PUBLISH_POLICY_COUNT];
+    size_t size = sizeof(table);
+    nvs_handle_t handle;
+
+    for (int i = 0; i < PUBLISH_POLICY_COUNT; i++) {
+        policies[i] = classes[i].defaults;
+    }
+
+    esp_err_t err = nvs_open(PUBLISH_POLICY_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;      // nothing saved yet
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_get_blob(handle, PUBLISH_POLICY_KEY, table, &size);
+    nvs_close(handle);
+
+    if (err == ESP_OK && size == sizeof(table) && table_valid(table)) {
+        memcpy(policies, table, sizeof(table));
+        ESP_LOGI(TAG, "Publish policy loaded from NVS");
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Stored publish policy unusable, using defaults");
+    }
+    return ESP_OK;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Policy
+// --------------------------------------------------------------------------------
+publish_policy_t publish_policy_get(publish_policy_class_t cls)
+{
+    publish_policy_t policy;
+
+    portENTER_CRITICAL(&policy_lock);
+    policy = policies[cls];
+    portEXIT_CRITICAL(&policy_lock);
+    return policy;
+}
+
+// All or nothing: an invalid entry rejects the whole update. Safe to call from the MQTT event handler,
+// the table is saved on the work queue and only when something changed. Not reentrant: the retained
+// updates come back on every reconnect, so their parsed trees are kept in a cache owned by this function.
+esp_err_t publish_policy_update(const char *json, int length)
+{
+    publish_policy_t table[PUBLISH_POLICY_COUNT];
+    esp_err_t err = ESP_OK;
+
+    if (update_cache == NULL) {
+        // Created on first use, after json_alloc_init() has installed any cJSON hooks
+        update_cache = cJSONCache_Create(PUBLISH_POLICY_CACHE_ENTRIES, PUBLISH_POLICY_CACHE_BYTES);
+        if (update_cache == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Owned by the cache: read only, and not deleted here
+    const cJSON *root = cJSONCache_Parse(update_cache, json, length);
+    if (!cJSON_IsObject(root)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&policy_lock);
+    memcpy(table, policies, sizeof(table));
+    portEXIT_CRITICAL(&policy_lock);
+
+    const cJSON *entry;
+    cJSON_ArrayForEach(entry, root) {
+        int cls = 0;
+        while (cls < PUBLISH_POLICY_COUNT && strcmp(classes[cls].name, entry->string) != 0) {
+            cls++;
+        }
+        if (cls == PUBLISH_POLICY_COUNT) {
+            ESP_LOGW(TAG, "Unknown publish policy class %s", entry->string);
+            continue;
+        }
+
+        const cJSON *qos = cJSON_GetObjectItemCaseSensitive(entry, "qos");
+        const cJSON *retain = cJSON_GetObjectItemCaseSensitive(entry, "retain");
+        if (!cJSON_IsObject(entry) || (qos != NULL && !cJSON_IsNumber(qos)) ||
+            (retain != NULL && !cJSON_IsBool(retain))) {
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        if (qos != NULL) {
+            // 0, 1 or 2 exactly: 0.5 is not QoS 0. Anything else fails table_valid() below.
+            bool whole = qos->valuedouble >= 0 && qos->valuedouble <= 2 && qos->valuedouble == qos->valueint;
+            table[cls].qos = whole ? qos->valueint : UINT8_MAX;
+        }
+        if (retain != NULL) {
+            table[cls].retain = cJSON_IsTrue(retain);
+        }
+    }
+
+    if (err == ESP_OK && !table_valid(table)) {
+        err = ESP_ERR_INVALID_ARG;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    portENTER_CRITICAL(&policy_lock);
+    bool changed = memcmp(table, policies, sizeof(table)) != 0;
+    memcpy(policies, table, sizeof(table));
+    portEXIT_CRITICAL(&policy_lock);
+
+    if (changed) {
+        for (int i = 0; i < PUBLISH_POLICY_COUNT; i++) {
+            ESP_LOGI(TAG, "Publish policy %s: QoS %u%s", classes[i].name, table[i].qos,
+                     table[i].retain ? ", retained" : "");
+        }
+        if (work_queue_submit_io(save_work, NULL) != ESP_OK) {
+            ESP_LOGW(TAG, "I/O work queue full, publish policy applied but not saved");
+        }
+    }
+    return ESP_OK;
+}
+// --------------------------------------------------------------------------------
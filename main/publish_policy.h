@@ -0,0 +1,34 @@
+#ifndef PUBLISH_POLICY_H
+#define PUBLISH_POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+// QoS and retain flag per kind of outbound message, instead of constants at each call site. The table
+// is kept in NVS and can be changed over MQTT with a JSON object such as {"telemetry":{"qos":0}} sent to
+// esp32/qos_policy (all kiosks) or esp32/kiosk/<name>/qos_policy. Classes left out keep their setting.
+#define PUBLISH_POLICY_NAMESPACE "qos_policy"
+#define PUBLISH_POLICY_KEY "table"
+#define PUBLISH_POLICY_CACHE_ENTRIES 2    // one retained update per topic
+#define PUBLISH_POLICY_CACHE_BYTES 2048
+
+typedef enum {
+    PUBLISH_POLICY_BUTTON,
+    PUBLISH_POLICY_ANNOUNCE,
+    PUBLISH_POLICY_LED_STATUS,
+    PUBLISH_POLICY_TELEMETRY,
+    PUBLISH_POLICY_COUNT,
+} publish_policy_class_t;
+
+typedef struct {
+    uint8_t qos;
+    bool retain;
+} publish_policy_t;
+
+// Function prototypes
+esp_err_t publish_policy_init(void);
+publish_policy_t publish_policy_get(publish_policy_class_t cls);
+esp_err_t publish_policy_update(const char *json, int length);
+
+#endif // PUBLISH_POLICY_H
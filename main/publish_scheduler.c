@@ -0,0 +1,291 @@
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "mqtt_handler.h"
+#include "mqtt_publish.h"
+#include "outbox_ring.h"
+#include "work_queue.h"
+#include "publish_scheduler.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+typedef enum {
+    DROP_NEVER,
+    DROP_SAME_TOPIC,            // replace a queued message for the topic, otherwise drop the oldest
+    DROP_OLDEST,
+} drop_policy_t;
+
+typedef struct {
+    char topic[PUBLISH_SCHEDULER_TOPIC_SIZE];
+    char data[PUBLISH_SCHEDULER_PAYLOAD_SIZE + 1];
+    int len;
+    int qos;
+    bool retain;
+    int attempts;               // publishes esp-mqtt refused for reasons other than a full outbox
+    int64_t submitted_us;
+    uint32_t id;                // new for every message written to the slot
+} publish_slot_t;
+
+typedef struct {
+    const char *name;
+    publish_slot_t *slots;
+    int limit;
+    drop_policy_t policy;
+    int outbox_share;           // percent of the outbox the class may fill
+    int head;
+    int count;
+    uint32_t next_id;
+    publish_class_stats_t stats;
+} publish_queue_t;
+
+static publish_slot_t event_slots[PUBLISH_SCHEDULER_EVENT_LIMIT];
+static publish_slot_t state_slots[PUBLISH_SCHEDULER_STATE_LIMIT];
+static publish_slot_t telemetry_slots[PUBLISH_SCHEDULER_TELEMETRY_LIMIT];
+
+// In priority order
+static publish_queue_t queues[PUBLISH_CLASS_COUNT] = {
+    [PUBLISH_CLASS_EVENT] = { "event", event_slots, PUBLISH_SCHEDULER_EVENT_LIMIT, DROP_NEVER, 100 },
+    [PUBLISH_CLASS_STATE] = { "state", state_slots, PUBLISH_SCHEDULER_STATE_LIMIT, DROP_SAME_TOPIC, 50 },
+    [PUBLISH_CLASS_TELEMETRY] = { "telemetry", telemetry_slots, PUBLISH_SCHEDULER_TELEMETRY_LIMIT, DROP_OLDEST, 25 },
+};
+
+static SemaphoreHandle_t scheduler_lock = NULL;
+static esp_timer_handle_t retry_timer = NULL;
+static bool dispatch_scheduled = false;
+static portMUX_TYPE dispatch_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// --------------------------------------------------------------------------------
+// Dispatch
+// --------------------------------------------------------------------------------
+static publish_slot_t *queue_slot(publish_queue_t *queue, int index)
+{
+    return &queue->slots[(queue->head + index) % queue->limit];
+}
+
+static void dequeue(publish_queue_t *queue)
+{
+    queue->head = (queue->head + 1) % queue->limit;
+    queue->count--;
+}
+
+// The head of the queue if it still holds the message that was copied out, NULL if a submit replaced it or
+// pushed it out meanwhile. Called with scheduler_lock held.
+static publish_slot_t *head_if_unchanged(publish_queue_t *queue, uint32_t id)
+{
+    if (queue->count == 0 || queue_slot(queue, 0)->id != id) {
+        return NULL;
+    }
+    return queue_slot(queue, 0);
+}
+
+// Hands queued messages to esp-mqtt, highest class first, while each class is within its outbox share.
+// A full outbox or a lost connection holds the queue until the next attempt; a message esp-mqtt refuses
+// for any other reason is given up on after PUBLISH_SCHEDULER_MAX_ATTEMPTS, so it can't block the class.
+// The head message is copied out and published without scheduler_lock, so submitters never wait on
+// esp-mqtt; a message replaced while it was being published stays queued and goes out after it.
+static bool dispatch(void)
+{
+    static publish_slot_t sending;      // dispatches run one at a time on the I/O worker
+    bool held = false;
+
+    if (!mqtt_connected) {
+        return false;       // kicked again on connect
+    }
+
+    int outbox_bytes = esp_mqtt_client_get_outbox_size(mqtt_client);
+    int64_t now_us = esp_timer_get_time();
+    for (int cls = 0; cls < PUBLISH_CLASS_COUNT; cls++) {
+        publish_queue_t *queue = &queues[cls];
+        while (true) {
+            bool within_share = outbox_bytes < OUTBOX_RING_SIZE * queue->outbox_share / 100;
+            xSemaphoreTake(scheduler_lock, portMAX_DELAY);
+            bool queued = queue->count > 0;
+            if (queued && within_share) {
+                sending = *queue_slot(queue, 0);
+            }
+            xSemaphoreGive(scheduler_lock);
+            if (!queued) {
+                break;
+            }
+            if (!within_share) {
+                held = true;
+                break;
+            }
+
+            outbox_ring_stats_t before, after;
+            outbox_ring_get_stats(&before);
+            int msg_id = mqtt_publish(sending.topic, sending.data, sending.len, sending.qos, sending.retain);
+            outbox_ring_get_stats(&after);
+
+            xSemaphoreTake(scheduler_lock, portMAX_DELAY);
+            publish_slot_t *slot = head_if_unchanged(queue, sending.id);
+            if (msg_id < 0) {
+                bool outbox_full = msg_id == -2 || after.rejected != before.rejected;
+                bool retry = outbox_full || !mqtt_connected ||
+                             (slot != NULL && ++slot->attempts < PUBLISH_SCHEDULER_MAX_ATTEMPTS);
+                if (!retry && slot != NULL) {
+                    ESP_LOGW(TAG, "Publish to %s refused %d times, dropped", slot->topic, slot->attempts);
+                    queue->stats.dropped++;
+                    dequeue(queue);
+                }
+                xSemaphoreGive(scheduler_lock);
+                if (retry) {
+                    held = true;
+                    break;
+                }
+                continue;
+            }
+
+            int64_t latency_us = now_us - sending.submitted_us;
+            queue->stats.sent++;
+            queue->stats.total_latency_us += latency_us;
+            if (latency_us > queue->stats.max_latency_us) {
+                queue->stats.max_latency_us = latency_us;
+            }
+            if (slot != NULL) {
+                dequeue(queue);
+            }
+            xSemaphoreGive(scheduler_lock);
+            outbox_bytes = esp_mqtt_client_get_outbox_size(mqtt_client);
+        }
+    }
+    return held;
+}
+
+static void dispatch_work(void *arg)
+{
+    portENTER_CRITICAL(&dispatch_lock);
+    dispatch_scheduled = false;
+    portEXIT_CRITICAL(&dispatch_lock);
+
+    bool held = dispatch();
+
+    if (held) {
+        // Already running is fine, that attempt covers this one
+        esp_timer_start_once(retry_timer, PUBLISH_SCHEDULER_RETRY_MS * 1000ULL);
+    }
+}
+
+// Doesn't take scheduler_lock, so the MQTT event handler can call it while holding the client lock
+void publish_scheduler_kick(void)
+{
+    bool submit;
+
+    portENTER_CRITICAL(&dispatch_lock);
+    submit = !dispatch_scheduled;
+    dispatch_scheduled = true;
+    portEXIT_CRITICAL(&dispatch_lock);
+
+    if (submit && work_queue_submit_io(dispatch_work, NULL) != ESP_OK) {
+        portENTER_CRITICAL(&dispatch_lock);
+        dispatch_scheduled = false;
+        portEXIT_CRITICAL(&dispatch_lock);
+        if (retry_timer != NULL) {
+            esp_timer_start_once(retry_timer, PUBLISH_SCHEDULER_RETRY_MS * 1000ULL);
+        }
+    }
+}
+
+static void retry_timer_callback(void *arg)
+{
+    publish_scheduler_kick();
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Init / Submit
+// --------------------------------------------------------------------------------
+esp_err_t publish_scheduler_init(void)
+{
+    scheduler_lock = xSemaphoreCreateMutex();
+    if (scheduler_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_callback,
+        .name = "publish_retry",
+    };
+    return esp_timer_create(&timer_args, &retry_timer);
+}
+
+// Copies the message into the class's queue; it is published from the I/O work queue
+esp_err_t publish_scheduler_submit(publish_class_t cls, const char *topic, const char *data, int len, int qos,
+                                   bool retain)
+{
+    if (cls < 0 || cls >= PUBLISH_CLASS_COUNT || topic == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len == 0) {
+        len = strlen(data);
+    }
+    if (strlen(topic) >= PUBLISH_SCHEDULER_TOPIC_SIZE || len > PUBLISH_SCHEDULER_PAYLOAD_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (scheduler_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    publish_queue_t *queue = &queues[cls];
+    publish_slot_t *slot = NULL;
+
+    xSemaphoreTake(scheduler_lock, portMAX_DELAY);
+    if (queue->policy == DROP_SAME_TOPIC) {
+        for (int i = 0; i < queue->count; i++) {
+            if (strcmp(queue_slot(queue, i)->topic, topic) == 0) {
+                slot = queue_slot(queue, i);        // keeps its place and submit time
+                queue->stats.dropped++;
+                break;
+            }
+        }
+    }
+    if (slot == NULL) {
+        if (queue->count == queue->limit) {
+            if (queue->policy == DROP_NEVER) {
+                queue->stats.rejected++;
+                xSemaphoreGive(scheduler_lock);
+                ESP_LOGW(TAG, "Publish queue %s full, %s refused", queue->name, topic);
+                return ESP_ERR_NO_MEM;
+            }
+            dequeue(queue);
+            queue->stats.dropped++;
+        }
+        slot = queue_slot(queue, queue->count);
+        slot->submitted_us = esp_timer_get_time();
+        queue->count++;
+    }
+    strcpy(slot->topic, topic);
+    memcpy(slot->data, data, len);
+    slot->data[len] = '\0';
+    slot->len = len;
+    slot->qos = qos;
+    slot->retain = retain;
+    slot->attempts = 0;
+    slot->id = queue->next_id++;
+    queue->stats.submitted++;
+    xSemaphoreGive(scheduler_lock);
+
+    publish_scheduler_kick();
+    return ESP_OK;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Statistics
+// --------------------------------------------------------------------------------
+void publish_scheduler_get_stats(publish_class_t cls, publish_class_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (cls < 0 || cls >= PUBLISH_CLASS_COUNT || scheduler_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(scheduler_lock, portMAX_DELAY);
+    *out = queues[cls].stats;
+    out->queued = queues[cls].count;
+    xSemaphoreGive(scheduler_lock);
+}
+// --------------------------------------------------------------------------------
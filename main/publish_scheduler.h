@@ -0,0 +1,44 @@
+#ifndef PUBLISH_SCHEDULER_H
+#define PUBLISH_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+// Outbound messages wait here by class instead of in esp-mqtt's FIFO outbox. The dispatcher on the I/O work
+// queue hands them to mqtt_publish() highest class first, and only while the outbox is below the class's
+// share of it, so telemetry and state can never fill the outbox ahead of a button press. Button presses
+// normally come from the message store, which is the event class's persistent queue and publishes itself.
+#define PUBLISH_SCHEDULER_TOPIC_SIZE 64
+#define PUBLISH_SCHEDULER_PAYLOAD_SIZE 512
+#define PUBLISH_SCHEDULER_EVENT_LIMIT 8
+#define PUBLISH_SCHEDULER_STATE_LIMIT 4
+#define PUBLISH_SCHEDULER_TELEMETRY_LIMIT 2
+#define PUBLISH_SCHEDULER_RETRY_MS 1000     // next dispatch attempt while messages are held back
+#define PUBLISH_SCHEDULER_MAX_ATTEMPTS 3    // refused publishes of one message before it is dropped
+
+typedef enum {
+    PUBLISH_CLASS_EVENT,        // user events and replies: never dropped, submit fails when the queue is full
+    PUBLISH_CLASS_STATE,        // a newer message for the same topic replaces the queued one
+    PUBLISH_CLASS_TELEMETRY,    // the oldest message is dropped to make room
+    PUBLISH_CLASS_COUNT,
+} publish_class_t;
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t sent;
+    uint32_t dropped;           // replaced or pushed out by newer messages, or refused by esp-mqtt
+    uint32_t rejected;          // refused because the queue was full
+    uint32_t queued;
+    int64_t max_latency_us;     // submit to handing over to esp-mqtt
+    int64_t total_latency_us;
+} publish_class_stats_t;
+
+// Function prototypes
+esp_err_t publish_scheduler_init(void);
+esp_err_t publish_scheduler_submit(publish_class_t cls, const char *topic, const char *data, int len, int qos,
+                                   bool retain);
+void publish_scheduler_kick(void);
+void publish_scheduler_get_stats(publish_class_t cls, publish_class_stats_t *stats);
+
+#endif // PUBLISH_SCHEDULER_H
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "mqtt_handler.h"
+#include "publish_scheduler.h"
+#include "backpressure.h"
+#include "state_publisher.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+typedef struct {
+    state_value_config_t config;
+    int32_t published_value;
+    int64_t published_ms;
+    bool published;             // false until the first successful publish, and after refresh_all
+} state_value_t;
+
+static state_value_t values[STATE_PUBLISHER_MAX_VALUES];
+static int value_count = 0;
+static TaskHandle_t publisher_task = NULL;
+static volatile bool refresh_requested = false;
+
+// --------------------------------------------------------------------------------
+// Publishing
+// --------------------------------------------------------------------------------
+static bool value_changed(const state_value_t *value, int32_t current)
+{
+    if (!value->published) {
+        return true;
+    }
+    if (value->config.changed != NULL) {
+        return value->config.changed(value->published_value, current);
+    }
+    return llabs((int64_t)current - value->published_value) > value->config.deadband;
+}
+
+// Returns how long until this value needs another look, in ms
+static int64_t service_value(state_value_t *value, int64_t now_ms)
+{
+    int32_t current = value->config.read();
+    int64_t elapsed_ms = now_ms - value->published_ms;
+    bool changed = value_changed(value, current);
+    bool due;
+    // Both intervals stretch while the broker is congested
+    int64_t min_interval_ms = backpressure_scale_interval(value->config.min_interval_ms);
+    int64_t max_interval_ms = backpressure_scale_interval(value->config.max_interval_ms);
+
+    if (changed) {
+        due = !value->published || elapsed_ms >= min_interval_ms;
+    } else {
+        due = max_interval_ms != 0 && elapsed_ms >= max_interval_ms;
+    }
+
+    if (due && mqtt_connected && wifi_connected && backpressure_can_send()) {
+        char payload[STATE_PUBLISHER_PAYLOAD_SIZE];
+        if (value->config.format != NULL) {
+            value->config.format(current, payload, sizeof(payload));
+        } else {
+            snprintf(payload, sizeof(payload), "%" PRId32, current);
+        }
+        publish_policy_t policy = publish_policy_get(value->config.policy);
+        if (publish_scheduler_submit(PUBLISH_CLASS_STATE, value->config.topic, payload, 0, policy.qos,
+                                     policy.retain) == ESP_OK) {
+            ESP_LOGI(TAG, "Queued state to %s: %s", value->config.topic, payload);
+            value->published_value = current;
+            value->published_ms = now_ms;
+            value->published = true;
+            changed = false;
+            due = false;
+            elapsed_ms = 0;
+        }
+    }
+
+    if (due) {
+        return STATE_PUBLISHER_POLL_MS;    // offline or held back, try again later
+    }
+    if (changed) {
+        return min_interval_ms - elapsed_ms;
+    }
+    if (max_interval_ms == 0) {
+        return STATE_PUBLISHER_POLL_MS;
+    }
+    return max_interval_ms - elapsed_ms;
+}
+
+static void state_publisher_task(void *pvParameters)
+{
+    TickType_t wait = 0;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        if (refresh_requested) {
+            refresh_requested = false;
+            for (int i = 0; i < value_count; i++) {
+                values[i].published = false;
+            }
+        }
+
+        int64_t now_ms = esp_timer_get_time() / 1000;
+        int64_t next_ms = STATE_PUBLISHER_POLL_MS;
+        for (int i = 0; i < value_count; i++) {
+            int64_t value_next_ms = service_value(&values[i], now_ms);
+            if (value_next_ms < next_ms) {
+                next_ms = value_next_ms;
+            }
+        }
+        wait = pdMS_TO_TICKS(next_ms > 0 ? next_ms : 1);
+        if (wait == 0) {
+            wait = 1;
+        }
+    }
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Registration
+// --------------------------------------------------------------------------------
+// Values are registered before state_publisher_start()
+esp_err_t state_publisher_register(const state_value_config_t *config, int *handle)
+{
+    if (config == NULL || config->topic == NULL || config->read == NULL || config->deadband < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (publisher_task != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (value_count == STATE_PUBLISHER_MAX_VALUES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    values[value_count].config = *config;
+    values[value_count].published = false;
+    if (handle != NULL) {
+        *handle = value_count;
+    }
+    value_count++;
+    return ESP_OK;
+}
+
+esp_err_t state_publisher_start(void)
+{
+    if (publisher_task != NULL) {
+        return ESP_OK;
+    }
+    if (xTaskCreate(state_publisher_task, "state_publisher", STATE_PUBLISHER_STACK, NULL, 5, &publisher_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Producers call this after changing a value so it is published without waiting for the next poll
+void state_publisher_notify(int handle)
+{
+    if (publisher_task != NULL && handle >= 0 && handle < value_count) {
+        xTaskNotifyGive(publisher_task);
+    }
+}
+
+// Publish every value again, e.g. after the broker connection was re-established
+void state_publisher_refresh_all(void)
+{
+    refresh_requested = true;
+    if (publisher_task != NULL) {
+        xTaskNotifyGive(publisher_task);
+    }
+}
+// --------------------------------------------------------------------------------
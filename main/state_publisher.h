@@ -0,0 +1,38 @@
+#ifndef STATE_PUBLISHER_H
+#define STATE_PUBLISHER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include "publish_policy.h"
+
+// Report-by-exception publishing: a registered value is published when it changes (no sooner than
+// min_interval_ms after its last publish) and otherwise only refreshed once max_interval_ms has passed.
+#define STATE_PUBLISHER_MAX_VALUES 8
+#define STATE_PUBLISHER_POLL_MS 1000        // longest sleep between reads of the registered values
+#define STATE_PUBLISHER_PAYLOAD_SIZE 32
+#define STATE_PUBLISHER_STACK 3072
+
+typedef int32_t (*state_read_fn_t)(void);
+typedef bool (*state_changed_fn_t)(int32_t published, int32_t current);
+typedef void (*state_format_fn_t)(int32_t value, char *payload, size_t size);
+
+typedef struct {
+    const char *topic;
+    state_read_fn_t read;
+    state_changed_fn_t changed;     // NULL: changed when |current - published| > deadband
+    state_format_fn_t format;       // NULL: decimal
+    int32_t deadband;
+    uint32_t min_interval_ms;
+    uint32_t max_interval_ms;       // 0: never refresh an unchanged value
+    publish_policy_class_t policy;  // QoS and retain flag
+} state_value_config_t;
+
+// Function prototypes
+esp_err_t state_publisher_register(const state_value_config_t *config, int *handle);
+esp_err_t state_publisher_start(void);
+void state_publisher_notify(int handle);
+void state_publisher_refresh_all(void);
+
+#endif // STATE_PUBLISHER_H
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "config.h"
+#include "mqtt_handler.h"
+#include "publish_scheduler.h"
+#include "backpressure.h"
+#include "publish_policy.h"
+#include "telemetry.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+typedef struct {
+    telemetry_provider_t provider;
+    void *ctx;
+} telemetry_source_t;
+
+typedef struct {
+    const char *name;
+    TaskHandle_t task;
+} telemetry_task_t;
+
+static telemetry_source_t providers[TELEMETRY_MAX_PROVIDERS];
+static int provider_count = 0;
+static telemetry_task_t tasks[TELEMETRY_MAX_TASKS];
+static int task_count = 0;
+static TaskHandle_t telemetry_task_handle = NULL;
+static char frame_buffer[TELEMETRY_BUFFER_SIZE];
+
+// --------------------------------------------------------------------------------
+// Frame
+// --------------------------------------------------------------------------------
+static cJSON *build_frame(void)
+{
+    cJSON *frame = cJSON_CreateObject();
+    if (frame == NULL) {
+        return NULL;
+    }
+    cJSON_AddInt64ToObject(frame, "uptime_s", esp_timer_get_time() / 1000000);
+
+    for (int i = 0; i < provider_count; i++) {
+        if (providers[i].provider(frame, providers[i].ctx) != ESP_OK) {
+            ESP_LOGW(TAG, "Telemetry provider %d failed", i);
+        }
+    }
+
+    if (task_count > 0) {
+        cJSON *stacks = cJSON_AddObjectToObject(frame, "stack");
+        for (int i = 0; stacks != NULL && i < task_count; i++) {
+            UBaseType_t high_water_mark = uxTaskGetStackHighWaterMark(tasks[i].task);
+            cJSON_AddInt64ToObject(stacks, tasks[i].name, high_water_mark * sizeof(StackType_t));
+        }
+    }
+    return frame;
+}
+
+static void telemetry_task(void *pvParameters)
+{
+    TickType_t last_wake_time = xTaskGetTickCount();
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "esp32/kiosk/%s/telemetry", KIOSK_NAME);
+
+    // Registration is closed once the task runs, so it can add itself to the watched tasks
+    if (task_count < TELEMETRY_MAX_TASKS) {
+        tasks[task_count].name = "telemetry";
+        tasks[task_count].task = xTaskGetCurrentTaskHandle();
+        task_count++;
+    }
+
+    while (true) {
+        if (mqtt_connected && wifi_connected && backpressure_can_send()) {
+            cJSON *frame = build_frame();
+            // Printed into a static buffer, the frame never needs a print allocation
+            if (frame != NULL && cJSON_PrintPreallocated(frame, frame_buffer, sizeof(frame_buffer), false)) {
+                publish_policy_t policy = publish_policy_get(PUBLISH_POLICY_TELEMETRY);
+                publish_scheduler_submit(PUBLISH_CLASS_TELEMETRY, topic, frame_buffer, 0, policy.qos, policy.retain);
+                ESP_LOGI(TAG, "Queued telemetry to %s: %s", topic, frame_buffer);
+            } else {
+                ESP_LOGE(TAG, "Failed to build telemetry frame");
+            }
+            cJSON_Delete(frame);
+        }
+        // Frames come further apart while the broker is congested
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(backpressure_scale_interval(TELEMETRY_INTERVAL_MS)));
+    }
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Registration
+// --------------------------------------------------------------------------------
+// Providers and tasks are registered before telemetry_start()
+esp_err_t telemetry_register(telemetry_provider_t provider, void *ctx)
+{
+    if (provider == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (telemetry_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (provider_count == TELEMETRY_MAX_PROVIDERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    providers[provider_count].provider = provider;
+    providers[provider_count].ctx = ctx;
+    provider_count++;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_watch_task(const char *name, TaskHandle_t task)
+{
+    if (name == NULL || task == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (telemetry_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (task_count == TELEMETRY_MAX_TASKS) {
+        return ESP_ERR_NO_MEM;
+    }
+    tasks[task_count].name = name;
+    tasks[task_count].task = task;
+    task_count++;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_start(void)
+{
+    if (telemetry_task_handle != NULL) {
+        return ESP_OK;
+    }
+    if (xTaskCreate(telemetry_task, "telemetry_task", TELEMETRY_STACK, NULL, 5, &telemetry_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,25 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <cJSON.h>
+
+// One telemetry frame per interval to esp32/kiosk/<name>/telemetry, with the fields of every registered
+// provider plus uptime and the stack high-water marks of the watched tasks.
+#define TELEMETRY_INTERVAL_MS 10000
+#define TELEMETRY_MAX_PROVIDERS 8
+#define TELEMETRY_MAX_TASKS 8
+#define TELEMETRY_BUFFER_SIZE 512        // fits a publish scheduler slot
+#define TELEMETRY_STACK 3072
+
+// Providers add their fields to the frame object; a failing provider is left out of that frame
+typedef esp_err_t (*telemetry_provider_t)(cJSON *frame, void *ctx);
+
+// Function prototypes
+esp_err_t telemetry_register(telemetry_provider_t provider, void *ctx);
+esp_err_t telemetry_watch_task(const char *name, TaskHandle_t task);
+esp_err_t telemetry_start(void);
+
+#endif // TELEMETRY_H
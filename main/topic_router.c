@@ -0,0 +1,250 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_log.h>
+#include "config.h"
+#include "topic_router.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+#define NO_INDEX (-1)
+#define ROOT_NODE 0
+
+typedef struct {
+    int16_t plus_child;         // node for a "+" level
+    int16_t first_route;        // routes whose filter ends here
+    int16_t first_hash_route;   // routes whose filter ends here with "/#"
+} topic_node_t;
+
+// Edges to literal child levels live in one open-addressing table keyed by (parent, level text)
+typedef struct {
+    int16_t parent;             // NO_INDEX for a free slot
+    int16_t child;
+    uint16_t segment_offset;
+    uint16_t segment_length;
+} topic_edge_t;
+
+typedef struct {
+    topic_handler_t handler;
+    void *ctx;
+    int16_t next;
+} topic_route_t;
+
+static topic_node_t nodes[TOPIC_ROUTER_MAX_NODES];
+static topic_edge_t edges[TOPIC_ROUTER_EDGE_SLOTS];
+static topic_route_t routes[TOPIC_ROUTER_MAX_ROUTES];
+static char segment_pool[TOPIC_ROUTER_SEGMENT_POOL];
+static int node_count = 0;
+static int route_count = 0;
+static size_t segment_pool_used = 0;
+
+// --------------------------------------------------------------------------------
+// Trie Helpers
+// --------------------------------------------------------------------------------
+static int new_node(void)
+{
+    if (node_count == TOPIC_ROUTER_MAX_NODES) {
+        return NO_INDEX;
+    }
+    nodes[node_count].plus_child = NO_INDEX;
+    nodes[node_count].first_route = NO_INDEX;
+    nodes[node_count].first_hash_route = NO_INDEX;
+    return node_count++;
+}
+
+static void init_once(void)
+{
+    if (node_count != 0) {
+        return;
+    }
+    for (int i = 0; i < TOPIC_ROUTER_EDGE_SLOTS; i++) {
+        edges[i].parent = NO_INDEX;
+    }
+    new_node(); // ROOT_NODE
+}
+
+static uint32_t edge_hash(int parent, const char *segment, size_t length)
+{
+    uint32_t hash = 2166136261U ^ (uint32_t)parent;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)segment[i]) * 16777619U;
+    }
+    return hash;
+}
+
+// Find the slot of the edge (parent, segment), or the free slot where it would go
+static topic_edge_t *find_edge(int parent, const char *segment, size_t length)
+{
+    uint32_t slot = edge_hash(parent, segment, length) & (TOPIC_ROUTER_EDGE_SLOTS - 1);
+
+    while (edges[slot].parent != NO_INDEX) {
+        topic_edge_t *edge = &edges[slot];
+        if (edge->parent == parent && edge->segment_length == length &&
+            memcmp(&segment_pool[edge->segment_offset], segment, length) == 0) {
+            return edge;
+        }
+        slot = (slot + 1) & (TOPIC_ROUTER_EDGE_SLOTS - 1);
+    }
+    return &edges[slot];
+}
+
+static int get_or_add_child(int parent, const char *segment, size_t length)
+{
+    if (length == 1 && segment[0] == '+') {
+        if (nodes[parent].plus_child == NO_INDEX) {
+            nodes[parent].plus_child = new_node();
+        }
+        return nodes[parent].plus_child;
+    }
+
+    topic_edge_t *edge = find_edge(parent, segment, length);
+    if (edge->parent != NO_INDEX) {
+        return edge->child;
+    }
+    // Keep at least one free slot so lookups always terminate
+    if (node_count >= TOPIC_ROUTER_EDGE_SLOTS - 1 || segment_pool_used + length > sizeof(segment_pool)) {
+        return NO_INDEX;
+    }
+    int child = new_node();
+    if (child == NO_INDEX) {
+        return NO_INDEX;
+    }
+    memcpy(&segment_pool[segment_pool_used], segment, length);
+    edge->parent = parent;
+    edge->child = child;
+    edge->segment_offset = segment_pool_used;
+    edge->segment_length = length;
+    segment_pool_used += length;
+    return child;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Registration
+// --------------------------------------------------------------------------------
+esp_err_t topic_router_add(const char *filter, topic_handler_t handler, void *ctx)
+{
+    if (filter == NULL || handler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    init_once();
+    if (route_count == TOPIC_ROUTER_MAX_ROUTES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int node = ROOT_NODE;
+    bool multi_level = false;
+    const char *segment = filter;
+    while (true) {
+        const char *separator = strchr(segment, '/');
+        size_t length = separator ? (size_t)(separator - segment) : strlen(segment);
+
+        if (length == 1 && segment[0] == '#') {
+            // "#" has to be the last level
+            if (separator != NULL) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            multi_level = true;
+            break;
+        }
+        if (memchr(segment, '#', length) != NULL || (length > 1 && memchr(segment, '+', length) != NULL)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        node = get_or_add_child(node, segment, length);
+        if (node == NO_INDEX) {
+            ESP_LOGE(TAG, "Topic router is full, can't add %s", filter);
+            return ESP_ERR_NO_MEM;
+        }
+        if (separator == NULL) {
+            break;
+        }
+        segment = separator + 1;
+    }
+
+    topic_route_t *route = &routes[route_count];
+    route->handler = handler;
+    route->ctx = ctx;
+    if (multi_level) {
+        route->next = nodes[node].first_hash_route;
+        nodes[node].first_hash_route = route_count;
+    } else {
+        route->next = nodes[node].first_route;
+        nodes[node].first_route = route_count;
+    }
+    route_count++;
+    return ESP_OK;
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Dispatch
+// --------------------------------------------------------------------------------
+static int call_routes(int route, esp_mqtt_event_handle_t event)
+{
+    int called = 0;
+    for (; route != NO_INDEX; route = routes[route].next) {
+        routes[route].handler(event, routes[route].ctx);
+        called++;
+    }
+    return called;
+}
+
+// Returns the number of handlers called
+int topic_router_dispatch(esp_mqtt_event_handle_t event)
+{
+    // Every node that matches the levels seen so far; a tree, so each node is reached at most once
+    int16_t frontier[TOPIC_ROUTER_MAX_NODES];
+    int16_t next_frontier[TOPIC_ROUTER_MAX_NODES];
+    int frontier_count = 0;
+    int called = 0;
+
+    if (node_count == 0 || event->topic == NULL || event->topic_len <= 0) {
+        return 0;
+    }
+
+    const char *topic = event->topic;
+    const char *topic_end = topic + event->topic_len;
+    // Wildcards at the first level don't match topics starting with '$'
+    bool system_topic = (topic[0] == '$');
+
+    frontier[frontier_count++] = ROOT_NODE;
+    const char *segment = topic;
+    while (true) {
+        const char *separator = memchr(segment, '/', topic_end - segment);
+        size_t length = separator ? (size_t)(separator - segment) : (size_t)(topic_end - segment);
+        int next_count = 0;
+
+        for (int i = 0; i < frontier_count; i++) {
+            int node = frontier[i];
+            bool wildcards = !(system_topic && node == ROOT_NODE);
+
+            // "prefix/#" matches everything below prefix
+            if (wildcards) {
+                called += call_routes(nodes[node].first_hash_route, event);
+            }
+            topic_edge_t *edge = find_edge(node, segment, length);
+            if (edge->parent != NO_INDEX) {
+                next_frontier[next_count++] = edge->child;
+            }
+            if (wildcards && nodes[node].plus_child != NO_INDEX) {
+                next_frontier[next_count++] = nodes[node].plus_child;
+            }
+        }
+
+        memcpy(frontier, next_frontier, next_count * sizeof(frontier[0]));
+        frontier_count = next_count;
+        if (frontier_count == 0 || separator == NULL) {
+            break;
+        }
+        segment = separator + 1;
+    }
+
+    // The topic ends here: exact and "+" filters of this length, and "prefix/#" which also matches prefix itself
+    for (int i = 0; i < frontier_count; i++) {
+        called += call_routes(nodes[frontier[i]].first_route, event);
+        called += call_routes(nodes[frontier[i]].first_hash_route, event);
+    }
+    return called;
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,31 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <mqtt_client.h>
+#include <esp_err.h>
+
+// Capacity of the route table, all storage is static. Each can be set at build time for larger tables.
+#ifndef TOPIC_ROUTER_MAX_NODES
+#define TOPIC_ROUTER_MAX_NODES 64       // one per distinct topic level
+#endif
+#ifndef TOPIC_ROUTER_MAX_ROUTES
+#define TOPIC_ROUTER_MAX_ROUTES 32
+#endif
+#ifndef TOPIC_ROUTER_EDGE_SLOTS
+#define TOPIC_ROUTER_EDGE_SLOTS 128     // power of two, larger than TOPIC_ROUTER_MAX_NODES
+#endif
+#ifndef TOPIC_ROUTER_SEGMENT_POOL
+#define TOPIC_ROUTER_SEGMENT_POOL 512   // bytes for the text of all topic levels
+#endif
+
+typedef void (*topic_handler_t)(esp_mqtt_event_handle_t event, void *ctx);
+
+// Routes are registered at startup, before the MQTT client starts delivering data; dispatch
+// walks the topic once, whatever the number of routes. Filters use MQTT syntax: "+" matches one
+// level, a trailing "#" matches any number of levels, and every matching route is called.
+
+// Function prototypes
+esp_err_t topic_router_add(const char *filter, topic_handler_t handler, void *ctx);
+int topic_router_dispatch(esp_mqtt_event_handle_t event);
+
+#endif // TOPIC_ROUTER_H
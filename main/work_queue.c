@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include "config.h"
+#include "work_queue.h"
+
+static const char *TAG = CONFIG_TAG;        // Defined in config.h
+
+typedef struct {
+    work_fn_t fn;
+    void *arg;
+    int64_t submitted_us;
+} work_item_t;
+
+typedef struct {
+    const char *name;
+    int length;
+    int worker_count;
+    int worker_priority;
+    uint32_t worker_stack;
+    QueueHandle_t queue;
+    work_queue_stats_t stats;
+    portMUX_TYPE stats_lock;
+} work_lane_state_t;
+
+static work_lane_state_t lanes[WORK_LANE_COUNT] = {
+    [WORK_LANE_COMMAND] = { "work_queue", WORK_QUEUE_LENGTH, WORK_QUEUE_WORKER_COUNT, WORK_QUEUE_WORKER_PRIORITY,
+                            WORK_QUEUE_WORKER_STACK, NULL, { 0 }, portMUX_INITIALIZER_UNLOCKED },
+    [WORK_LANE_IO] = { "work_io", WORK_QUEUE_IO_LENGTH, 1, WORK_QUEUE_IO_WORKER_PRIORITY,
+                       WORK_QUEUE_IO_WORKER_STACK, NULL, { 0 }, portMUX_INITIALIZER_UNLOCKED },
+};
+
+// --------------------------------------------------------------------------------
+// Worker Task
+// --------------------------------------------------------------------------------
+static void work_queue_worker_task(void *pvParameters)
+{
+    work_lane_state_t *lane = pvParameters;
+    work_item_t item;
+
+    while (true) {
+        if (xQueueReceive(lane->queue, &item, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        int64_t start_us = esp_timer_get_time();
+        item.fn(item.arg);
+        int64_t end_us = esp_timer_get_time();
+
+        int64_t wait_us = start_us - item.submitted_us;
+        int64_t run_us = end_us - start_us;
+        portENTER_CRITICAL(&lane->stats_lock);
+        lane->stats.completed++;
+        lane->stats.total_wait_us += wait_us;
+        if (wait_us > lane->stats.max_wait_us) {
+            lane->stats.max_wait_us = wait_us;
+        }
+        if (run_us > lane->stats.max_run_us) {
+            lane->stats.max_run_us = run_us;
+        }
+        portEXIT_CRITICAL(&lane->stats_lock);
+    }
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Init / Submit
+// --------------------------------------------------------------------------------
+esp_err_t work_queue_init(void)
+{
+    for (int l = 0; l < WORK_LANE_COUNT; l++) {
+        work_lane_state_t *lane = &lanes[l];
+        if (lane->queue != NULL) {
+            continue;
+        }
+
+        lane->queue = xQueueCreate(lane->length, sizeof(work_item_t));
+        if (lane->queue == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        for (int i = 0; i < lane->worker_count; i++) {
+            char name[configMAX_TASK_NAME_LEN];
+            snprintf(name, sizeof(name), "%s_%d", lane->name, i);
+            if (xTaskCreatePinnedToCore(work_queue_worker_task, name, lane->worker_stack, lane,
+                                        lane->worker_priority, NULL, WORK_QUEUE_WORKER_CORE) != pdPASS) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+        ESP_LOGI(TAG, "Work queue %s started with %d worker(s)", lane->name, lane->worker_count);
+    }
+    return ESP_OK;
+}
+
+// Never blocks: when the queue is full the item is dropped and ESP_ERR_TIMEOUT returned
+static esp_err_t submit(work_lane_state_t *lane, work_fn_t fn, void *arg)
+{
+    if (fn == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (lane->queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    work_item_t item = {
+        .fn = fn,
+        .arg = arg,
+        .submitted_us = esp_timer_get_time(),
+    };
+    bool queued = (xQueueSend(lane->queue, &item, 0) == pdTRUE);
+
+    portENTER_CRITICAL(&lane->stats_lock);
+    if (queued) {
+        lane->stats.submitted++;
+    } else {
+        lane->stats.dropped++;
+    }
+    portEXIT_CRITICAL(&lane->stats_lock);
+
+    return queued ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+// For LED commands and other work that must not touch flash or the network
+esp_err_t work_queue_submit(work_fn_t fn, void *arg)
+{
+    return submit(&lanes[WORK_LANE_COMMAND], fn, arg);
+}
+
+// For publishing and flash or NVS writes; run one at a time, in submission order
+esp_err_t work_queue_submit_io(work_fn_t fn, void *arg)
+{
+    return submit(&lanes[WORK_LANE_IO], fn, arg);
+}
+// --------------------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------------------
+// Statistics
+// --------------------------------------------------------------------------------
+void work_queue_get_stats(work_lane_t lane, work_queue_stats_t *out)
+{
+    if (lane < 0 || lane >= WORK_LANE_COUNT) {
+        *out = (work_queue_stats_t){ 0 };
+        return;
+    }
+    portENTER_CRITICAL(&lanes[lane].stats_lock);
+    *out = lanes[lane].stats;
+    portEXIT_CRITICAL(&lanes[lane].stats_lock);
+}
+// --------------------------------------------------------------------------------
@@ -0,0 +1,44 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <stdint.h>
+#include <esp_err.h>
+
+// Deferred work for event handlers that must not block on peripheral I/O: handlers decode and submit,
+// the workers run the item. Two lanes, so LED commands never wait behind flash or the network: the
+// command lane's workers only drive the LEDs, and publishing, flash and NVS writes go to the I/O lane,
+// whose single worker runs them in submission order. With more than one command worker, commands may
+// complete out of submission order.
+#define WORK_QUEUE_LENGTH 16
+#define WORK_QUEUE_WORKER_COUNT 1
+#define WORK_QUEUE_WORKER_CORE 1            // tskNO_AFFINITY to let the scheduler choose
+#define WORK_QUEUE_WORKER_PRIORITY 5
+#define WORK_QUEUE_WORKER_STACK 3072
+#define WORK_QUEUE_IO_LENGTH 16
+#define WORK_QUEUE_IO_WORKER_PRIORITY 4     // below the commands, a flash erase can wait for an LED
+#define WORK_QUEUE_IO_WORKER_STACK 3072
+
+typedef enum {
+    WORK_LANE_COMMAND,
+    WORK_LANE_IO,
+    WORK_LANE_COUNT,
+} work_lane_t;
+
+typedef void (*work_fn_t)(void *arg);
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t dropped;           // submits rejected because the queue was full
+    int64_t max_wait_us;        // submit to start of execution
+    int64_t total_wait_us;
+    int64_t max_run_us;
+} work_queue_stats_t;
+
+// Function prototypes
+esp_err_t work_queue_init(void);
+esp_err_t work_queue_submit(work_fn_t fn, void *arg);
+esp_err_t work_queue_submit_io(work_fn_t fn, void *arg);
+void work_queue_get_stats(work_lane_t lane, work_queue_stats_t *stats);
+
+#endif // WORK_QUEUE_H